@@ -3,9 +3,252 @@
 
 #include "StevesBPL.h"
 
+#include "StevesHelperCommon.h"
 #include "StevesUI/StevesUI.h"
+#include "Components/SceneComponent.h"
+#include "GameFramework/Actor.h"
+
+namespace
+{
+	/// Something found in a cone, with a key to sort it by where lower is better
+	struct FConeCandidate
+	{
+		float Key;
+		int32 Index;
+
+		bool operator<(const FConeCandidate& Other) const
+		{
+			return Key < Other.Key || (Key == Other.Key && Index < Other.Index);
+		}
+	};
+
+	float GetConeSortKey(const FStevesCone& Cone, EStevesConeSort SortBy, const FVector& Location)
+	{
+		const FVector FromOrigin = Location - Cone.Origin;
+		if (SortBy == EStevesConeSort::Angle)
+			return -FVector::DotProduct(Cone.Direction, FromOrigin.GetSafeNormal());
+		return FromOrigin.SizeSquared();
+	}
+
+	/// Collects the best MaxCount candidates (all of them if MaxCount is 0), keeping the worst at the top of a heap
+	/// so that it can be replaced without sorting everything
+	struct FConeCandidateList
+	{
+		TArray<FConeCandidate> Candidates;
+		int32 MaxCount;
+
+		explicit FConeCandidateList(int32 InMaxCount) : MaxCount(FMath::Max(InMaxCount, 0)) {}
+
+		static bool WorstFirst(const FConeCandidate& A, const FConeCandidate& B) { return B < A; }
+
+		void Add(const FConeCandidate& Candidate)
+		{
+			if (MaxCount == 0)
+			{
+				Candidates.Add(Candidate);
+			}
+			else if (Candidates.Num() < MaxCount)
+			{
+				Candidates.HeapPush(Candidate, WorstFirst);
+			}
+			else if (Candidate < Candidates.HeapTop())
+			{
+				Candidates.HeapPopDiscard(WorstFirst, false);
+				Candidates.HeapPush(Candidate, WorstFirst);
+			}
+		}
+
+		/// Sort best first
+		void Finish()
+		{
+			Candidates.Sort();
+		}
+	};
+}
 
 void UStevesBPL::SetWidgetFocus(UWidget* Widget)
 {
 	SetWidgetFocusProperly(Widget);
 }
+
+void UStevesBPL::FilterActorsByCone(const FStevesCone& Cone, const TArray<AActor*>& Actors, bool bUseBounds,
+                                    TArray<AActor*>& OutActors)
+{
+	OutActors.Reset();
+	for (AActor* Actor : Actors)
+	{
+		if (!IsValid(Actor))
+			continue;
+
+		if (bUseBounds)
+		{
+			FVector Origin, Extent;
+			Actor->GetActorBounds(false, Origin, Extent);
+			if (Cone.Overlaps(Origin, Extent.Size()))
+				OutActors.Add(Actor);
+		}
+		else if (Cone.Contains(Actor->GetActorLocation()))
+		{
+			OutActors.Add(Actor);
+		}
+	}
+}
+
+void UStevesBPL::FilterComponentsByCone(const FStevesCone& Cone, const TArray<USceneComponent*>& Components,
+                                        bool bUseBounds, TArray<USceneComponent*>& OutComponents)
+{
+	OutComponents.Reset();
+	for (USceneComponent* Comp : Components)
+	{
+		if (!IsValid(Comp))
+			continue;
+
+		if (bUseBounds ? Cone.Overlaps(Comp->Bounds.Origin, Comp->Bounds.SphereRadius)
+		               : Cone.Contains(Comp->GetComponentLocation()))
+		{
+			OutComponents.Add(Comp);
+		}
+	}
+}
+
+int32 UStevesBPL::FilterLocationsByCone(const FStevesCone& Cone, const TArray<FVector>& Locations, float Radius,
+                                        TArray<int32>& OutIndices)
+{
+	FStevesSphereArray Spheres;
+	Spheres.Reserve(Locations.Num());
+	for (const FVector& Location : Locations)
+	{
+		Spheres.Add(Location, Radius);
+	}
+	OutIndices.Reset();
+	return Cone.OverlapsAll(Spheres, OutIndices);
+}
+
+int32 UStevesBPL::FilterBoxesByCone(const FStevesCone& Cone, const TArray<FBox>& Boxes, TArray<int32>& OutIndices)
+{
+	FStevesBoxArray BoxArray;
+	BoxArray.Reserve(Boxes.Num());
+	for (const FBox& Box : Boxes)
+	{
+		BoxArray.Add(Box);
+	}
+	OutIndices.Reset();
+	return Cone.OverlapsAll(BoxArray, OutIndices);
+}
+
+int32 UStevesBPL::FilterCapsulesByCone(const FStevesCone& Cone, const TArray<FVector>& CapsuleStarts,
+                                       const TArray<FVector>& CapsuleEnds, float CapsuleRadius,
+                                       TArray<int32>& OutIndices)
+{
+	OutIndices.Reset();
+	if (CapsuleStarts.Num() != CapsuleEnds.Num())
+	{
+		UE_LOG(LogStevesUEHelpers, Error, TEXT("FilterCapsulesByCone: %d capsule starts but %d ends"),
+		       CapsuleStarts.Num(), CapsuleEnds.Num());
+		return 0;
+	}
+
+	FStevesCapsuleArray Capsules;
+	Capsules.Reserve(CapsuleStarts.Num());
+	for (int32 i = 0; i < CapsuleStarts.Num(); ++i)
+	{
+		Capsules.Add(CapsuleStarts[i], CapsuleEnds[i], CapsuleRadius);
+	}
+	return Cone.OverlapsAll(Capsules, OutIndices);
+}
+
+int32 UStevesBPL::IntersectRaysWithCone(const FStevesCone& Cone, const TArray<FVector>& RayOrigins,
+                                        const TArray<FVector>& RayDirs, TArray<int32>& OutIndices,
+                                        TArray<float>& OutDistances)
+{
+	OutIndices.Reset();
+	OutDistances.Reset();
+	if (RayOrigins.Num() != RayDirs.Num())
+	{
+		UE_LOG(LogStevesUEHelpers, Error, TEXT("IntersectRaysWithCone: %d ray origins but %d directions"),
+		       RayOrigins.Num(), RayDirs.Num());
+		return 0;
+	}
+
+	FStevesRayArray Rays;
+	Rays.Reserve(RayOrigins.Num());
+	for (int32 i = 0; i < RayOrigins.Num(); ++i)
+	{
+		Rays.Add(RayOrigins[i], RayDirs[i]);
+	}
+	TArray<uint32> Mask;
+	TArray<float> Distances;
+	Cone.IntersectRays(Rays, Mask, Distances);
+	StevesMathHelpers::AppendMaskIndices(Mask, OutIndices);
+	OutDistances.Reserve(OutIndices.Num());
+	for (int32 Index : OutIndices)
+	{
+		OutDistances.Add(Distances[Index]);
+	}
+	return OutIndices.Num();
+}
+
+void UStevesBPL::SortActorsInCone(const FStevesCone& Cone, const TArray<AActor*>& Actors, EStevesConeSort SortBy,
+                                  bool bUseBounds, int32 MaxCount, TArray<AActor*>& OutActors)
+{
+	FConeCandidateList List(MaxCount);
+	for (int32 i = 0; i < Actors.Num(); ++i)
+	{
+		AActor* Actor = Actors[i];
+		if (!IsValid(Actor))
+			continue;
+
+		FVector Location;
+		bool bInCone;
+		if (bUseBounds)
+		{
+			FVector Extent;
+			Actor->GetActorBounds(false, Location, Extent);
+			bInCone = Cone.Overlaps(Location, Extent.Size());
+		}
+		else
+		{
+			Location = Actor->GetActorLocation();
+			bInCone = Cone.Contains(Location);
+		}
+		if (bInCone)
+			List.Add(FConeCandidate {GetConeSortKey(Cone, SortBy, Location), i});
+	}
+	List.Finish();
+
+	OutActors.Reset(List.Candidates.Num());
+	for (const auto& Candidate : List.Candidates)
+	{
+		OutActors.Add(Actors[Candidate.Index]);
+	}
+}
+
+void UStevesBPL::SortLocationsInCone(const FStevesCone& Cone, const TArray<FVector>& Locations, float Radius,
+                                     EStevesConeSort SortBy, int32 MaxCount, TArray<int32>& OutIndices)
+{
+	FStevesSphereArray Spheres;
+	Spheres.Reserve(Locations.Num());
+	for (const FVector& Location : Locations)
+	{
+		Spheres.Add(Location, Radius);
+	}
+	TArray<uint32> Mask;
+	Cone.OverlapsAll(Spheres, Mask);
+
+	FConeCandidateList List(MaxCount);
+	for (int32 w = 0; w < Mask.Num(); ++w)
+	{
+		for (uint32 Bits = Mask[w]; Bits; Bits &= Bits - 1)
+		{
+			const int32 i = w * 32 + FMath::CountTrailingZeros(Bits);
+			List.Add(FConeCandidate {GetConeSortKey(Cone, SortBy, Locations[i]), i});
+		}
+	}
+	List.Finish();
+
+	OutIndices.Reset(List.Candidates.Num());
+	for (const auto& Candidate : List.Candidates)
+	{
+		OutIndices.Add(Candidate.Index);
+	}
+}
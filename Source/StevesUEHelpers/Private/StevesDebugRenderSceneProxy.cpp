@@ -3,40 +3,236 @@
 
 #include "StevesDebugRenderSceneProxy.h"
 
+#include "MaterialShared.h"
+#include "StevesDebugShapeDrawing.h"
+
+using namespace StevesDebugShapeDrawing;
+
+namespace
+{
+	/// Angle in degrees covered by a circle or arc, for LOD
+	float GetAngleRange(const FStevesDebugRenderSceneProxy::FDebugCircle&) { return 360.f; }
+	float GetAngleRange(const FStevesDebugRenderSceneProxy::FDebugArc& A) { return A.MaxAngle - A.MinAngle; }
+}
+
+FStevesDebugRenderSceneProxy::FStevesDebugRenderSceneProxy(const UPrimitiveComponent* InComponent, bool bInCacheShapes,
+                                                           bool bInLocalSpace)
+	: FDebugRenderSceneProxy(InComponent),
+	  bCacheShapes(bInCacheShapes),
+	  bLocalSpace(bInLocalSpace),
+	  VertexFactory(GetScene().GetFeatureLevel(), "FStevesDebugRenderSceneProxy")
+{
+}
+
+FStevesDebugRenderSceneProxy::~FStevesDebugRenderSceneProxy()
+{
+	VertexBuffers.PositionVertexBuffer.ReleaseResource();
+	VertexBuffers.StaticMeshVertexBuffer.ReleaseResource();
+	VertexBuffers.ColorVertexBuffer.ReleaseResource();
+	IndexBuffer.ReleaseResource();
+	VertexFactory.ReleaseResource();
+}
+
+void FStevesDebugRenderSceneProxy::CreateRenderThreadResources()
+{
+	FDebugRenderSceneProxy::CreateRenderThreadResources();
+
+	AdoptBaseShapes();
+
+	auto HasSolid = [](const auto& Shapes) { return Shapes.ContainsByPredicate([](const auto& S) { return IsSolid(S); }); };
+	bHasSolidShapes = HasSolid(StyledSpheres) || HasSolid(StyledBoxes) || HasSolid(DebugCylinders) ||
+		HasSolid(DebugCapsules) || HasSolid(DebugCones) || HasSolid(Frustums);
+
+	if (bCacheShapes)
+		BuildCachedShapes();
+}
+
+void FStevesDebugRenderSceneProxy::AdoptBaseShapes()
+{
+	for (const auto& L : Lines)
+	{
+		StyledLines.Add(FStyledLine(L.Start, L.End, L.Color, L.Thickness));
+	}
+	Lines.Empty();
+	for (const auto& A : ArrowLines)
+	{
+		StyledArrows.Add(FStyledArrow(A.Start, A.End, A.Color));
+	}
+	ArrowLines.Empty();
+
+	// Match the base class DrawType
+	for (const auto& S : Spheres)
+	{
+		if (DrawType != SolidMesh)
+			StyledSpheres.Add(FStyledSphere(S.Location, S.Radius, S.Color, false));
+		if (DrawType != WireMesh)
+			StyledSpheres.Add(FStyledSphere(S.Location, S.Radius, S.Color, true));
+	}
+	Spheres.Empty();
+	for (const auto& B : Boxes)
+	{
+		if (DrawType != SolidMesh)
+			StyledBoxes.Add(FStyledBox(B.Box, B.Transform, B.Color, false));
+		if (DrawType != WireMesh)
+			StyledBoxes.Add(FStyledBox(B.Box, B.Transform, B.Color, true));
+	}
+	Boxes.Empty();
+}
+
+void FStevesDebugRenderSceneProxy::BuildCachedShapes()
+{
+	TArray<FDynamicMeshVertex> Vertices;
+	// Separate indices for each depth priority, each is one mesh element
+	TArray<uint32> PriorityIndices[SDPG_MAX];
+	TArray<uint32>* Indices = nullptr;
+	// The cached mesh is drawn with the primitive transform, so world space shapes need to be made local
+	const FMatrix ToLocal = bLocalSpace ? FMatrix::Identity : GetLocalToWorld().Inverse();
+	auto Builder = MakeLineTessellator(ToLocal, [&](const FVector& Start, const FVector& End, const FColor& Color)
+	{
+		const uint32 Base = Vertices.Num();
+		Vertices.Add(FDynamicMeshVertex(Start, FVector2D::ZeroVector, Color));
+		Vertices.Add(FDynamicMeshVertex(End, FVector2D::ZeroVector, Color));
+		Indices->Add(Base);
+		Indices->Add(Base + 1);
+	});
+
+	// Cache what we can and leave the rest to be drawn every frame
+	auto CacheShapes = [&](auto& Shapes)
+	{
+		for (const auto& Shape : Shapes)
+		{
+			if (IsCacheable(Shape))
+			{
+				Indices = &PriorityIndices[Shape.DepthPriority];
+				Builder.AddShape(Shape);
+			}
+		}
+		Shapes.RemoveAll([](const auto& Shape) { return IsCacheable(Shape); });
+	};
+
+	CacheShapes(StyledLines);
+	for (const auto& A : StyledArrows)
+	{
+		if (IsCacheable(A))
+		{
+			Indices = &PriorityIndices[A.DepthPriority];
+			Builder.AddArrow(A.Start, A.End, A.Color);
+		}
+	}
+	StyledArrows.RemoveAll([](const FStyledArrow& A) { return IsCacheable(A); });
+	CacheShapes(StyledSpheres);
+	CacheShapes(StyledBoxes);
+	CacheShapes(DebugCylinders);
+	CacheShapes(DebugCapsules);
+	CacheShapes(DebugCones);
+	CacheShapes(Frustums);
+	CacheShapes(Polylines);
+	// Circles & arcs pick their segment count per view if LOD is enabled, so can't be cached
+	if (!LODSettings.bSegmentLOD)
+	{
+		CacheShapes(Circles);
+		CacheShapes(Arcs);
+	}
+
+	TArray<uint32>& AllIndices = IndexBuffer.Indices;
+	for (int32 Priority = 0; Priority < SDPG_MAX; ++Priority)
+	{
+		if (PriorityIndices[Priority].Num() > 0)
+		{
+			CachedBatches.Add(FCachedLineBatch {
+				ESceneDepthPriorityGroup(Priority), uint32(AllIndices.Num()), uint32(PriorityIndices[Priority].Num() / 2)
+			});
+			AllIndices.Append(PriorityIndices[Priority]);
+		}
+	}
+
+	NumCachedVertices = Vertices.Num();
+	if (NumCachedVertices > 0)
+	{
+		// We're on the render thread already so these initialise immediately
+		VertexBuffers.InitFromDynamicVertex(&VertexFactory, Vertices);
+		IndexBuffer.InitResource();
+	}
+}
 
 void FStevesDebugRenderSceneProxy::GetDynamicMeshElements(const TArray<const FSceneView*>& Views,
 	const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const
 {
-	FDebugRenderSceneProxy::GetDynamicMeshElements(Views, ViewFamily, VisibilityMap, Collector);
+	// Anything we haven't adopted (e.g. text) is drawn by the base class, which can only do world space
+	if (!bLocalSpace)
+		FDebugRenderSceneProxy::GetDynamicMeshElements(Views, ViewFamily, VisibilityMap, Collector);
 
+	// Anything not cached is transformed as it's drawn, so moving the component doesn't need a new proxy
+	const FMatrix ToWorld = bLocalSpace ? GetLocalToWorld() : FMatrix::Identity;
+	const float ToWorldScale = ToWorld.GetMaximumAxisScale();
 
 	for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
 	{
 		if (VisibilityMap & (1 << ViewIndex))
 		{
-			const FSceneView* View = Views[ViewIndex];
+			const FSceneView& View = *Views[ViewIndex];
 			FPrimitiveDrawInterface* PDI = Collector.GetPDI(ViewIndex);
 
-			// Draw Circles
-			for (const auto& C : Circles)
+			// Nothing we draw can be bigger than our bounds, so skip everything if those are too small
+			const FBoxSphereBounds& Bounds = GetBounds();
+			if (GetProjectedPixelRadius(Bounds.Origin, Bounds.SphereRadius, View) < LODSettings.CullPixelRadius)
+				continue;
+
+			// Draw cached shapes
+			for (const auto& Batch : CachedBatches)
 			{
-				DrawCircle(PDI, C.Centre, C.X, C.Y, C.Color, C.Radius, C.NumSegments, SDPG_World, C.Thickness, 0, C.Thickness > 0);
+				FMeshBatch& Mesh = Collector.AllocateMesh();
+				Mesh.VertexFactory = &VertexFactory;
+				Mesh.MaterialRenderProxy = GEngine->VertexColorMaterial->GetRenderProxy();
+				Mesh.Type = PT_LineList;
+				Mesh.DepthPriorityGroup = Batch.DepthPriority;
+				Mesh.bCanApplyViewModeOverrides = false;
+				Mesh.CastShadow = false;
+
+				FMeshBatchElement& BatchElement = Mesh.Elements[0];
+				BatchElement.IndexBuffer = &IndexBuffer;
+				BatchElement.PrimitiveUniformBuffer = GetUniformBuffer();
+				BatchElement.FirstIndex = Batch.FirstIndex;
+				BatchElement.NumPrimitives = Batch.NumLines;
+				BatchElement.MinVertexIndex = 0;
+				BatchElement.MaxVertexIndex = NumCachedVertices - 1;
+
+				Collector.AddMesh(ViewIndex, Mesh);
 			}
 
-			// Draw Arcs
-			for (const auto& C : Arcs)
+			// Everything else is collected from all shape types into one batch per style
+			FStyledLineCollector Lines;
+			FSolidMeshCollector SolidMeshes(View.GetFeatureLevel());
+			CollectShapes(*this, ToWorld, Lines, SolidMeshes, [&](const auto& C)
 			{
-				::DrawArc(PDI, 
-					C.Centre, 
-					C.X, C.Y, 
-					C.MinAngle, C.MaxAngle,
-					C.Radius, C.NumSegments,
-					C.Color, SDPG_Foreground);	
-			}
+				return GetLODSegments(ToWorld.TransformPosition(C.Centre), C.Radius * ToWorldScale,
+				                      GetAngleRange(C), C.NumSegments, View);
+			});
+			Lines.Submit(PDI);
+			SolidMeshes.Submit(ViewIndex, Collector);
 		}
 	}
 }
 
+int32 FStevesDebugRenderSceneProxy::GetLODSegments(const FVector& WorldCentre, float WorldRadius, float AngleRange,
+                                                   int32 NumSegments, const FSceneView& View) const
+{
+	const float PixelRadius = GetProjectedPixelRadius(WorldCentre, WorldRadius, View);
+	if (PixelRadius < LODSettings.CullPixelRadius)
+		return 0;
+
+	if (!LODSettings.bSegmentLOD)
+		return NumSegments;
+
+	// Keep the gap between the true circle and each segment around a pixel; that's R(1 - cos(PI/N)) ~= R * PI^2 / 2N^2
+	const float FullCircleSegments = PI * FMath::Sqrt(PixelRadius * 0.5f);
+	const int32 Segments = FMath::CeilToInt(FullCircleSegments * FMath::Abs(AngleRange) / 360.f);
+	const float RangeScale = FMath::Min(FMath::Abs(AngleRange) / 360.f, 1.f);
+	const int32 MinSegments = FMath::Max(1, FMath::CeilToInt(LODSettings.MinSegments * RangeScale));
+	const int32 MaxSegments = FMath::Max(MinSegments, FMath::CeilToInt(LODSettings.MaxSegments * RangeScale));
+	return FMath::Clamp(Segments, MinSegments, MaxSegments);
+}
+
 FPrimitiveViewRelevance FStevesDebugRenderSceneProxy::GetViewRelevance(const FSceneView* View) const
 {
 	// More useful defaults than FDebugRenderSceneProxy
@@ -45,5 +241,9 @@ FPrimitiveViewRelevance FStevesDebugRenderSceneProxy::GetViewRelevance(const FSc
 	Result.bDynamicRelevance = true;
 	Result.bShadowRelevance = false;
 	Result.bEditorPrimitiveRelevance = UseEditorCompositing(View);
+	// Cached shapes are drawn as an opaque mesh
+	Result.bOpaque = bCacheShapes;
+	// Solid shapes use the translucent debug mesh material
+	Result.bSeparateTranslucency = Result.bNormalTranslucency = bHasSolidShapes;
 	return Result;
 }
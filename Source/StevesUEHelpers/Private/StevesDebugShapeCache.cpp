@@ -0,0 +1,203 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+
+#include "StevesDebugShapeCache.h"
+
+#include "Misc/ScopeRWLock.h"
+
+const int32 FStevesDebugShapeCache::BoxTriangleCorners[36] = {
+	0, 4, 6,  0, 6, 2, // -X
+	1, 3, 7,  1, 7, 5, // +X
+	0, 1, 5,  0, 5, 4, // -Y
+	2, 7, 3,  2, 6, 7, // +Y
+	0, 3, 1,  0, 2, 3, // -Z
+	4, 5, 7,  4, 7, 6  // +Z
+};
+
+namespace
+{
+	/// Point on a unit sphere; Lat is from the +Z pole, Long around Z from +X
+	FVector SpherePoint(float Lat, float Long)
+	{
+		const float SinLat = FMath::Sin(Lat);
+		return FVector(SinLat * FMath::Cos(Long), SinLat * FMath::Sin(Long), FMath::Cos(Lat));
+	}
+
+	/// Points around a unit circle in the plane of X & Y, offset by Centre
+	void AddCircleLines(const FVector& Centre, const FVector& X, const FVector& Y, int32 NumSegments, float MaxAngle,
+	                    TArray<FVector>& Lines)
+	{
+		for (int32 i = 0; i < NumSegments; ++i)
+		{
+			const float A0 = MaxAngle * i / NumSegments;
+			const float A1 = MaxAngle * (i + 1) / NumSegments;
+			Lines.Add(Centre + FMath::Cos(A0) * X + FMath::Sin(A0) * Y);
+			Lines.Add(Centre + FMath::Cos(A1) * X + FMath::Sin(A1) * Y);
+		}
+	}
+
+	/// Triangles of a latitude / longitude sphere, between 2 latitudes
+	void AddSphereTriangles(float MinLat, float MaxLat, int32 NumSegments, int32 NumRings, TArray<FVector>& Tris)
+	{
+		for (int32 Ring = 0; Ring < NumRings; ++Ring)
+		{
+			const float Lat0 = FMath::Lerp(MinLat, MaxLat, float(Ring) / NumRings);
+			const float Lat1 = FMath::Lerp(MinLat, MaxLat, float(Ring + 1) / NumRings);
+			for (int32 Seg = 0; Seg < NumSegments; ++Seg)
+			{
+				const float Long0 = 2.f * PI * Seg / NumSegments;
+				const float Long1 = 2.f * PI * (Seg + 1) / NumSegments;
+				const FVector P00 = SpherePoint(Lat0, Long0);
+				const FVector P01 = SpherePoint(Lat0, Long1);
+				const FVector P10 = SpherePoint(Lat1, Long0);
+				const FVector P11 = SpherePoint(Lat1, Long1);
+				Tris.Append({P00, P10, P11});
+				Tris.Append({P00, P11, P01});
+			}
+		}
+	}
+
+	/// Triangle fan for a disc of radius 1 in the plane of X & Y, facing along X ^ Y
+	void AddDiscTriangles(const FVector& Centre, const FVector& X, const FVector& Y, int32 NumSegments,
+	                      TArray<FVector>& Tris)
+	{
+		for (int32 i = 0; i < NumSegments; ++i)
+		{
+			const float A0 = 2.f * PI * i / NumSegments;
+			const float A1 = 2.f * PI * (i + 1) / NumSegments;
+			Tris.Append({Centre, Centre + FMath::Cos(A0) * X + FMath::Sin(A0) * Y,
+				Centre + FMath::Cos(A1) * X + FMath::Sin(A1) * Y});
+		}
+	}
+
+	/// Side of a cylinder or cone around Z, between 2 heights & radii
+	void AddTubeTriangles(float Z0, float Radius0, float Z1, float Radius1, int32 NumSegments, TArray<FVector>& Tris)
+	{
+		for (int32 i = 0; i < NumSegments; ++i)
+		{
+			const float A0 = 2.f * PI * i / NumSegments;
+			const float A1 = 2.f * PI * (i + 1) / NumSegments;
+			const FVector D0(FMath::Cos(A0), FMath::Sin(A0), 0);
+			const FVector D1(FMath::Cos(A1), FMath::Sin(A1), 0);
+			const FVector P00 = D0 * Radius0 + FVector(0, 0, Z0);
+			const FVector P01 = D1 * Radius0 + FVector(0, 0, Z0);
+			const FVector P10 = D0 * Radius1 + FVector(0, 0, Z1);
+			const FVector P11 = D1 * Radius1 + FVector(0, 0, Z1);
+			Tris.Append({P00, P01, P11});
+			Tris.Append({P00, P11, P10});
+		}
+	}
+}
+
+const FStevesDebugUnitShape& FStevesDebugShapeCache::Get(EStevesDebugUnitShape Shape, int32 NumSegments)
+{
+	static FRWLock Lock;
+	static TMap<uint32, TUniquePtr<FStevesDebugUnitShape>> Shapes;
+
+	NumSegments = Shape == EStevesDebugUnitShape::Box ? 0 : FMath::Clamp(NumSegments, 3, 256);
+	const uint32 Key = (uint32(Shape) << 16) | uint32(NumSegments);
+
+	{
+		FReadScopeLock ReadLock(Lock);
+		if (const auto Existing = Shapes.Find(Key))
+			return **Existing;
+	}
+
+	FWriteScopeLock WriteLock(Lock);
+	// Someone else may have got here first
+	auto& Entry = Shapes.FindOrAdd(Key);
+	if (!Entry.IsValid())
+	{
+		Entry = MakeUnique<FStevesDebugUnitShape>();
+		Generate(Shape, NumSegments, *Entry);
+	}
+	return *Entry;
+}
+
+void FStevesDebugShapeCache::Generate(EStevesDebugUnitShape Shape, int32 NumSegments, FStevesDebugUnitShape& OutShape)
+{
+	TArray<FVector>& Lines = OutShape.Lines;
+	TArray<FVector>& Tris = OutShape.Triangles;
+	const int32 NumRings = FMath::Max(NumSegments / 2, 2);
+
+	switch (Shape)
+	{
+	case EStevesDebugUnitShape::Circle:
+		AddCircleLines(FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, NumSegments, 2.f * PI, Lines);
+		AddDiscTriangles(FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, NumSegments, Tris);
+		break;
+
+	case EStevesDebugUnitShape::Sphere:
+		// Same as DrawWireSphere
+		AddCircleLines(FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, NumSegments, 2.f * PI, Lines);
+		AddCircleLines(FVector::ZeroVector, FVector::ForwardVector, FVector::UpVector, NumSegments, 2.f * PI, Lines);
+		AddCircleLines(FVector::ZeroVector, FVector::RightVector, FVector::UpVector, NumSegments, 2.f * PI, Lines);
+		AddSphereTriangles(0, PI, NumSegments, NumRings, Tris);
+		break;
+
+	case EStevesDebugUnitShape::Hemisphere:
+		AddCircleLines(FVector::ZeroVector, FVector::ForwardVector, FVector::RightVector, NumSegments, 2.f * PI, Lines);
+		AddCircleLines(FVector::ZeroVector, FVector::ForwardVector, FVector::UpVector, NumSegments / 2, PI, Lines);
+		AddCircleLines(FVector::ZeroVector, FVector::RightVector, FVector::UpVector, NumSegments / 2, PI, Lines);
+		AddSphereTriangles(0, HALF_PI, NumSegments, NumRings / 2, Tris);
+		break;
+
+	case EStevesDebugUnitShape::Cylinder:
+		AddCircleLines(FVector(0, 0, -1), FVector::ForwardVector, FVector::RightVector, NumSegments, 2.f * PI, Lines);
+		AddCircleLines(FVector(0, 0, 1), FVector::ForwardVector, FVector::RightVector, NumSegments, 2.f * PI, Lines);
+		AddDiscTriangles(FVector(0, 0, -1), FVector::RightVector, FVector::ForwardVector, NumSegments, Tris);
+		AddDiscTriangles(FVector(0, 0, 1), FVector::ForwardVector, FVector::RightVector, NumSegments, Tris);
+		// fallthrough
+	case EStevesDebugUnitShape::OpenCylinder:
+		for (const FVector& Side : {FVector::ForwardVector, FVector::RightVector, FVector::BackwardVector, FVector::LeftVector})
+		{
+			Lines.Add(Side + FVector(0, 0, -1));
+			Lines.Add(Side + FVector(0, 0, 1));
+		}
+		AddTubeTriangles(-1, 1, 1, 1, NumSegments, Tris);
+		break;
+
+	case EStevesDebugUnitShape::Cone:
+	{
+		// Built around Z then rotated so that Z becomes X
+		const FMatrix ZToX(FVector(0, 1, 0), FVector(0, 0, 1), FVector(1, 0, 0), FVector::ZeroVector);
+		TArray<FVector> ZLines, ZTris;
+		AddCircleLines(FVector(0, 0, 1), FVector::ForwardVector, FVector::RightVector, NumSegments, 2.f * PI, ZLines);
+		for (const FVector& Side : {FVector::ForwardVector, FVector::RightVector, FVector::BackwardVector, FVector::LeftVector})
+		{
+			ZLines.Add(FVector::ZeroVector);
+			ZLines.Add(Side + FVector(0, 0, 1));
+		}
+		AddTubeTriangles(0, 0, 1, 1, NumSegments, ZTris);
+		AddDiscTriangles(FVector(0, 0, 1), FVector::ForwardVector, FVector::RightVector, NumSegments, ZTris);
+		for (const FVector& P : ZLines)
+		{
+			Lines.Add(ZToX.TransformPosition(P));
+		}
+		for (const FVector& P : ZTris)
+		{
+			Tris.Add(ZToX.TransformPosition(P));
+		}
+		break;
+	}
+
+	case EStevesDebugUnitShape::Box:
+		for (int32 i = 0; i < 8; ++i)
+		{
+			for (int32 Bit = 1; Bit < 8; Bit <<= 1)
+			{
+				if (!(i & Bit))
+				{
+					const int32 j = i | Bit;
+					Lines.Add(FVector(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+					Lines.Add(FVector(j & 1, (j >> 1) & 1, (j >> 2) & 1));
+				}
+			}
+		}
+		for (int32 Corner : BoxTriangleCorners)
+		{
+			Tris.Add(FVector(Corner & 1, (Corner >> 1) & 1, (Corner >> 2) & 1));
+		}
+		break;
+	}
+}
@@ -0,0 +1,393 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StevesDebugRenderSceneProxy.h"
+#include "StevesDebugShapeCache.h"
+#include "MaterialShared.h"
+#include "Engine/Engine.h"
+#include "Materials/Material.h"
+
+/// Tessellation & drawing helpers shared by FStevesDebugRenderSceneProxy and the editor vis batch proxy
+namespace StevesDebugShapeDrawing
+{
+	/// Number of segments used for each ring of a wire sphere, same as FDebugRenderSceneProxy
+	constexpr int32 SphereSegments = 20;
+	/// Size of arrow heads, same as FDebugRenderSceneProxy
+	constexpr float ArrowHeadSize = 8.f;
+
+	/// Call Func(Shape, NumSegments, InstanceTM) for each unit shape from FStevesDebugShapeCache that makes up a shape
+	template <typename TFunc>
+	void ForEachUnitShape(const FStevesDebugRenderSceneProxy::FStyledBox& B, TFunc Func)
+	{
+		Func(EStevesDebugUnitShape::Box, 0,
+		     FScaleMatrix(B.Box.Max - B.Box.Min) * FTranslationMatrix(B.Box.Min) * B.Transform.ToMatrixWithScale());
+	}
+
+	template <typename TFunc>
+	void ForEachUnitShape(const FStevesDebugRenderSceneProxy::FStyledSphere& S, TFunc Func)
+	{
+		Func(EStevesDebugUnitShape::Sphere, SphereSegments, FScaleMatrix(S.Radius) * FTranslationMatrix(S.Location));
+	}
+
+	template <typename TFunc>
+	void ForEachUnitShape(const FStevesDebugRenderSceneProxy::FDebugCylinder& C, TFunc Func)
+	{
+		Func(EStevesDebugUnitShape::Cylinder, C.NumSegments,
+		     FMatrix(C.X * C.Radius, C.Y * C.Radius, C.Z * C.HalfHeight, C.Centre));
+	}
+
+	template <typename TFunc>
+	void ForEachUnitShape(const FStevesDebugRenderSceneProxy::FDebugCapsule& C, TFunc Func)
+	{
+		const float CylinderHalfHeight = FMath::Max(C.HalfHeight - C.Radius, 0.f);
+		const FVector HemisphereOffset = C.Z * CylinderHalfHeight;
+		Func(EStevesDebugUnitShape::Hemisphere, C.NumSegments,
+		     FMatrix(C.X * C.Radius, C.Y * C.Radius, C.Z * C.Radius, C.Centre + HemisphereOffset));
+		// Flip 2 axes for the bottom so it's not mirrored
+		Func(EStevesDebugUnitShape::Hemisphere, C.NumSegments,
+		     FMatrix(C.X * C.Radius, -C.Y * C.Radius, -C.Z * C.Radius, C.Centre - HemisphereOffset));
+		if (CylinderHalfHeight > 0)
+		{
+			Func(EStevesDebugUnitShape::OpenCylinder, C.NumSegments,
+			     FMatrix(C.X * C.Radius, C.Y * C.Radius, HemisphereOffset, C.Centre));
+		}
+	}
+
+	template <typename TFunc>
+	void ForEachUnitShape(const FStevesDebugRenderSceneProxy::FDebugCone& C, TFunc Func)
+	{
+		FVector Y, Z;
+		C.Direction.FindBestAxisVectors(Y, Z);
+		const float BaseRadius = C.Length * FMath::Tan(FMath::Min(C.HalfAngle, FMath::DegreesToRadians(89.f)));
+		Func(EStevesDebugUnitShape::Cone, C.NumSegments,
+		     FMatrix(C.Direction * C.Length, Y * BaseRadius, Z * BaseRadius, C.Origin));
+	}
+
+	/// Collects solid shapes for one view, into one mesh per colour & depth priority
+	struct FSolidMeshCollector
+	{
+		struct FSolidMesh
+		{
+			FColor Color;
+			ESceneDepthPriorityGroup DepthPriority;
+			TUniquePtr<FDynamicMeshBuilder> Builder;
+		};
+		ERHIFeatureLevel::Type FeatureLevel;
+		TArray<FSolidMesh> Meshes;
+
+		explicit FSolidMeshCollector(ERHIFeatureLevel::Type InFeatureLevel) : FeatureLevel(InFeatureLevel) {}
+
+		FDynamicMeshBuilder& GetMesh(const FColor& Color, ESceneDepthPriorityGroup DepthPriority)
+		{
+			for (auto& Mesh : Meshes)
+			{
+				if (Mesh.Color == Color && Mesh.DepthPriority == DepthPriority)
+					return *Mesh.Builder;
+			}
+			return *Meshes.Add_GetRef(FSolidMesh {Color, DepthPriority, MakeUnique<FDynamicMeshBuilder>(FeatureLevel)}).Builder;
+		}
+
+		/// Add triangles (triples of points), transformed by XForm
+		void AddTriangles(const FVector* Points, int32 NumPoints, const FMatrix& XForm, const FColor& Color,
+		                  ESceneDepthPriorityGroup DepthPriority)
+		{
+			FDynamicMeshBuilder& Mesh = GetMesh(Color, DepthPriority);
+			for (int32 i = 0; i + 2 < NumPoints; i += 3)
+			{
+				const int32 V0 = Mesh.AddVertex(FDynamicMeshVertex(XForm.TransformPosition(Points[i])));
+				const int32 V1 = Mesh.AddVertex(FDynamicMeshVertex(XForm.TransformPosition(Points[i + 1])));
+				const int32 V2 = Mesh.AddVertex(FDynamicMeshVertex(XForm.TransformPosition(Points[i + 2])));
+				Mesh.AddTriangle(V0, V1, V2);
+			}
+		}
+
+		template <typename TShape>
+		void AddShape(const TShape& Shape, const FMatrix& XForm)
+		{
+			ForEachUnitShape(Shape, [&](EStevesDebugUnitShape UnitShape, int32 NumSegments, const FMatrix& InstanceTM)
+			{
+				const TArray<FVector>& Tris = FStevesDebugShapeCache::Get(UnitShape, NumSegments).Triangles;
+				AddTriangles(Tris.GetData(), Tris.Num(), InstanceTM * XForm, Shape.Color, Shape.DepthPriority);
+			});
+		}
+
+		/// Shapes which are never solid, so shape lists can be drawn without checking their type
+		void AddShape(const FStevesDebugRenderSceneProxy::FStyledLine&, const FMatrix&) {}
+		void AddShape(const FStevesDebugRenderSceneProxy::FDebugCircle&, const FMatrix&) {}
+		void AddShape(const FStevesDebugRenderSceneProxy::FDebugArc&, const FMatrix&) {}
+		void AddShape(const FStevesDebugRenderSceneProxy::FDebugPolyline&, const FMatrix&) {}
+
+		void AddShape(const FStevesDebugRenderSceneProxy::FDebugFrustum& F, const FMatrix& XForm)
+		{
+			FVector Tris[36];
+			for (int32 i = 0; i < 36; ++i)
+			{
+				Tris[i] = F.Corners[FStevesDebugShapeCache::BoxTriangleCorners[i]];
+			}
+			AddTriangles(Tris, 36, XForm, F.Color, F.DepthPriority);
+		}
+
+		void Submit(int32 ViewIndex, FMeshElementCollector& Collector) const
+		{
+			for (const auto& Mesh : Meshes)
+			{
+				auto MaterialProxy = new FColoredMaterialRenderProxy(GEngine->DebugMeshMaterial->GetRenderProxy(), Mesh.Color);
+				Collector.RegisterOneFrameMaterialProxy(MaterialProxy);
+				Mesh.Builder->GetMesh(FMatrix::Identity, MaterialProxy, Mesh.DepthPriority, true, false, ViewIndex, Collector);
+			}
+		}
+	};
+
+	/// Breaks shapes down into line segments, which are passed to AddLine(Start, End, Color) after transforming
+	/// by XForm. Used both to fill cached line buffers and to draw through the PDI.
+	template <typename TAddLine>
+	struct TLineTessellator
+	{
+		const FMatrix& XForm;
+		TAddLine AddLineFunc;
+
+		void AddLine(const FVector& Start, const FVector& End, const FColor& Color)
+		{
+			AddLineFunc(XForm.TransformPosition(Start), XForm.TransformPosition(End), Color);
+		}
+
+		/// Same tessellation as ::DrawArc, angles in degrees
+		void AddArc(const FVector& Centre, const FVector& X, const FVector& Y, float MinAngle, float MaxAngle,
+		            float Radius, int32 NumSegments, const FColor& Color)
+		{
+			NumSegments = FMath::Max(NumSegments, 1);
+			const float AngleStep = (MaxAngle - MinAngle) / NumSegments;
+			float CurrentAngle = MinAngle;
+			FVector LastVertex = Centre + Radius * (FMath::Cos(FMath::DegreesToRadians(CurrentAngle)) * X +
+				FMath::Sin(FMath::DegreesToRadians(CurrentAngle)) * Y);
+			for (int32 i = 0; i < NumSegments; ++i)
+			{
+				CurrentAngle += AngleStep;
+				const FVector ThisVertex = Centre + Radius * (FMath::Cos(FMath::DegreesToRadians(CurrentAngle)) * X +
+					FMath::Sin(FMath::DegreesToRadians(CurrentAngle)) * Y);
+				AddLine(LastVertex, ThisVertex, Color);
+				LastVertex = ThisVertex;
+			}
+		}
+
+		void AddCircle(const FVector& Centre, const FVector& X, const FVector& Y, float Radius, int32 NumSegments,
+		               const FColor& Color)
+		{
+			AddInstance(FStevesDebugShapeCache::Get(EStevesDebugUnitShape::Circle, NumSegments).Lines,
+			            FMatrix(X * Radius, Y * Radius, FVector::ZeroVector, Centre), Color);
+		}
+
+		/// Same as DrawLineArrow
+		void AddArrow(const FVector& Start, const FVector& End, const FColor& Color)
+		{
+			AddLine(Start, End, Color);
+
+			FVector Dir = End - Start;
+			const float Length = Dir.Size();
+			if (Length < SMALL_NUMBER)
+				return;
+			Dir /= Length;
+			FVector YAxis, ZAxis;
+			Dir.FindBestAxisVectors(YAxis, ZAxis);
+			const FMatrix ArrowTM(Dir, YAxis, ZAxis, Start);
+			const FVector Tip = ArrowTM.TransformPosition(FVector(Length, 0, 0));
+			AddLine(Tip, ArrowTM.TransformPosition(FVector(Length - ArrowHeadSize, +ArrowHeadSize, +ArrowHeadSize)), Color);
+			AddLine(Tip, ArrowTM.TransformPosition(FVector(Length - ArrowHeadSize, +ArrowHeadSize, -ArrowHeadSize)), Color);
+			AddLine(Tip, ArrowTM.TransformPosition(FVector(Length - ArrowHeadSize, -ArrowHeadSize, +ArrowHeadSize)), Color);
+			AddLine(Tip, ArrowTM.TransformPosition(FVector(Length - ArrowHeadSize, -ArrowHeadSize, -ArrowHeadSize)), Color);
+		}
+
+		/// Stamp out unit shape lines from FStevesDebugShapeCache, transformed by InstanceTM
+		void AddInstance(const TArray<FVector>& UnitLines, const FMatrix& InstanceTM, const FColor& Color)
+		{
+			const FMatrix CombinedTM = InstanceTM * XForm;
+			for (int32 i = 0; i + 1 < UnitLines.Num(); i += 2)
+			{
+				AddLineFunc(CombinedTM.TransformPosition(UnitLines[i]), CombinedTM.TransformPosition(UnitLines[i + 1]), Color);
+			}
+		}
+
+		/// Any shape made of unit shapes, see ForEachUnitShape
+		template <typename TShape>
+		void AddShape(const TShape& Shape)
+		{
+			ForEachUnitShape(Shape, [&](EStevesDebugUnitShape UnitShape, int32 NumSegments, const FMatrix& InstanceTM)
+			{
+				AddInstance(FStevesDebugShapeCache::Get(UnitShape, NumSegments).Lines, InstanceTM, Shape.Color);
+			});
+		}
+
+		void AddShape(const FStevesDebugRenderSceneProxy::FStyledLine& L)
+		{
+			AddLine(L.Start, L.End, L.Color);
+		}
+
+		void AddShape(const FStevesDebugRenderSceneProxy::FDebugCircle& C)
+		{
+			AddCircle(C.Centre, C.X, C.Y, C.Radius, C.NumSegments, C.Color);
+		}
+
+		void AddShape(const FStevesDebugRenderSceneProxy::FDebugArc& C)
+		{
+			AddArc(C.Centre, C.X, C.Y, C.MinAngle, C.MaxAngle, C.Radius, C.NumSegments, C.Color);
+		}
+
+		void AddShape(const FStevesDebugRenderSceneProxy::FDebugFrustum& F)
+		{
+			// Each edge joins corners which differ in one bit
+			for (int32 i = 0; i < 8; ++i)
+			{
+				for (int32 Bit = 1; Bit < 8; Bit <<= 1)
+				{
+					if (!(i & Bit))
+						AddLine(F.Corners[i], F.Corners[i | Bit], F.Color);
+				}
+			}
+		}
+
+		void AddShape(const FStevesDebugRenderSceneProxy::FDebugPolyline& P)
+		{
+			for (int32 i = 1; i < P.Points.Num(); ++i)
+			{
+				AddLine(P.Points[i - 1], P.Points[i], P.Color);
+			}
+			if (P.bClosed && P.Points.Num() > 2)
+				AddLine(P.Points.Last(), P.Points[0], P.Color);
+		}
+	};
+
+	template <typename TAddLine>
+	TLineTessellator<TAddLine> MakeLineTessellator(const FMatrix& XForm, TAddLine AddLineFunc)
+	{
+		return TLineTessellator<TAddLine> {XForm, AddLineFunc};
+	}
+
+	/// Collects the per-frame lines of every shape type for one view into one bucket per depth priority & thickness,
+	/// so that each bucket goes to the PDI as a single reserved run of batched lines rather than shape by shape
+	struct FStyledLineCollector
+	{
+		struct FBucket
+		{
+			ESceneDepthPriorityGroup DepthPriority;
+			float Thickness;
+			/// Pairs of points
+			TArray<FVector> Points;
+			/// One per line
+			TArray<FColor> Colors;
+		};
+		TArray<FBucket> Buckets;
+
+		FBucket& GetBucket(const FStevesDebugRenderSceneProxy::FDebugShapeStyle& Style)
+		{
+			for (auto& Bucket : Buckets)
+			{
+				if (Bucket.DepthPriority == Style.DepthPriority && Bucket.Thickness == Style.Thickness)
+					return Bucket;
+			}
+			return Buckets.Add_GetRef(FBucket {Style.DepthPriority, Style.Thickness});
+		}
+
+		/// Get a tessellator which adds lines to the bucket for a shape's style, transformed by XForm
+		auto Tessellate(const FStevesDebugRenderSceneProxy::FDebugShapeStyle& Style, const FMatrix& XForm)
+		{
+			FBucket* Bucket = &GetBucket(Style);
+			return MakeLineTessellator(XForm, [Bucket](const FVector& Start, const FVector& End, const FColor& Color)
+			{
+				Bucket->Points.Add(Start);
+				Bucket->Points.Add(End);
+				Bucket->Colors.Add(Color);
+			});
+		}
+
+		void Submit(FPrimitiveDrawInterface* PDI) const
+		{
+			for (const auto& Bucket : Buckets)
+			{
+				const int32 NumLines = Bucket.Colors.Num();
+				const bool bThick = Bucket.Thickness > 0;
+				PDI->AddReserveLines(Bucket.DepthPriority, NumLines, false, bThick);
+				for (int32 i = 0; i < NumLines; ++i)
+				{
+					PDI->DrawLine(Bucket.Points[i * 2], Bucket.Points[i * 2 + 1], Bucket.Colors[i], Bucket.DepthPriority,
+					              Bucket.Thickness, 0, bThick);
+				}
+			}
+		}
+	};
+
+	/// Approximate radius in pixels of a world space sphere in a view, like ComputeBoundsScreenRadiusSquared
+	inline float GetProjectedPixelRadius(const FVector& Centre, float Radius, const FSceneView& View)
+	{
+		const FMatrix& ProjMatrix = View.ViewMatrices.GetProjectionMatrix();
+		const float ScreenMultiple = FMath::Max(0.5f * ProjMatrix.M[0][0], 0.5f * ProjMatrix.M[1][1]);
+		const float PixelScale = ScreenMultiple * View.UnscaledViewRect.Width();
+		if (!View.ViewMatrices.IsPerspectiveProjection())
+			return Radius * PixelScale;
+
+		const float Dist = FVector::Dist(Centre, View.ViewMatrices.GetViewOrigin());
+		return Radius * PixelScale / FMath::Max(Dist, 1.f);
+	}
+
+	template <typename TShape>
+	bool IsSolid(const TShape& Shape) { return Shape.bSolid; }
+	inline bool IsSolid(const FStevesDebugRenderSceneProxy::FStyledLine&) { return false; }
+	inline bool IsSolid(const FStevesDebugRenderSceneProxy::FDebugCircle&) { return false; }
+	inline bool IsSolid(const FStevesDebugRenderSceneProxy::FDebugArc&) { return false; }
+	inline bool IsSolid(const FStevesDebugRenderSceneProxy::FDebugPolyline&) { return false; }
+
+	/// Whether a shape can go in the cached line list: thin, opaque wireframe only
+	template <typename TShape>
+	bool IsCacheable(const TShape& Shape)
+	{
+		return Shape.Thickness <= 0 && Shape.Color.A == 255 && !IsSolid(Shape);
+	}
+
+	/**
+	 * Add all shapes from anything with the same shape arrays as FStevesDebugRenderSceneProxy to the per-frame line &
+	 * solid collectors, transformed by ToWorld.
+	 * @param GetSegments Called as GetSegments(CircleOrArc) to pick the number of segments, 0 to skip the shape
+	 */
+	template <typename TShapes, typename TGetSegments>
+	void CollectShapes(const TShapes& Shapes, const FMatrix& ToWorld, FStyledLineCollector& Lines,
+	                   FSolidMeshCollector& Solids, TGetSegments GetSegments)
+	{
+		auto Collect = [&](const auto& Arr)
+		{
+			for (const auto& Shape : Arr)
+			{
+				if (IsSolid(Shape))
+					Solids.AddShape(Shape, ToWorld);
+				else
+					Lines.Tessellate(Shape, ToWorld).AddShape(Shape);
+			}
+		};
+
+		Collect(Shapes.StyledLines);
+		for (const auto& A : Shapes.StyledArrows)
+		{
+			Lines.Tessellate(A, ToWorld).AddArrow(A.Start, A.End, A.Color);
+		}
+		Collect(Shapes.StyledSpheres);
+		Collect(Shapes.StyledBoxes);
+		Collect(Shapes.DebugCylinders);
+		Collect(Shapes.DebugCapsules);
+		Collect(Shapes.DebugCones);
+		Collect(Shapes.Frustums);
+		Collect(Shapes.Polylines);
+
+		for (const auto& C : Shapes.Circles)
+		{
+			const int32 NumSegments = GetSegments(C);
+			if (NumSegments > 0)
+				Lines.Tessellate(C, ToWorld).AddCircle(C.Centre, C.X, C.Y, C.Radius, NumSegments, C.Color);
+		}
+		for (const auto& C : Shapes.Arcs)
+		{
+			const int32 NumSegments = GetSegments(C);
+			if (NumSegments > 0)
+				Lines.Tessellate(C, ToWorld).AddArc(C.Centre, C.X, C.Y, C.MinAngle, C.MaxAngle, C.Radius, NumSegments, C.Color);
+		}
+	}
+}
@@ -0,0 +1,60 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+
+#include "StevesDebugVisComponent.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+#if !UE_BUILD_SHIPPING
+static int32 GStevesDebugVis = 0;
+static FAutoConsoleVariableRef CVarStevesDebugVis(
+	TEXT("Steves.DebugVis"),
+	GStevesDebugVis,
+	TEXT("Whether to draw UStevesDebugVisComponent shapes in game. 0 = off, 1 = on"),
+	FConsoleVariableDelegate::CreateLambda([](IConsoleVariable*)
+	{
+		// Shapes are only sent to the renderer on change, so add / remove them all now
+		for (TObjectIterator<UStevesDebugVisComponent> It; It; ++It)
+		{
+			if (It->IsRegistered())
+				It->MarkRenderStateDirty();
+		}
+	}),
+	ECVF_Cheat);
+#endif
+
+UStevesDebugVisComponent::UStevesDebugVisComponent(const FObjectInitializer& ObjectInitializer)
+	: UStevesEditorVisComponent(ObjectInitializer)
+{
+#if WITH_EDITORONLY_DATA
+	SetIsVisualizationComponent(false);
+#endif
+	SetHiddenInGame(false);
+	AlwaysLoadOnClient = true;
+	bIsEditorOnly = false;
+}
+
+bool UStevesDebugVisComponent::IsDebugVisEnabled()
+{
+#if UE_BUILD_SHIPPING
+	return false;
+#else
+	return GStevesDebugVis != 0;
+#endif
+}
+
+FPrimitiveSceneProxy* UStevesDebugVisComponent::CreateSceneProxy()
+{
+#if UE_BUILD_SHIPPING
+	return nullptr;
+#else
+	// Always visible in the editor like the editor-only version, only in game if enabled
+	const UWorld* World = GetWorld();
+	if (World && World->IsGameWorld() && !IsDebugVisEnabled())
+		return nullptr;
+
+	return Super::CreateSceneProxy();
+#endif
+}
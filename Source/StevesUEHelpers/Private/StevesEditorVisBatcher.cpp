@@ -0,0 +1,767 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+
+#include "StevesEditorVisBatcher.h"
+
+#include "RHICommandList.h"
+#include "StevesDebugShapeDrawing.h"
+
+using namespace StevesDebugShapeDrawing;
+
+FStevesEditorVisBatchEntryData::FStevesEditorVisBatchEntryData(FStevesEditorVisBatchShapes&& Shapes)
+{
+	ESceneDepthPriorityGroup Priority = SDPG_World;
+	auto Builder = MakeLineTessellator(FMatrix::Identity, [&](const FVector& Start, const FVector& End, const FColor& Color)
+	{
+		LinePoints[Priority].Add(Start);
+		LinePoints[Priority].Add(End);
+		LineColours[Priority].Add(Color);
+		LineColours[Priority].Add(Color);
+	});
+
+	// Tessellate what we can and keep the rest to be drawn every frame
+	auto CacheShapes = [&](auto& InShapes, auto& OutUncached)
+	{
+		for (auto& Shape : InShapes)
+		{
+			if (IsCacheable(Shape))
+			{
+				Priority = Shape.DepthPriority;
+				Builder.AddShape(Shape);
+			}
+			else
+			{
+				OutUncached.Add(MoveTemp(Shape));
+			}
+		}
+	};
+
+	CacheShapes(Shapes.StyledLines, Uncached.StyledLines);
+	for (auto& A : Shapes.StyledArrows)
+	{
+		if (IsCacheable(A))
+		{
+			Priority = A.DepthPriority;
+			Builder.AddArrow(A.Start, A.End, A.Color);
+		}
+		else
+		{
+			Uncached.StyledArrows.Add(A);
+		}
+	}
+	CacheShapes(Shapes.Circles, Uncached.Circles);
+	CacheShapes(Shapes.Arcs, Uncached.Arcs);
+	CacheShapes(Shapes.StyledSpheres, Uncached.StyledSpheres);
+	CacheShapes(Shapes.StyledBoxes, Uncached.StyledBoxes);
+	CacheShapes(Shapes.DebugCylinders, Uncached.DebugCylinders);
+	CacheShapes(Shapes.DebugCapsules, Uncached.DebugCapsules);
+	CacheShapes(Shapes.DebugCones, Uncached.DebugCones);
+	CacheShapes(Shapes.Frustums, Uncached.Frustums);
+	CacheShapes(Shapes.Polylines, Uncached.Polylines);
+
+	Uncached.ForEachArray([&](const auto& Arr)
+	{
+		bHasUncached = bHasUncached || Arr.Num() > 0;
+		bHasSolid = bHasSolid || Arr.ContainsByPredicate([](const auto& S) { return IsSolid(S); });
+	});
+}
+
+namespace
+{
+	/// Buffers start at this many vertices, and are compacted once at least this many are free
+	constexpr int32 MinLineBufferVertices = 4096;
+
+	/// A range of vertices in an FBatchLineBuffer, always a whole number of lines
+	struct FLineRange
+	{
+		int32 Start = 0;
+		int32 Num = 0;
+	};
+
+	/**
+	 * A persistent line list for one depth priority of the batch proxy, in which each component owns a range of
+	 * vertices. Freed ranges are overwritten with zero length lines and re-used, and everything up to NumUsed is drawn
+	 * as one mesh element. Only used on the render thread.
+	 */
+	struct FBatchLineBuffer
+	{
+		FStaticMeshVertexBuffers VertexBuffers;
+		FDynamicMeshIndexBuffer32 IndexBuffer;
+		FLocalVertexFactory VertexFactory;
+		/// Number of vertices the buffers were created with
+		int32 Capacity = 0;
+		/// Vertices below this are drawn, including free ranges
+		int32 NumUsed = 0;
+		int32 NumFree = 0;
+		TArray<FLineRange> FreeRanges;
+
+		explicit FBatchLineBuffer(ERHIFeatureLevel::Type FeatureLevel)
+			: VertexFactory(FeatureLevel, "FStevesEditorVisBatchSceneProxy")
+		{
+		}
+
+		~FBatchLineBuffer()
+		{
+			Release();
+		}
+
+		void Release()
+		{
+			if (Capacity == 0)
+				return;
+
+			VertexBuffers.PositionVertexBuffer.ReleaseResource();
+			VertexBuffers.StaticMeshVertexBuffer.ReleaseResource();
+			VertexBuffers.ColorVertexBuffer.ReleaseResource();
+			IndexBuffer.ReleaseResource();
+			VertexFactory.ReleaseResource();
+			Capacity = 0;
+		}
+
+		/// Create the buffers with room for InCapacity vertices, all empty
+		void Init(int32 InCapacity)
+		{
+			Release();
+			Capacity = InCapacity;
+			Reset();
+
+			// Unused vertices are all at the origin, so they draw nothing
+			TArray<FDynamicMeshVertex> Vertices;
+			Vertices.Init(FDynamicMeshVertex(FVector::ZeroVector), Capacity);
+			// We're on the render thread already so these initialise immediately
+			VertexBuffers.InitFromDynamicVertex(&VertexFactory, Vertices);
+
+			IndexBuffer.Indices.SetNumUninitialized(Capacity);
+			for (int32 i = 0; i < Capacity; ++i)
+			{
+				IndexBuffer.Indices[i] = i;
+			}
+			IndexBuffer.InitResource();
+		}
+
+		/// Forget all ranges without changing the buffers
+		void Reset()
+		{
+			NumUsed = 0;
+			NumFree = 0;
+			FreeRanges.Reset();
+		}
+
+		/// Find room for Num vertices, or return false if the buffers need to grow
+		bool Allocate(int32 Num, FLineRange& OutRange)
+		{
+			OutRange = FLineRange();
+			if (Num == 0)
+				return true;
+
+			for (int32 i = 0; i < FreeRanges.Num(); ++i)
+			{
+				FLineRange& Free = FreeRanges[i];
+				if (Free.Num >= Num)
+				{
+					OutRange = FLineRange {Free.Start, Num};
+					Free.Start += Num;
+					Free.Num -= Num;
+					NumFree -= Num;
+					if (Free.Num == 0)
+						FreeRanges.RemoveAtSwap(i);
+					return true;
+				}
+			}
+
+			if (NumUsed + Num > Capacity)
+				return false;
+			OutRange = FLineRange {NumUsed, Num};
+			NumUsed += Num;
+			return true;
+		}
+
+		void Free(const FLineRange& Range)
+		{
+			if (Range.Num == 0)
+				return;
+
+			void* Dest = RHILockVertexBuffer(VertexBuffers.PositionVertexBuffer.VertexBufferRHI,
+			                                 Range.Start * sizeof(FVector), Range.Num * sizeof(FVector), RLM_WriteOnly);
+			FMemory::Memzero(Dest, Range.Num * sizeof(FVector));
+			RHIUnlockVertexBuffer(VertexBuffers.PositionVertexBuffer.VertexBufferRHI);
+
+			FreeRanges.Add(Range);
+			NumFree += Range.Num;
+		}
+
+		/// Whether enough of the buffer is free that it's worth packing the ranges together again
+		bool NeedsCompacting() const
+		{
+			return NumFree >= MinLineBufferVertices && NumFree > NumUsed / 2;
+		}
+
+		/// Write points into a range, transformed to world space. Colours are optional, e.g. when only moving.
+		void Write(const FLineRange& Range, const FVector* Points, const FColor* Colours, const FMatrix& LocalToWorld)
+		{
+			if (Range.Num == 0)
+				return;
+
+			FVector* DestPoints = static_cast<FVector*>(RHILockVertexBuffer(
+				VertexBuffers.PositionVertexBuffer.VertexBufferRHI, Range.Start * sizeof(FVector),
+				Range.Num * sizeof(FVector), RLM_WriteOnly));
+			for (int32 i = 0; i < Range.Num; ++i)
+			{
+				DestPoints[i] = LocalToWorld.TransformPosition(Points[i]);
+			}
+			RHIUnlockVertexBuffer(VertexBuffers.PositionVertexBuffer.VertexBufferRHI);
+
+			if (Colours)
+			{
+				void* DestColours = RHILockVertexBuffer(VertexBuffers.ColorVertexBuffer.VertexBufferRHI,
+				                                        Range.Start * sizeof(FColor), Range.Num * sizeof(FColor),
+				                                        RLM_WriteOnly);
+				FMemory::Memcpy(DestColours, Colours, Range.Num * sizeof(FColor));
+				RHIUnlockVertexBuffer(VertexBuffers.ColorVertexBuffer.VertexBufferRHI);
+			}
+		}
+	};
+
+	/**
+	 * Proxy for a whole batch. Created once with every entry, then kept up to date by ApplyUpdate, which only touches
+	 * the ranges of components which changed.
+	 */
+	class FStevesEditorVisBatchSceneProxy final : public FPrimitiveSceneProxy
+	{
+	public:
+		FStevesEditorVisBatchSceneProxy(const UPrimitiveComponent* InComponent,
+		                                TArray<FStevesEditorVisBatchEntryUpdate>&& InEntries)
+			: FPrimitiveSceneProxy(InComponent),
+			  InitialEntries(MoveTemp(InEntries))
+		{
+			for (auto& Buffer : LineBuffers)
+			{
+				Buffer = MakeUnique<FBatchLineBuffer>(GetScene().GetFeatureLevel());
+			}
+		}
+
+		virtual SIZE_T GetTypeHash() const override
+		{
+			static size_t UniquePointer;
+			return reinterpret_cast<size_t>(&UniquePointer);
+		}
+
+		virtual uint32 GetMemoryFootprint() const override
+		{
+			return sizeof(*this) + GetAllocatedSize();
+		}
+
+		virtual void CreateRenderThreadResources() override
+		{
+			FStevesEditorVisBatchUpdate Update;
+			Update.Updates = MoveTemp(InitialEntries);
+			ApplyUpdate(Update);
+		}
+
+		/// Apply changes from the game thread. Updates for entries which are already up to date do nothing, so it's
+		/// fine if some were also included in InitialEntries.
+		void ApplyUpdate(const FStevesEditorVisBatchUpdate& Update)
+		{
+			for (const FObjectKey& Key : Update.Removals)
+			{
+				RemoveEntry(Key);
+			}
+
+			bool bNeedsRebuild[SDPG_MAX] = {};
+			for (const auto& U : Update.Updates)
+			{
+				int32 Index;
+				if (const int32* Found = EntryIndices.Find(U.Key))
+				{
+					Index = *Found;
+				}
+				else
+				{
+					if (!U.Data)
+						continue;
+					Index = Entries.AddDefaulted();
+					Entries[Index].Key = U.Key;
+					EntryIndices.Add(U.Key, Index);
+				}
+
+				FRenderEntry& Entry = Entries[Index];
+				const bool bNewData = U.Data && U.Data != Entry.Data;
+				if (!bNewData && Entry.LocalToWorld.Equals(U.LocalToWorld, 0))
+					continue;
+
+				Entry.LocalToWorld = U.LocalToWorld;
+				if (bNewData)
+				{
+					SetEntryData(Entry, nullptr);
+					SetEntryData(Entry, U.Data);
+				}
+				for (int32 Priority = 0; Priority < SDPG_MAX; ++Priority)
+				{
+					const int32 Num = Entry.Data->LinePoints[Priority].Num();
+					if (bNeedsRebuild[Priority])
+						continue;
+					if (bNewData && !LineBuffers[Priority]->Allocate(Num, Entry.Ranges[Priority]))
+					{
+						bNeedsRebuild[Priority] = true;
+						continue;
+					}
+					// A move only needs the points rewriting, colours are the same
+					LineBuffers[Priority]->Write(Entry.Ranges[Priority], Entry.Data->LinePoints[Priority].GetData(),
+					                             bNewData ? Entry.Data->LineColours[Priority].GetData() : nullptr,
+					                             Entry.LocalToWorld);
+				}
+			}
+
+			for (int32 Priority = 0; Priority < SDPG_MAX; ++Priority)
+			{
+				if (bNeedsRebuild[Priority] || LineBuffers[Priority]->NeedsCompacting())
+					RebuildLineBuffer(Priority);
+			}
+		}
+
+		virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily,
+		                                    uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+		{
+			for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+			{
+				if (!(VisibilityMap & (1 << ViewIndex)))
+					continue;
+
+				// One mesh element per depth priority for all cached lines
+				for (int32 Priority = 0; Priority < SDPG_MAX; ++Priority)
+				{
+					const FBatchLineBuffer& Buffer = *LineBuffers[Priority];
+					if (Buffer.NumUsed == 0)
+						continue;
+
+					FMeshBatch& Mesh = Collector.AllocateMesh();
+					Mesh.VertexFactory = &Buffer.VertexFactory;
+					Mesh.MaterialRenderProxy = GEngine->VertexColorMaterial->GetRenderProxy();
+					Mesh.Type = PT_LineList;
+					Mesh.DepthPriorityGroup = ESceneDepthPriorityGroup(Priority);
+					Mesh.bCanApplyViewModeOverrides = false;
+					Mesh.CastShadow = false;
+
+					FMeshBatchElement& BatchElement = Mesh.Elements[0];
+					BatchElement.IndexBuffer = &Buffer.IndexBuffer;
+					BatchElement.PrimitiveUniformBuffer = GetUniformBuffer();
+					BatchElement.FirstIndex = 0;
+					BatchElement.NumPrimitives = Buffer.NumUsed / 2;
+					BatchElement.MinVertexIndex = 0;
+					BatchElement.MaxVertexIndex = Buffer.NumUsed - 1;
+
+					Collector.AddMesh(ViewIndex, Mesh);
+				}
+
+				if (NumUncachedEntries == 0)
+					continue;
+
+				// Everything else is drawn every frame, with each component's transform. Lines from every component
+				// are collected into one batch per style
+				FStyledLineCollector Lines;
+				FSolidMeshCollector SolidMeshes(Views[ViewIndex]->GetFeatureLevel());
+				for (const FRenderEntry& Entry : Entries)
+				{
+					if (Entry.Data->bHasUncached)
+					{
+						CollectShapes(Entry.Data->Uncached, Entry.LocalToWorld, Lines, SolidMeshes,
+						              [](const auto& C) { return C.NumSegments; });
+					}
+				}
+				Lines.Submit(Collector.GetPDI(ViewIndex));
+				SolidMeshes.Submit(ViewIndex, Collector);
+			}
+		}
+
+		virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+		{
+			FPrimitiveViewRelevance Result;
+			Result.bDrawRelevance = IsShown(View);
+			Result.bDynamicRelevance = true;
+			Result.bShadowRelevance = false;
+			Result.bEditorPrimitiveRelevance = UseEditorCompositing(View);
+			Result.bOpaque = true;
+			// Solid shapes use the translucent debug mesh material
+			Result.bSeparateTranslucency = Result.bNormalTranslucency = NumSolidEntries > 0;
+			return Result;
+		}
+
+	protected:
+		/// Render thread copy of one component's entry, and where its lines are in the buffers
+		struct FRenderEntry
+		{
+			FObjectKey Key;
+			FStevesEditorVisBatchEntryDataPtr Data;
+			FMatrix LocalToWorld = FMatrix::Identity;
+			FLineRange Ranges[SDPG_MAX];
+		};
+
+		/// Only used until CreateRenderThreadResources
+		TArray<FStevesEditorVisBatchEntryUpdate> InitialEntries;
+		TArray<FRenderEntry> Entries;
+		/// Index of each component's entry in Entries, which are swap-removed so removal doesn't move anything else
+		TMap<FObjectKey, int32> EntryIndices;
+		TUniquePtr<FBatchLineBuffer> LineBuffers[SDPG_MAX];
+		int32 NumUncachedEntries = 0;
+		int32 NumSolidEntries = 0;
+
+		/// Change an entry's data, freeing its old ranges. New ranges are left for the caller to allocate.
+		void SetEntryData(FRenderEntry& Entry, const FStevesEditorVisBatchEntryDataPtr& Data)
+		{
+			if (Entry.Data)
+			{
+				NumUncachedEntries -= Entry.Data->bHasUncached ? 1 : 0;
+				NumSolidEntries -= Entry.Data->bHasSolid ? 1 : 0;
+				for (int32 Priority = 0; Priority < SDPG_MAX; ++Priority)
+				{
+					LineBuffers[Priority]->Free(Entry.Ranges[Priority]);
+					Entry.Ranges[Priority] = FLineRange();
+				}
+			}
+			Entry.Data = Data;
+			if (Entry.Data)
+			{
+				NumUncachedEntries += Entry.Data->bHasUncached ? 1 : 0;
+				NumSolidEntries += Entry.Data->bHasSolid ? 1 : 0;
+			}
+		}
+
+		void RemoveEntry(const FObjectKey& Key)
+		{
+			int32 Index;
+			if (!EntryIndices.RemoveAndCopyValue(Key, Index))
+				return;
+
+			SetEntryData(Entries[Index], nullptr);
+			Entries.RemoveAtSwap(Index);
+			if (Index < Entries.Num())
+				EntryIndices[Entries[Index].Key] = Index;
+		}
+
+		/// Pack every entry's lines for one depth priority into the buffer again, growing it if needed
+		void RebuildLineBuffer(int32 Priority)
+		{
+			FBatchLineBuffer& Buffer = *LineBuffers[Priority];
+			int32 Needed = 0;
+			for (const FRenderEntry& Entry : Entries)
+			{
+				Needed += Entry.Data->LinePoints[Priority].Num();
+			}
+
+			if (Needed > Buffer.Capacity)
+			{
+				// Leave room to grow so this doesn't happen again soon
+				Buffer.Init(FMath::Max(MinLineBufferVertices, Needed * 2));
+			}
+			else
+			{
+				Buffer.Reset();
+			}
+
+			for (FRenderEntry& Entry : Entries)
+			{
+				const FStevesEditorVisBatchEntryData& Data = *Entry.Data;
+				verify(Buffer.Allocate(Data.LinePoints[Priority].Num(), Entry.Ranges[Priority]));
+				Buffer.Write(Entry.Ranges[Priority], Data.LinePoints[Priority].GetData(),
+				             Data.LineColours[Priority].GetData(), Entry.LocalToWorld);
+			}
+		}
+	};
+
+	/// Whether a box inside the batch bounds is on their edge, so the batch bounds could shrink without it
+	bool TouchesEdge(const FBox& Box, const FBox& Bounds)
+	{
+		return Box.IsValid && (Box.Min.X <= Bounds.Min.X || Box.Min.Y <= Bounds.Min.Y || Box.Min.Z <= Bounds.Min.Z ||
+			Box.Max.X >= Bounds.Max.X || Box.Max.Y >= Bounds.Max.Y || Box.Max.Z >= Bounds.Max.Z);
+	}
+}
+
+UStevesEditorVisBatchComponent::UStevesEditorVisBatchComponent(const FObjectInitializer& ObjectInitializer)
+	: UPrimitiveComponent(ObjectInitializer)
+{
+	// Same as UStevesEditorVisComponent
+	PrimaryComponentTick.bCanEverTick = false;
+	SetCastShadow(false);
+	SetHiddenInGame(true);
+	bVisibleInReflectionCaptures = false;
+	bVisibleInRayTracing = false;
+	bVisibleInRealTimeSkyCaptures = false;
+	AlwaysLoadOnClient = false;
+	bIsEditorOnly = true;
+}
+
+FPrimitiveSceneProxy* UStevesEditorVisBatchComponent::CreateSceneProxy()
+{
+	if (!Batcher)
+		return nullptr;
+
+	// Later changes are sent to this proxy by the batcher as they're flushed
+	TArray<FStevesEditorVisBatchEntryUpdate> Entries;
+	Batcher->GetEntries(BatchIndex, Entries);
+	return new FStevesEditorVisBatchSceneProxy(this, MoveTemp(Entries));
+}
+
+FBoxSphereBounds UStevesEditorVisBatchComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (Batcher)
+	{
+		const FBox Box = Batcher->GetBounds(BatchIndex);
+		if (Box.IsValid)
+			return FBoxSphereBounds(Box);
+	}
+	return Super::CalcBounds(LocalToWorld);
+}
+
+void UStevesEditorVisBatcher::Deinitialize()
+{
+	for (auto& Comp : BatchComponents)
+	{
+		if (Comp)
+		{
+			Comp->DestroyComponent();
+			Comp = nullptr;
+		}
+	}
+
+	FScopeLock Lock(&CriticalSection);
+	for (auto& Batch : Batches)
+	{
+		Batch = FBatch();
+	}
+
+	Super::Deinitialize();
+}
+
+int32 UStevesEditorVisBatcher::GetBatchIndex(const UPrimitiveComponent* Component)
+{
+	return Component->bHiddenInGame ? 0 : 1;
+}
+
+void UStevesEditorVisBatcher::UpdateShapes(const UPrimitiveComponent* Component,
+                                           FStevesEditorVisBatchShapes&& InShapes,
+                                           const FTransform& LocalToWorld,
+                                           const FBox& LocalBounds)
+{
+	// Tessellating is the expensive part, so do it before taking the lock
+	FStevesEditorVisBatchEntryDataPtr Data =
+		MakeShared<FStevesEditorVisBatchEntryData, ESPMode::ThreadSafe>(MoveTemp(InShapes));
+	const FObjectKey Key(Component);
+	const int32 BatchIndex = GetBatchIndex(Component);
+
+	FScopeLock Lock(&CriticalSection);
+
+	// Might have changed batch since the last update
+	RemoveFromBatch(Batches[1 - BatchIndex], Key);
+
+	FPendingChange& Change = Batches[BatchIndex].Pending.FindOrAdd(Key);
+	Change.Data = MoveTemp(Data);
+	Change.LocalToWorld = LocalToWorld.ToMatrixWithScale();
+	Change.WorldBounds = LocalBounds.TransformBy(LocalToWorld);
+	Change.bRemove = false;
+}
+
+void UStevesEditorVisBatcher::UpdateTransform(const UPrimitiveComponent* Component, const FTransform& LocalToWorld,
+                                              const FBox& LocalBounds)
+{
+	const FObjectKey Key(Component);
+
+	FScopeLock Lock(&CriticalSection);
+
+	FBatch& Batch = Batches[GetBatchIndex(Component)];
+	FPendingChange* Change = Batch.Pending.Find(Key);
+	if (!Change)
+	{
+		// Nothing to move if it isn't in the batch
+		if (!Batch.EntryIndices.Contains(Key))
+			return;
+		Change = &Batch.Pending.Add(Key);
+	}
+	else if (Change->bRemove)
+	{
+		return;
+	}
+	Change->LocalToWorld = LocalToWorld.ToMatrixWithScale();
+	Change->WorldBounds = LocalBounds.TransformBy(LocalToWorld);
+}
+
+void UStevesEditorVisBatcher::RemoveShapes(const UPrimitiveComponent* Component)
+{
+	const FObjectKey Key(Component);
+
+	FScopeLock Lock(&CriticalSection);
+
+	for (auto& Batch : Batches)
+	{
+		RemoveFromBatch(Batch, Key);
+	}
+}
+
+void UStevesEditorVisBatcher::RemoveFromBatch(FBatch& Batch, const FObjectKey& Key)
+{
+	if (Batch.EntryIndices.Contains(Key))
+	{
+		FPendingChange& Change = Batch.Pending.FindOrAdd(Key);
+		Change.Data = nullptr;
+		Change.bRemove = true;
+	}
+	else
+	{
+		// Never made it to the proxy, so just forget it
+		Batch.Pending.Remove(Key);
+	}
+}
+
+bool UStevesEditorVisBatcher::CommitPending(FBatch& Batch, FStevesEditorVisBatchUpdate& OutUpdate)
+{
+	// Changes grow the bounds in place; they're only rebuilt over every entry if one on the edge moved or went away
+	const FBox OldBounds = Batch.Bounds;
+	bool bRecalcBounds = false;
+	for (auto& Pair : Batch.Pending)
+	{
+		const FObjectKey& Key = Pair.Key;
+		FPendingChange& Change = Pair.Value;
+		const int32* Found = Batch.EntryIndices.Find(Key);
+
+		if (Change.bRemove)
+		{
+			if (Found)
+			{
+				const int32 Index = *Found;
+				bRecalcBounds |= TouchesEdge(Batch.Entries[Index].WorldBounds, OldBounds);
+				Batch.EntryIndices.Remove(Key);
+				Batch.Entries.RemoveAtSwap(Index);
+				if (Index < Batch.Entries.Num())
+					Batch.EntryIndices[Batch.Entries[Index].Key] = Index;
+				OutUpdate.Removals.Add(Key);
+			}
+			continue;
+		}
+
+		FEntry* Entry;
+		if (Found)
+		{
+			Entry = &Batch.Entries[*Found];
+			bRecalcBounds |= TouchesEdge(Entry->WorldBounds, OldBounds);
+		}
+		else
+		{
+			if (!Change.Data)
+				continue;
+			Batch.EntryIndices.Add(Key, Batch.Entries.Num());
+			Entry = &Batch.Entries.AddDefaulted_GetRef();
+			Entry->Key = Key;
+		}
+		if (Change.WorldBounds.IsValid)
+			Batch.Bounds += Change.WorldBounds;
+
+		if (Change.Data)
+			Entry->Data = Change.Data;
+		Entry->LocalToWorld = Change.LocalToWorld;
+		Entry->WorldBounds = Change.WorldBounds;
+		OutUpdate.Updates.Add(FStevesEditorVisBatchEntryUpdate {Key, MoveTemp(Change.Data), Change.LocalToWorld});
+	}
+	Batch.Pending.Reset();
+
+	if (bRecalcBounds)
+	{
+		Batch.Bounds = FBox(ForceInit);
+		for (const FEntry& Entry : Batch.Entries)
+		{
+			if (Entry.WorldBounds.IsValid)
+				Batch.Bounds += Entry.WorldBounds;
+		}
+	}
+	return Batch.Bounds.IsValid != OldBounds.IsValid || !(Batch.Bounds == OldBounds);
+}
+
+void UStevesEditorVisBatcher::Flush()
+{
+	UWorld* World = GetWorld();
+	for (int32 BatchIndex = 0; BatchIndex < NumBatches; ++BatchIndex)
+	{
+		FBatch& Batch = Batches[BatchIndex];
+		auto& Comp = BatchComponents[BatchIndex];
+		bool bBoundsChanged;
+		bool bHasEntries;
+		{
+			FScopeLock Lock(&CriticalSection);
+
+			if (Batch.Pending.Num() == 0)
+				continue;
+
+			FStevesEditorVisBatchUpdate Update;
+			bBoundsChanged = CommitPending(Batch, Update);
+			bHasEntries = Batch.Entries.Num() > 0;
+
+			// Send only what changed to the existing proxy; a proxy created later gets everything from GetEntries
+			if (Comp && Comp->SceneProxy)
+			{
+				auto Proxy = static_cast<FStevesEditorVisBatchSceneProxy*>(Comp->SceneProxy);
+				ENQUEUE_RENDER_COMMAND(StevesUpdateEditorVisBatch)(
+					[Proxy, Update = MoveTemp(Update)](FRHICommandListImmediate& RHICmdList)
+					{
+						Proxy->ApplyUpdate(Update);
+					});
+			}
+		}
+
+		if (!Comp && World && bHasEntries)
+		{
+			Comp = NewObject<UStevesEditorVisBatchComponent>(this);
+			Comp->Batcher = this;
+			Comp->BatchIndex = BatchIndex;
+			Comp->SetHiddenInGame(BatchIndex == 0);
+			Comp->bIsEditorOnly = BatchIndex == 0;
+			Comp->RegisterComponentWithWorld(World);
+		}
+		else if (Comp && bBoundsChanged)
+		{
+			// Sends the new bounds without recreating the proxy
+			Comp->MarkRenderTransformDirty();
+		}
+	}
+}
+
+void UStevesEditorVisBatcher::GetEntries(int32 BatchIndex, TArray<FStevesEditorVisBatchEntryUpdate>& OutEntries) const
+{
+	FScopeLock Lock(&CriticalSection);
+
+	const FBatch& Batch = Batches[BatchIndex];
+	OutEntries.Reserve(OutEntries.Num() + Batch.Entries.Num());
+	for (const FEntry& Entry : Batch.Entries)
+	{
+		OutEntries.Add(FStevesEditorVisBatchEntryUpdate {Entry.Key, Entry.Data, Entry.LocalToWorld});
+	}
+}
+
+FBox UStevesEditorVisBatcher::GetBounds(int32 BatchIndex) const
+{
+	FScopeLock Lock(&CriticalSection);
+	return Batches[BatchIndex].Bounds;
+}
+
+void UStevesEditorVisBatcher::Tick(float DeltaTime)
+{
+	Flush();
+}
+
+ETickableTickType UStevesEditorVisBatcher::GetTickableTickType() const
+{
+	// Only tick when there are changes, and never for the CDO
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UStevesEditorVisBatcher::IsTickable() const
+{
+	for (const auto& Batch : Batches)
+	{
+		if (Batch.Pending.Num() > 0)
+			return true;
+	}
+	return false;
+}
+
+TStatId UStevesEditorVisBatcher::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UStevesEditorVisBatcher, STATGROUP_Tickables);
+}
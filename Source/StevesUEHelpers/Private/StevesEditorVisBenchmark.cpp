@@ -0,0 +1,356 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+
+#include "StevesEditorVisComponent.h"
+#include "DynamicBufferAllocator.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PrimitiveUniformShaderParameters.h"
+#include "RHI.h"
+#include "RenderingThread.h"
+#include "SceneManagement.h"
+#include "SceneView.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace
+{
+	/// Fill a component with NumShapes shapes, cycling through every type
+	void AddBenchmarkShapes(UStevesEditorVisComponent* Comp, int32 NumShapes)
+	{
+		for (int32 i = 0; i < NumShapes; ++i)
+		{
+			const FVector Loc(i * 10.f, 0, 0);
+			const FColor Col = (i / 11) % 2 ? FColor::Green : FColor::Yellow;
+			switch (i % 11)
+			{
+			case 0: Comp->Lines.Add(FStevesEditorVisLine(Loc, Loc + FVector(0, 0, 50), Col)); break;
+			case 1: Comp->Arrows.Add(FStevesEditorVisLine(Loc, Loc + FVector(0, 50, 0), Col)); break;
+			case 2: Comp->Circles.Add(FStevesEditorVisCircle(Loc, FRotator::ZeroRotator, 25, 16, Col)); break;
+			case 3: Comp->Arcs.Add(FStevesEditorVisArc(Loc, FRotator::ZeroRotator, 0, 90, 25, 8, Col)); break;
+			case 4: Comp->Spheres.Add(FStevesEditorVisSphere(Loc, 25, Col)); break;
+			case 5: Comp->Boxes.Add(FStevesEditorVisBox(Loc, FVector(20), FRotator::ZeroRotator, Col)); break;
+			case 6: Comp->Cylinders.Add(FStevesEditorVisCylinder(Loc, FRotator::ZeroRotator, 10, 25, 12, Col)); break;
+			case 7: Comp->Capsules.Add(FStevesEditorVisCapsule(Loc, FRotator::ZeroRotator, 10, 25, 12, Col)); break;
+			case 8: Comp->Cones.Add(FStevesEditorVisCone(Loc, FRotator::ZeroRotator, 45, 50, 12, Col)); break;
+			case 9: Comp->Frustums.Add(FStevesEditorVisFrustum(Loc, FRotator::ZeroRotator, 90, 1.5f, 5, 50, Col)); break;
+			default: Comp->Polylines.Add(FStevesEditorVisPolyline({Loc, Loc + FVector(0, 20, 0), Loc + FVector(0, 20, 20)}, true, Col)); break;
+			}
+		}
+	}
+
+	struct FBenchmarkResult
+	{
+		const TCHAR* Name;
+		double Seconds;
+		int32 Count;
+	};
+
+	/// Log results, and append them to Saved/Profiling/StevesEditorVisBenchmark.csv so budgets can be checked
+	void ReportResults(const TArray<FBenchmarkResult>& Results, int32 NumComponents, int32 NumShapes, bool bBatched,
+	                   TFunctionRef<void(const FString&)> Log)
+	{
+		const FString Report = FPaths::ProfilingDir() / TEXT("StevesEditorVisBenchmark.csv");
+		FString Csv;
+		if (!IFileManager::Get().FileExists(*Report))
+			Csv += TEXT("Timestamp,Components,ShapesPerComponent,Batched,Stage,TotalMs,PerItemUs\n");
+		const FString Timestamp = FDateTime::Now().ToString();
+
+		Log(FString::Printf(TEXT("Editor vis benchmark: %d components x %d shapes%s"), NumComponents, NumShapes,
+		                    bBatched ? TEXT(" (batched)") : TEXT("")));
+		for (const auto& R : Results)
+		{
+			const double TotalMs = R.Seconds * 1000.0;
+			const double PerItemUs = R.Count > 0 ? R.Seconds * 1000000.0 / R.Count : 0;
+			Log(FString::Printf(TEXT("  %-28s %10.3f ms %10.3f us each"), R.Name, TotalMs, PerItemUs));
+			Csv += FString::Printf(TEXT("%s,%d,%d,%d,%s,%f,%f\n"), *Timestamp, NumComponents, NumShapes,
+			                       bBatched ? 1 : 0, R.Name, TotalMs, PerItemUs);
+		}
+		FFileHelper::SaveStringToFile(Csv, *Report, FFileHelper::EEncodingOptions::AutoDetect,
+		                              &IFileManager::Get(), FILEWRITE_Append);
+		Log(FString::Printf(TEXT("Appended results to %s"), *Report));
+	}
+
+	void RunEditorVisBenchmark(UWorld* World, int32 NumComponents, int32 NumShapes, bool bBatched, FOutputDevice& Ar)
+	{
+		// Without a renderer (e.g. -nullrhi) no proxies are created, so there'd be nothing to time
+		if (!FApp::CanEverRender() || !World->Scene)
+		{
+			Ar.Log(TEXT("The editor vis benchmark needs a renderer, nothing would be timed without one"));
+			return;
+		}
+
+		FActorSpawnParameters Params;
+		Params.ObjectFlags = RF_Transient;
+		AActor* Actor = World->SpawnActor<AActor>(Params);
+		if (!Actor)
+		{
+			Ar.Log(TEXT("Couldn't spawn benchmark actor"));
+			return;
+		}
+		USceneComponent* Root = NewObject<USceneComponent>(Actor);
+		Actor->SetRootComponent(Root);
+		Root->RegisterComponent();
+
+		TArray<UStevesEditorVisComponent*> Comps;
+		Comps.Reserve(NumComponents);
+		for (int32 i = 0; i < NumComponents; ++i)
+		{
+			auto Comp = NewObject<UStevesEditorVisComponent>(Actor);
+			Comp->bUseSharedBatcher = bBatched;
+			// Editor vis is hidden in game by default, which would leave nothing to draw when run from a game
+			Comp->SetHiddenInGame(false);
+			AddBenchmarkShapes(Comp, NumShapes);
+			Comp->SetupAttachment(Root);
+			Comp->SetRelativeLocation(FVector(0, i * 100.f, 0));
+			Comps.Add(Comp);
+		}
+
+		TArray<FBenchmarkResult> Results;
+		auto Time = [&](const TCHAR* Name, int32 Count, auto Func)
+		{
+			const double Start = FPlatformTime::Seconds();
+			Func();
+			Results.Add(FBenchmarkResult {Name, FPlatformTime::Seconds() - Start, Count});
+		};
+
+		Time(TEXT("RegisterComponent"), NumComponents, [&]()
+		{
+			for (auto Comp : Comps)
+			{
+				Comp->RegisterComponent();
+			}
+		});
+		// Adding the proxies to the scene, including tessellating cached shapes
+		Time(TEXT("FlushAfterRegister"), NumComponents, [&]() { FlushRenderingCommands(); });
+
+		// Game thread side of a full render state rebuild. The proxy methods are timed on their own by the
+		// Steves.EditorVis.Proxy automation test, which also works without a renderer
+		Time(TEXT("RecreateRenderState"), NumComponents, [&]()
+		{
+			for (auto Comp : Comps)
+			{
+				Comp->RecreateRenderState_Concurrent();
+			}
+		});
+		Time(TEXT("FlushAfterRecreate"), NumComponents, [&]() { FlushRenderingCommands(); });
+
+		Time(TEXT("CalcBounds"), NumComponents, [&]()
+		{
+			for (auto Comp : Comps)
+			{
+				Comp->CalcBounds(Comp->GetComponentTransform());
+			}
+		});
+
+		constexpr int32 NumMoves = 10;
+		Time(TEXT("TransformUpdate"), NumComponents * NumMoves, [&]()
+		{
+			for (int32 i = 0; i < NumMoves; ++i)
+			{
+				Root->SetWorldLocation(FVector(0, 0, i * 10.f));
+			}
+			FlushRenderingCommands();
+		});
+
+		Actor->Destroy();
+
+		ReportResults(Results, NumComponents, NumShapes, bBatched, [&Ar](const FString& Line) { Ar.Log(Line); });
+	}
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice GStevesEditorVisBenchmarkCmd(
+	TEXT("Steves.EditorVis.Benchmark"),
+	TEXT("Time registering, recreating, bounding & moving UStevesEditorVisComponents. Needs a renderer. ")
+	TEXT("Args: [NumComponents=1000] [ShapesPerComponent=22] [Batched=0]. Results are appended to Saved/Profiling."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+		[](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+		{
+			if (!World)
+			{
+				Ar.Log(TEXT("No world to run the benchmark in"));
+				return;
+			}
+			const int32 NumComponents = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000;
+			const int32 NumShapes = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 22;
+			const bool bBatched = Args.Num() > 2 && FCString::ToBool(*Args[2]);
+			RunEditorVisBenchmark(World, FMath::Max(NumComponents, 1), FMath::Max(NumShapes, 0), bBatched, Ar);
+		}));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/// The collector's constructor is only meant for the renderer, but it's all we need to gather meshes for timing
+	class FBenchmarkMeshElementCollector : public FMeshElementCollector
+	{
+	public:
+		FBenchmarkMeshElementCollector(ERHIFeatureLevel::Type InFeatureLevel) : FMeshElementCollector(InFeatureLevel) {}
+
+		using FMeshElementCollector::AddViewMeshArrays;
+		using FMeshElementCollector::ClearViewMeshArrays;
+		using FMeshElementCollector::SetPrimitive;
+	};
+
+	/// A view of the benchmark shapes, looking along X at the row of components
+	FSceneView* AddBenchmarkView(FSceneViewFamily& ViewFamily)
+	{
+		const FIntRect ViewRect(0, 0, 1920, 1080);
+		FSceneViewInitOptions Options;
+		Options.ViewFamily = &ViewFamily;
+		Options.SetViewRectangle(ViewRect);
+		Options.ViewOrigin = FVector(-1000.f, 0, 200.f);
+		// Swap to the renderer's axis convention, as the player camera does
+		Options.ViewRotationMatrix = FInverseRotationMatrix(FRotator::ZeroRotator) * FMatrix(
+			FPlane(0, 0, 1, 0), FPlane(1, 0, 0, 0), FPlane(0, 1, 0, 0), FPlane(0, 0, 0, 1));
+		Options.ProjectionMatrix = FReversedZPerspectiveMatrix(FMath::DegreesToRadians(45.f), ViewRect.Width(),
+		                                                       ViewRect.Height(), 10.f);
+
+		FSceneView* View = new FSceneView(Options);
+		ViewFamily.Views.Add(View);
+		return View;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStevesEditorVisProxyTest, "Steves.EditorVis.Proxy",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::PerfFilter)
+
+bool FStevesEditorVisProxyTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumComponents = 100;
+	constexpr int32 NumShapes = 22;
+
+	// Without a renderer (e.g. -nullrhi) the world's scene is a dummy which never makes proxies, so the proxies are
+	// made & placed directly (as the scene would) rather than by registering the components
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	TArray<UStevesEditorVisComponent*> Comps;
+	for (int32 i = 0; i < NumComponents; ++i)
+	{
+		auto Comp = NewObject<UStevesEditorVisComponent>(World);
+		Comp->SetHiddenInGame(false);
+		AddBenchmarkShapes(Comp, NumShapes);
+		Comp->SetRelativeLocation(FVector(0, (i - NumComponents / 2) * 20.f, 0));
+		Comps.Add(Comp);
+	}
+
+	TArray<FPrimitiveSceneProxy*> Proxies;
+	double Start = FPlatformTime::Seconds();
+	for (auto Comp : Comps)
+	{
+		Proxies.Add(Comp->CreateSceneProxy());
+	}
+	const double CreateSceneProxySeconds = FPlatformTime::Seconds() - Start;
+	TestEqual(TEXT("Proxies created"), Proxies.FilterByPredicate([](auto P) { return P != nullptr; }).Num(),
+	          NumComponents);
+	Proxies.Remove(nullptr);
+
+	struct FProxyPlacement
+	{
+		FMatrix LocalToWorld;
+		FBoxSphereBounds Bounds;
+		FBoxSphereBounds LocalBounds;
+	};
+	TArray<FProxyPlacement> Placements;
+	for (auto Comp : Comps)
+	{
+		const FTransform& Transform = Comp->GetComponentTransform();
+		Placements.Add(FProxyPlacement {Transform.ToMatrixWithScale(), Comp->CalcBounds(Transform),
+		                                Comp->CalcBounds(FTransform::Identity)});
+	}
+
+	// The proxies still need their render thread setup to draw; with the null RHI that can't be timed meaningfully
+	double CreateResourcesSeconds = 0;
+	ENQUEUE_RENDER_COMMAND(StevesEditorVisProxyTestCreate)(
+		[&Proxies, &Placements, &CreateResourcesSeconds](FRHICommandListImmediate&)
+		{
+			for (int32 i = 0; i < Proxies.Num(); ++i)
+			{
+				const FProxyPlacement& P = Placements[i];
+				Proxies[i]->SetTransform(P.LocalToWorld, P.Bounds, P.LocalBounds, P.LocalToWorld.GetOrigin());
+				Proxies[i]->UpdateUniformBuffer();
+			}
+
+			const double RTStart = FPlatformTime::Seconds();
+			for (auto Proxy : Proxies)
+			{
+				Proxy->CreateRenderThreadResources();
+			}
+			CreateResourcesSeconds = FPlatformTime::Seconds() - RTStart;
+		});
+	FlushRenderingCommands();
+
+	FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(nullptr, World->Scene,
+	                                                                        FEngineShowFlags(ESFIM_Game))
+		.SetWorldTimes(0, 0, 0));
+	AddBenchmarkView(ViewFamily);
+
+	double GetMeshesSeconds = 0;
+	int32 NumMeshes = 0;
+	int32 NumSimpleElements = 0;
+	const ERHIFeatureLevel::Type FeatureLevel = World->Scene->GetFeatureLevel();
+	ENQUEUE_RENDER_COMMAND(StevesEditorVisProxyTestDraw)(
+		[&Proxies, &ViewFamily, &GetMeshesSeconds, &NumMeshes, &NumSimpleElements, FeatureLevel](FRHICommandListImmediate&)
+		{
+			FMemMark Mark(FMemStack::Get());
+			FGlobalDynamicIndexBuffer DynamicIndexBuffer;
+			FGlobalDynamicVertexBuffer DynamicVertexBuffer;
+			FGlobalDynamicReadBuffer DynamicReadBuffer;
+			TArray<FMeshBatchAndRelevance, SceneRenderingAllocator> ViewMeshes;
+			TArray<FPrimitiveUniformShaderParameters> DynamicPrimitiveShaderData;
+			FSimpleElementCollector SimpleElements;
+			{
+				FBenchmarkMeshElementCollector Collector(FeatureLevel);
+				Collector.AddViewMeshArrays(const_cast<FSceneView*>(ViewFamily.Views[0]), &ViewMeshes, &SimpleElements,
+				                            &DynamicPrimitiveShaderData, FeatureLevel, &DynamicIndexBuffer,
+				                            &DynamicVertexBuffer, &DynamicReadBuffer);
+
+				const double RTStart = FPlatformTime::Seconds();
+				for (auto Proxy : Proxies)
+				{
+					Collector.SetPrimitive(Proxy, FHitProxyId());
+					Proxy->GetDynamicMeshElements(ViewFamily.Views, ViewFamily, 1, Collector);
+				}
+				GetMeshesSeconds = FPlatformTime::Seconds() - RTStart;
+				NumMeshes = ViewMeshes.Num();
+				NumSimpleElements = SimpleElements.BatchedElements.GetNumLines() +
+					SimpleElements.TopBatchedElements.GetNumLines();
+				Collector.ClearViewMeshArrays();
+			}
+			DynamicIndexBuffer.Commit();
+			DynamicVertexBuffer.Commit();
+			DynamicReadBuffer.Commit();
+
+			for (auto Proxy : Proxies)
+			{
+				delete Proxy;
+			}
+		});
+	FlushRenderingCommands();
+
+	TestTrue(TEXT("Something was drawn"), NumMeshes + NumSimpleElements > 0);
+
+	TArray<FBenchmarkResult> Results;
+	Results.Add(FBenchmarkResult {TEXT("CreateSceneProxy"), CreateSceneProxySeconds, NumComponents});
+	if (GUsingNullRHI)
+		AddInfo(TEXT("Null RHI, so CreateRenderThreadResources isn't reported"));
+	else
+		Results.Add(FBenchmarkResult {TEXT("CreateRenderThreadResources"), CreateResourcesSeconds, NumComponents});
+	Results.Add(FBenchmarkResult {TEXT("GetDynamicMeshElements"), GetMeshesSeconds, NumComponents});
+	AddInfo(FString::Printf(TEXT("%d meshes, %d lines"), NumMeshes, NumSimpleElements));
+	ReportResults(Results, NumComponents, NumShapes, false, [this](const FString& Line) { AddInfo(Line); });
+
+	World->DestroyWorld(false);
+
+	return true;
+}
+
+#endif
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "StevesEditorVisComponent.h"
 #include "StevesDebugRenderSceneProxy.h"
+#include "StevesEditorVisBatcher.h"
+#include "Engine/World.h"
 
 UStevesEditorVisComponent::UStevesEditorVisComponent(const FObjectInitializer& ObjectInitializer)
 	: UPrimitiveComponent(ObjectInitializer)
@@ -23,93 +25,295 @@ UStevesEditorVisComponent::UStevesEditorVisComponent(const FObjectInitializer& O
 	
 }
 
-FPrimitiveSceneProxy* UStevesEditorVisComponent::CreateSceneProxy()
+namespace
 {
-	auto Ret = new FStevesDebugRenderSceneProxy(this);
-
-	const FTransform& XForm = GetComponentTransform();
-	for (auto& L : Lines)
-	{
-		Ret->Lines.Add(FDebugRenderSceneProxy::FDebugLine(XForm.TransformPosition(L.Start),
-		                                                  XForm.TransformPosition(L.End), L.Colour));
-	}
-	for (auto& A : Arrows)
+	/// Add a component's shapes, transformed by XForm, to anything with the same shape arrays as
+	/// FStevesDebugRenderSceneProxy (the proxy itself, or batch shapes)
+	template <typename TTarget>
+	void AddShapes(const UStevesEditorVisComponent& Comp, const FTransform& XForm, TTarget& Target)
 	{
-		Ret->ArrowLines.Add(FDebugRenderSceneProxy::FArrowLine(XForm.TransformPosition(A.Start),
-														XForm.TransformPosition(A.End), A.Colour));
+		for (auto& L : Comp.Lines)
+		{
+			Target.StyledLines.Add(FStevesDebugRenderSceneProxy::FStyledLine(XForm.TransformPosition(L.Start),
+			                                                                 XForm.TransformPosition(L.End), L.Colour,
+			                                                                 L.Thickness, L.DepthPriority));
+		}
+		for (auto& A : Comp.Arrows)
+		{
+			Target.StyledArrows.Add(FStevesDebugRenderSceneProxy::FStyledArrow(XForm.TransformPosition(A.Start),
+			                                                                   XForm.TransformPosition(A.End), A.Colour,
+			                                                                   A.Thickness, A.DepthPriority));
+		}
+		for (auto& C : Comp.Circles)
+		{
+			FQuat Rot = XForm.TransformRotation(C.Rotation.Quaternion());
+			Target.Circles.Add(FStevesDebugRenderSceneProxy::FDebugCircle(
+				XForm.TransformPosition(C.Location),
+				Rot.GetForwardVector(), Rot.GetRightVector(),
+				XForm.GetMaximumAxisScale() * C.Radius,
+				C.NumSegments, C.Colour, C.Thickness, C.DepthPriority
+				));
+		}
+		for (auto& Arc : Comp.Arcs)
+		{
+			FQuat Rot = XForm.TransformRotation(Arc.Rotation.Quaternion());
+			Target.Arcs.Add(FStevesDebugRenderSceneProxy::FDebugArc(
+				XForm.TransformPosition(Arc.Location),
+				Rot.GetForwardVector(), Rot.GetRightVector(),
+				Arc.MinAngle, Arc.MaxAngle,
+				XForm.GetMaximumAxisScale() * Arc.Radius,
+				Arc.NumSegments, Arc.Colour, Arc.Thickness, Arc.DepthPriority
+				));
+		}
+		for (auto& S : Comp.Spheres)
+		{
+			Target.StyledSpheres.Add(FStevesDebugRenderSceneProxy::FStyledSphere(
+				XForm.TransformPosition(S.Location),
+				XForm.GetMaximumAxisScale() * S.Radius,
+				S.Colour, S.bSolid, S.Thickness, S.DepthPriority
+				));
+		}
+		for (auto& Box : Comp.Boxes)
+		{
+			FVector HalfSize = Box.Size * 0.5f;
+			FBox DBox(-HalfSize, HalfSize);
+			// Apply local rotation first then parent transform
+			FTransform CombinedXForm = FTransform(Box.Rotation, Box.Location) * XForm;
+			Target.StyledBoxes.Add(FStevesDebugRenderSceneProxy::FStyledBox(
+				DBox, CombinedXForm, Box.Colour, Box.bSolid, Box.Thickness, Box.DepthPriority));
+		}
+		for (auto& C : Comp.Cylinders)
+		{
+			FQuat Rot = XForm.TransformRotation(C.Rotation.Quaternion());
+			Target.DebugCylinders.Add(FStevesDebugRenderSceneProxy::FDebugCylinder(
+				XForm.TransformPosition(C.Location),
+				Rot.GetAxisX(), Rot.GetAxisY(), Rot.GetAxisZ(),
+				XForm.GetMaximumAxisScale() * C.Radius,
+				XForm.GetMaximumAxisScale() * C.HalfHeight,
+				C.NumSegments, C.Colour, C.bSolid, C.Thickness, C.DepthPriority
+				));
+		}
+		for (auto& C : Comp.Capsules)
+		{
+			FQuat Rot = XForm.TransformRotation(C.Rotation.Quaternion());
+			Target.DebugCapsules.Add(FStevesDebugRenderSceneProxy::FDebugCapsule(
+				XForm.TransformPosition(C.Location),
+				Rot.GetAxisX(), Rot.GetAxisY(), Rot.GetAxisZ(),
+				XForm.GetMaximumAxisScale() * C.Radius,
+				XForm.GetMaximumAxisScale() * C.HalfHeight,
+				C.NumSegments, C.Colour, C.bSolid, C.Thickness, C.DepthPriority
+				));
+		}
+		for (auto& C : Comp.Cones)
+		{
+			FQuat Rot = XForm.TransformRotation(C.Rotation.Quaternion());
+			Target.DebugCones.Add(FStevesDebugRenderSceneProxy::FDebugCone(
+				XForm.TransformPosition(C.Location),
+				Rot.GetForwardVector(),
+				FMath::DegreesToRadians(C.Angle * 0.5f),
+				XForm.GetMaximumAxisScale() * C.Length,
+				C.NumSegments, C.Colour, C.bSolid, C.Thickness, C.DepthPriority
+				));
+		}
+		for (auto& F : Comp.Frustums)
+		{
+			FVector Corners[8];
+			F.GetCorners(Corners);
+			for (auto& Corner : Corners)
+			{
+				Corner = XForm.TransformPosition(Corner);
+			}
+			Target.Frustums.Add(FStevesDebugRenderSceneProxy::FDebugFrustum(Corners, F.Colour, F.bSolid, F.Thickness,
+			                                                                F.DepthPriority));
+		}
+		for (auto& P : Comp.Polylines)
+		{
+			TArray<FVector> Points;
+			Points.Reserve(P.Points.Num());
+			for (auto& Pt : P.Points)
+			{
+				Points.Add(XForm.TransformPosition(Pt));
+			}
+			Target.Polylines.Add(FStevesDebugRenderSceneProxy::FDebugPolyline(Points, P.bClosed, P.Colour,
+			                                                                  P.Thickness, P.DepthPriority));
+		}
 	}
-	for (auto& C : Circles)
-	{
-		FQuat WorldRot = XForm.TransformRotation(C.Rotation.Quaternion());
-		Ret->Circles.Add(FStevesDebugRenderSceneProxy::FDebugCircle(
-			XForm.TransformPosition(C.Location),
-			WorldRot.GetForwardVector(), WorldRot.GetRightVector(),
-			XForm.GetMaximumAxisScale() * C.Radius,
-			C.NumSegments, C.Colour
-			));
-	}
-	for (auto& Arc : Arcs)
-	{
-		FQuat WorldRot = XForm.TransformRotation(Arc.Rotation.Quaternion());
-		Ret->Arcs.Add(FStevesDebugRenderSceneProxy::FDebugArc(
-			XForm.TransformPosition(Arc.Location),
-			WorldRot.GetForwardVector(), WorldRot.GetRightVector(),
-			Arc.MinAngle, Arc.MaxAngle,
-			XForm.GetMaximumAxisScale() * Arc.Radius,
-			Arc.NumSegments, Arc.Colour
-			));
-	}
-	for (auto& S : Spheres)
-	{
-		Ret->Spheres.Add(FStevesDebugRenderSceneProxy::FSphere(
-			XForm.GetMaximumAxisScale() * S.Radius,
-			XForm.TransformPosition(S.Location),
-			S.Colour
-			));
-	}
-	for (auto& Box : Boxes)
+}
+
+UStevesEditorVisBatcher* UStevesEditorVisComponent::GetBatcher() const
+{
+	return bUseSharedBatcher ? UWorld::GetSubsystem<UStevesEditorVisBatcher>(GetWorld()) : nullptr;
+}
+
+FPrimitiveSceneProxy* UStevesEditorVisComponent::CreateSceneProxy()
+{
+	if (auto Batcher = GetBatcher())
 	{
-		FVector HalfSize = Box.Size * 0.5f;
-		FBox DBox(-HalfSize, HalfSize);
-		// Apply local rotation first then parent transform
-		FTransform CombinedXForm = FTransform(Box.Rotation, Box.Location) * XForm;
-		Ret->Boxes.Add(FStevesDebugRenderSceneProxy::FDebugBox(
-			DBox, Box.Colour, CombinedXForm));
+		// Batched shapes stay in component space too, moving only sends the batcher a new transform
+		FStevesEditorVisBatchShapes Shapes;
+		AddShapes(*this, FTransform::Identity, Shapes);
+		Batcher->UpdateShapes(this, MoveTemp(Shapes), GetComponentTransform(), GetLocalShapeBounds());
+		return nullptr;
 	}
 
+	// Shapes stay in component space, the proxy applies the component transform when rendering
+	auto Ret = new FStevesDebugRenderSceneProxy(this, bCacheShapes, true);
+	Ret->LODSettings.bSegmentLOD = bSegmentLOD;
+	Ret->LODSettings.MinSegments = MinLODSegments;
+	Ret->LODSettings.MaxSegments = MaxLODSegments;
+	Ret->LODSettings.CullPixelRadius = CullPixelRadius;
+	AddShapes(*this, FTransform::Identity, *Ret);
+
 	return Ret;
 	
 }
 
+bool UStevesEditorVisComponent::ShouldRecreateProxyOnUpdateTransform() const
+{
+	// Proxy shapes are in component space, so moving only needs the transform sent to the render thread
+	return false;
+}
+
+void UStevesEditorVisComponent::SendRenderTransform_Concurrent()
+{
+	if (auto Batcher = GetBatcher())
+	{
+		Batcher->UpdateTransform(this, GetComponentTransform(), GetLocalShapeBounds());
+		// There's no proxy of our own, and the scene would try to create one again if asked to move it
+		UpdateBounds();
+		UActorComponent::SendRenderTransform_Concurrent();
+		return;
+	}
+
+	Super::SendRenderTransform_Concurrent();
+}
+
 FBoxSphereBounds UStevesEditorVisComponent::CalcBounds(const FTransform& LocalToWorld) const
 {
-	FBoxSphereBounds B = Super::CalcBounds(LocalToWorld);
+	const FBox& LocalBounds = GetLocalShapeBounds();
+	if (!LocalBounds.IsValid)
+		return Super::CalcBounds(LocalToWorld);
+
+	return FBoxSphereBounds(LocalBounds).TransformBy(LocalToWorld);
+}
+
+void UStevesEditorVisComponent::DestroyRenderState_Concurrent()
+{
+	Super::DestroyRenderState_Concurrent();
+
+	if (auto Batcher = GetBatcher())
+		Batcher->RemoveShapes(this);
+}
+
+void UStevesEditorVisComponent::MarkShapesDirty()
+{
+	bLocalShapeBoundsValid = false;
+	MarkRenderStateDirty();
+	UpdateBounds();
+}
+
+void UStevesEditorVisComponent::OnRegister()
+{
+	// Shapes may have been changed while unregistered, e.g. at construction
+	bLocalShapeBoundsValid = false;
+	Super::OnRegister();
+}
+
+#if WITH_EDITOR
+void UStevesEditorVisComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	// Before Super, which recreates render state
+	bLocalShapeBoundsValid = false;
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+}
+#endif
+
+namespace
+{
+	/// Exact bounds of an arc of a circle in the plane of unit vectors X & Y, angles in degrees
+	FBox GetArcBounds(const FVector& Centre, const FVector& X, const FVector& Y, float Radius, float MinAngle,
+	                  float MaxAngle)
+	{
+		if (MaxAngle < MinAngle)
+			Swap(MinAngle, MaxAngle);
+		const float MinRad = FMath::DegreesToRadians(MinAngle);
+		const float MaxRad = FMath::DegreesToRadians(FMath::Min(MaxAngle, MinAngle + 360.f));
+
+		auto PointAt = [&](float Angle)
+		{
+			return Centre + Radius * (FMath::Cos(Angle) * X + FMath::Sin(Angle) * Y);
+		};
+
+		FBox Ret(ForceInit);
+		Ret += PointAt(MinRad);
+		Ret += PointAt(MaxRad);
+		// On each axis, X[i]cos(a) + Y[i]sin(a) has extremes at atan2(Y[i], X[i]) and half a turn from there
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const float ExtremeAngle = FMath::Atan2(Y[Axis], X[Axis]);
+			for (int32 Half = 0; Half < 2; ++Half)
+			{
+				// Find the first angle >= MinRad which is a full turn multiple from the extreme
+				const float Angle = ExtremeAngle + Half * PI;
+				const float InRange = Angle + FMath::CeilToFloat((MinRad - Angle) / (2.f * PI)) * 2.f * PI;
+				if (InRange <= MaxRad)
+					Ret += PointAt(InRange);
+			}
+		}
+		return Ret;
+	}
+}
+
+const FBox& UStevesEditorVisComponent::GetLocalShapeBounds() const
+{
+	if (bLocalShapeBoundsValid)
+		return LocalShapeBounds;
 
-	// Now we need to merge in all components
+	FBox B(ForceInit);
 	for (auto& L : Lines)
 	{
-		// Re-centre the origin of the line to make box extents 
-		FVector Extents = L.Start.GetAbs().ComponentMax(L.End.GetAbs());
-		B = B + FBoxSphereBounds(FVector::ZeroVector, Extents, Extents.GetMax());
+		B += L.Start;
+		B += L.End;
 	}
 	for (auto& A : Arrows)
 	{
-		// Re-centre the origin of the line to make box extents 
-		FVector Extents = A.Start.GetAbs().ComponentMax(A.End.GetAbs());
-		B = B + FBoxSphereBounds(FVector::ZeroVector, Extents, Extents.GetMax());
+		B += A.Start;
+		B += A.End;
+
+		// Head, as drawn by FStevesDebugRenderSceneProxy
+		constexpr float ArrowHeadSize = 8.f;
+		FVector Dir = A.End - A.Start;
+		const float Length = Dir.Size();
+		if (Length >= SMALL_NUMBER)
+		{
+			Dir /= Length;
+			FVector YAxis, ZAxis;
+			Dir.FindBestAxisVectors(YAxis, ZAxis);
+			const FVector HeadBase = A.End - Dir * ArrowHeadSize;
+			B += HeadBase + (YAxis + ZAxis) * ArrowHeadSize;
+			B += HeadBase + (YAxis - ZAxis) * ArrowHeadSize;
+			B += HeadBase - (YAxis + ZAxis) * ArrowHeadSize;
+			B += HeadBase - (YAxis - ZAxis) * ArrowHeadSize;
+		}
 	}
 	for (auto& C : Circles)
 	{
-		B = B + FBoxSphereBounds(C.Location, FVector(C.Radius), C.Radius);
+		// Extent on each axis is Radius * |projection of the circle plane axes onto it|
+		const FQuat Rot = C.Rotation.Quaternion();
+		const FVector X = Rot.GetForwardVector();
+		const FVector Y = Rot.GetRightVector();
+		const FVector Extent(FVector2D(X.X, Y.X).Size(), FVector2D(X.Y, Y.Y).Size(), FVector2D(X.Z, Y.Z).Size());
+		B += FBox::BuildAABB(C.Location, Extent * C.Radius);
 	}
 	for (auto& Arc : Arcs)
 	{
-		// Just use the entire circle for simplicity
-		B = B + FBoxSphereBounds(Arc.Location, FVector(Arc.Radius), Arc.Radius);
+		const FQuat Rot = Arc.Rotation.Quaternion();
+		B += GetArcBounds(Arc.Location, Rot.GetForwardVector(), Rot.GetRightVector(), Arc.Radius, Arc.MinAngle,
+		                  Arc.MaxAngle);
 	}
 	for (auto& S : Spheres)
 	{
-		B = B + FBoxSphereBounds(S.Location, FVector(S.Radius), S.Radius);
+		B += FBox::BuildAABB(S.Location, FVector(S.Radius));
 	}
 	for (auto& Box : Boxes)
 	{
@@ -117,9 +321,64 @@ FBoxSphereBounds UStevesEditorVisComponent::CalcBounds(const FTransform& LocalTo
 		FBox DBox(-HalfSize, HalfSize);
 		// Apply local rotation only, world is done later
 		FTransform BoxXForm = FTransform(Box.Rotation, Box.Location);
-		DBox = DBox.TransformBy(BoxXForm);
-		B = B + FBoxSphereBounds(DBox);
+		B += DBox.TransformBy(BoxXForm);
+	}
+	for (auto& C : Cylinders)
+	{
+		B += FBox(-FVector(C.Radius, C.Radius, C.HalfHeight), FVector(C.Radius, C.Radius, C.HalfHeight))
+			.TransformBy(FTransform(C.Rotation, C.Location));
+	}
+	for (auto& C : Capsules)
+	{
+		// Hemispheres are spheres as far as bounds go
+		const FVector Axis = C.Rotation.RotateVector(FVector::UpVector) * FMath::Max(C.HalfHeight - C.Radius, 0.f);
+		B += FBox::BuildAABB(C.Location + Axis, FVector(C.Radius));
+		B += FBox::BuildAABB(C.Location - Axis, FVector(C.Radius));
+	}
+	for (auto& C : Cones)
+	{
+		// Apex plus the base circle
+		const FQuat Rot = C.Rotation.Quaternion();
+		const FVector Y = Rot.GetRightVector();
+		const FVector Z = Rot.GetUpVector();
+		const float BaseRadius = C.Length * FMath::Tan(FMath::DegreesToRadians(FMath::Min(C.Angle * 0.5f, 89.f)));
+		const FVector Extent(FVector2D(Y.X, Z.X).Size(), FVector2D(Y.Y, Z.Y).Size(), FVector2D(Y.Z, Z.Z).Size());
+		B += C.Location;
+		B += FBox::BuildAABB(C.Location + Rot.GetForwardVector() * C.Length, Extent * BaseRadius);
 	}
-	return B.TransformBy(LocalToWorld);
+	for (auto& F : Frustums)
+	{
+		FVector Corners[8];
+		F.GetCorners(Corners);
+		for (auto& Corner : Corners)
+		{
+			B += Corner;
+		}
+	}
+	for (auto& P : Polylines)
+	{
+		for (auto& Pt : P.Points)
+		{
+			B += Pt;
+		}
+	}
+
+	LocalShapeBounds = B;
+	bLocalShapeBoundsValid = true;
+	return LocalShapeBounds;
 }
 
+void FStevesEditorVisFrustum::GetCorners(FVector (&OutCorners)[8]) const
+{
+	const FTransform XForm(Rotation, Location);
+	const float TanHalfFOV = FMath::Tan(FMath::DegreesToRadians(FieldOfView * 0.5f));
+	for (int32 i = 0; i < 8; ++i)
+	{
+		const float Dist = (i & 4) ? FarDistance : NearDistance;
+		const float HalfWidth = Dist * TanHalfFOV;
+		const float HalfHeight = HalfWidth / AspectRatio;
+		OutCorners[i] = XForm.TransformPosition(FVector(Dist,
+		                                                (i & 1) ? HalfWidth : -HalfWidth,
+		                                                (i & 2) ? HalfHeight : -HalfHeight));
+	}
+}
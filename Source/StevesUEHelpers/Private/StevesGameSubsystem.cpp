@@ -3,6 +3,7 @@
 #include "StevesUEHelpers.h"
 #include "Engine/AssetManager.h"
 #include "Engine/GameInstance.h"
+#include "Engine/World.h"
 #include "Framework/Application/SlateApplication.h"
 #include "GameFramework/InputSettings.h"
 #include "GameFramework/PlayerController.h"
@@ -12,18 +13,37 @@
 
 //PRAGMA_DISABLE_OPTIMIZATION
 
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice GStevesDumpTextureRenderTargetPoolsCmd(
+    TEXT("Steves.DumpTextureRenderTargetPools"),
+    TEXT("Dump reservation counts, memory, hit rates and leaked reservations for all texture render target pools"),
+    FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+        [](const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+        {
+            if (auto GS = GetStevesGameSubsystem(World))
+                GS->DumpTextureRenderTargetPoolStats(Ar);
+            else
+                Ar.Log(TEXT("No StevesGameSubsystem available for this world"));
+        }));
+
 void UStevesGameSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
     Super::Initialize(Collection);
     CreateInputDetector();
     InitTheme();
     InitForegroundCheck();
+    WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddUObject(this, &UStevesGameSubsystem::OnWorldCleanup);
 }
 
 void UStevesGameSubsystem::Deinitialize()
 {
     Super::Deinitialize();
     DestroyInputDetector();
+    FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+}
+
+void UStevesGameSubsystem::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+    ReleaseWorldTextureRenderTargetPools(World);
 }
 
 
@@ -266,17 +286,13 @@ void UStevesGameSubsystem::SetBrushFromAtlas(FSlateBrush* Brush, TScriptInterfac
 
 FStevesTextureRenderTargetPoolPtr UStevesGameSubsystem::GetTextureRenderTargetPool(FName Name, bool bAutoCreate)
 {
-    // On the assumption there won't be *loads* of pools, not worth a map, just iterate
-    for (auto Tex : TextureRenderTargetPools)
-    {
-        if (Tex->GetName() == Name)
-            return Tex;
-    }
+    if (auto Pool = TextureRenderTargetPools.Find(Name))
+        return *Pool;
 
     if (bAutoCreate)
     {
         FStevesTextureRenderTargetPoolPtr Pool = MakeShared<FStevesTextureRenderTargetPool>(Name, this);
-        TextureRenderTargetPools.Add(Pool);
+        TextureRenderTargetPools.Add(Name, Pool);
         return Pool;
     }
 
@@ -284,6 +300,72 @@ FStevesTextureRenderTargetPoolPtr UStevesGameSubsystem::GetTextureRenderTargetPo
     
 }
 
+FStevesTextureRenderTargetPoolPtr UStevesGameSubsystem::GetWorldTextureRenderTargetPool(UWorld* World, FName Name, bool bAutoCreate)
+{
+    if (!IsValid(World))
+        return nullptr;
+
+    if (bAutoCreate)
+    {
+        auto& Pools = WorldTextureRenderTargetPools.FindOrAdd(World);
+        if (auto Pool = Pools.Find(Name))
+            return *Pool;
+
+        // World owns the textures so they can never outlive it
+        FStevesTextureRenderTargetPoolPtr Pool = MakeShared<FStevesTextureRenderTargetPool>(Name, World);
+        Pools.Add(Name, Pool);
+        return Pool;
+    }
+
+    if (auto Pools = WorldTextureRenderTargetPools.Find(World))
+    {
+        if (auto Pool = Pools->Find(Name))
+            return *Pool;
+    }
+
+    return nullptr;
+}
+
+void UStevesGameSubsystem::ReleaseWorldTextureRenderTargetPools(UWorld* World)
+{
+    FTextureRenderTargetPoolMap Pools;
+    if (WorldTextureRenderTargetPools.RemoveAndCopyValue(World, Pools))
+    {
+        for (auto& Pair : Pools)
+        {
+            // Others may still be holding the pool pointer, make sure textures are let go regardless
+            Pair.Value->DrainPool(true);
+        }
+    }
+}
+
+void UStevesGameSubsystem::GetTextureRenderTargetPoolStats(TArray<FStevesResourcePoolStats>& OutStats) const
+{
+    OutStats.Empty();
+    for (auto& Pair : TextureRenderTargetPools)
+    {
+        Pair.Value->GetStats(OutStats.AddDefaulted_GetRef());
+    }
+    for (auto& WorldPair : WorldTextureRenderTargetPools)
+    {
+        for (auto& Pair : WorldPair.Value)
+        {
+            Pair.Value->GetStats(OutStats.AddDefaulted_GetRef());
+        }
+    }
+}
+
+void UStevesGameSubsystem::DumpTextureRenderTargetPoolStats(FOutputDevice& Ar) const
+{
+    TArray<FStevesResourcePoolStats> AllStats;
+    GetTextureRenderTargetPoolStats(AllStats);
+    Ar.Logf(TEXT("%d texture render target pool(s)"), AllStats.Num());
+    for (auto& Stats : AllStats)
+    {
+        Stats.Dump(Ar);
+    }
+}
+
 
 bool UStevesGameSubsystem::FInputModeDetector::ShouldProcessInputEvents() const
 {
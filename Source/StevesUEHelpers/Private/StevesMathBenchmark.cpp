@@ -0,0 +1,1022 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+
+#include "StevesBPL.h"
+#include "StevesCone.h"
+#include "StevesConeQueryCache.h"
+#include "StevesMathHelpers.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace
+{
+	/// Spheres tested against each cone; the batch tests work on one cone and many spheres
+	constexpr int32 SpheresPerCone = 256;
+	/// Don't flood the log when something's badly wrong
+	constexpr int32 MaxReportedMismatches = 10;
+	/// How far from the world origin the cones are placed normally, and when checking large world precision
+	constexpr float DefaultOriginRange = 10000.f;
+	constexpr float LargeWorldOriginRange = 2000000.f;
+	/// The brute force references are slow, so only check this many cones, and every Nth shape around each
+	constexpr int32 MaxBruteForceCones = 32;
+	constexpr int32 BruteForceStride = 8;
+
+	/// Randomised cones, each with a set of spheres in & around it, and a capsule, box & ray made from each sphere
+	struct FMathTestSet
+	{
+		TArray<FStevesCone> Cones;
+		/// The half-angle each cone was asked for, before FStevesCone clamped it; the free functions are given this
+		TArray<float> HalfAngles;
+		TArray<FStevesSphereArray> Spheres;
+		TArray<FStevesCapsuleArray> Capsules;
+		TArray<FStevesBoxArray> Boxes;
+		TArray<FStevesRayArray> Rays;
+
+		int32 NumTests() const { return Cones.Num() * SpheresPerCone; }
+	};
+
+	/// Other shapes derived from a cone, so the spheres around it cover their surfaces too
+	struct FConeShapes
+	{
+		FVector End;
+		float CapsuleRadius;
+		FVector BoxCentre;
+		FQuat BoxRotation;
+		FVector BoxExtent;
+
+		explicit FConeShapes(const FStevesCone& Cone)
+			: End(Cone.Origin + Cone.Direction * Cone.Length),
+			  CapsuleRadius(Cone.BaseRadius * 0.5f),
+			  BoxCentre((Cone.Origin + End) * 0.5f),
+			  BoxRotation(Cone.Direction.ToOrientationQuat()),
+			  BoxExtent(Cone.Length * 0.5f, Cone.BaseRadius, Cone.BaseRadius * 0.5f)
+		{
+		}
+	};
+
+	FVector GetPerpendicular(const FVector& Dir)
+	{
+		FVector Y, Z;
+		Dir.FindBestAxisVectors(Y, Z);
+		return Y;
+	}
+
+	/// Add spheres which sit exactly on the parts of the cone most likely to disagree: the apex, the rim & the cap
+	void AddEdgeCases(const FStevesCone& Cone, FStevesSphereArray& Spheres)
+	{
+		const FVector Perp = GetPerpendicular(Cone.Direction);
+		const FVector Base = Cone.Origin + Cone.Direction * Cone.Length;
+		const FVector Rim = Base + Perp * Cone.BaseRadius;
+		const float Small = Cone.Length * 0.01f;
+
+		Spheres.Add(Cone.Origin, 0);
+		Spheres.Add(Cone.Origin, Small);
+		Spheres.Add(Cone.Origin - Cone.Direction * Small, Small);
+		Spheres.Add(Cone.Origin - Cone.Direction * Small * 2.f, Small);
+		Spheres.Add(Base, 0);
+		Spheres.Add(Rim, 0);
+		Spheres.Add(Rim, Small);
+		Spheres.Add(Rim + Perp * Small, Small);
+		Spheres.Add(Rim + (Perp + Cone.Direction) * Small, Small);
+		Spheres.Add(Base + Cone.Direction * Small, Small);
+		Spheres.Add(Base + Cone.Direction * Small * 2.f, Small);
+	}
+
+	FMathTestSet MakeTestSet(int32 NumTests, int32 Seed, float OriginRange = DefaultOriginRange)
+	{
+		FRandomStream Rand(Seed);
+		FMathTestSet Set;
+		const int32 NumCones = FMath::Max(1, NumTests / SpheresPerCone);
+		Set.Cones.Reserve(NumCones);
+		Set.HalfAngles.Reserve(NumCones);
+		Set.Spheres.SetNum(NumCones);
+		Set.Capsules.SetNum(NumCones);
+		Set.Boxes.SetNum(NumCones);
+		Set.Rays.SetNum(NumCones);
+
+		for (int32 c = 0; c < NumCones; ++c)
+		{
+			// Mostly ordinary cones, but some at & past the limits of the angle range, which get clamped
+			float HalfAngle;
+			switch (c % 16)
+			{
+			case 0: HalfAngle = 0; break;
+			case 1: HalfAngle = HALF_PI; break;
+			case 2: HalfAngle = PI * 0.75f; break;
+			case 3: HalfAngle = KINDA_SMALL_NUMBER; break;
+			default: HalfAngle = Rand.FRandRange(FMath::DegreesToRadians(1.f), FMath::DegreesToRadians(89.f)); break;
+			}
+			const FStevesCone Cone(Rand.GetUnitVector() * Rand.FRandRange(0, OriginRange), Rand.GetUnitVector(), HalfAngle,
+			                       Rand.FRandRange(10.f, 2000.f));
+			Set.Cones.Add(Cone);
+			Set.HalfAngles.Add(HalfAngle);
+
+			FStevesSphereArray& Spheres = Set.Spheres[c];
+			Spheres.Reserve(SpheresPerCone);
+			AddEdgeCases(Cone, Spheres);
+
+			// Spread the rest over a region a bit larger than the cone, so that about half overlap
+			const float Spread = FMath::Min(Cone.BaseRadius, Cone.Length) + Cone.Length * 0.25f;
+			while (Spheres.Num() < SpheresPerCone)
+			{
+				const FVector Centre = Cone.Origin + Cone.Direction * Rand.FRandRange(-0.25f, 1.25f) * Cone.Length +
+					Rand.GetUnitVector() * Rand.FRandRange(0, Spread);
+				Spheres.Add(Centre, Rand.FRandRange(0, Cone.Length * 0.25f));
+			}
+
+			// A capsule & a box about the size of each sphere, and a ray from its centre, half of them aimed into the
+			// cone & half in random directions
+			FStevesCapsuleArray& Capsules = Set.Capsules[c];
+			FStevesBoxArray& Boxes = Set.Boxes[c];
+			FStevesRayArray& Rays = Set.Rays[c];
+			Capsules.Reserve(SpheresPerCone);
+			Boxes.Reserve(SpheresPerCone);
+			Rays.Reserve(SpheresPerCone);
+			for (int32 i = 0; i < Spheres.Num(); ++i)
+			{
+				const FVector Centre(Spheres.X[i], Spheres.Y[i], Spheres.Z[i]);
+				const float Radius = Spheres.Radius[i];
+
+				const FVector HalfAxis = Rand.GetUnitVector() * Rand.FRandRange(0, Cone.Length * 0.25f);
+				Capsules.Add(Centre - HalfAxis, Centre + HalfAxis, Radius * 0.5f);
+
+				FVector Extent;
+				Extent.X = Radius * Rand.FRandRange(0.5f, 1.5f);
+				Extent.Y = Radius * Rand.FRandRange(0.5f, 1.5f);
+				Extent.Z = Radius * Rand.FRandRange(0.5f, 1.5f);
+				Boxes.Add(FBox::BuildAABB(Centre, Extent));
+
+				const FVector Target = Cone.Origin + Cone.Direction * Rand.FRandRange(0, Cone.Length) +
+					Rand.GetUnitVector() * Rand.FRandRange(0, Cone.BaseRadius);
+				const FVector Dir = i % 2 ? (Target - Centre).GetSafeNormal() : Rand.GetUnitVector();
+				Rays.Add(Centre, Dir.IsZero() ? Cone.Direction : Dir);
+			}
+		}
+		return Set;
+	}
+
+	bool GetMaskBit(const TArray<uint32>& Mask, int32 Index)
+	{
+		return (Mask[Index >> 5] & (1u << (Index & 31))) != 0;
+	}
+
+	/// Compare a batch result against its scalar reference for every sphere, logging the first few differences
+	template <typename TFunc>
+	int32 CountMismatches(const TCHAR* Name, int32 ConeIndex, const FStevesSphereArray& Spheres,
+	                      const TArray<uint32>& Mask, int32& NumReported, FOutputDevice& Ar, TFunc Reference)
+	{
+		int32 Mismatches = 0;
+		for (int32 i = 0; i < Spheres.Num(); ++i)
+		{
+			const FVector Centre(Spheres.X[i], Spheres.Y[i], Spheres.Z[i]);
+			const bool bExpected = Reference(Centre, Spheres.Radius[i]);
+			if (GetMaskBit(Mask, i) != bExpected)
+			{
+				++Mismatches;
+				if (NumReported++ < MaxReportedMismatches)
+				{
+					Ar.Logf(TEXT("  %s mismatch: cone %d sphere %d centre %s radius %f, expected %d"), Name, ConeIndex,
+					        i, *Centre.ToString(), Spheres.Radius[i], bExpected ? 1 : 0);
+				}
+			}
+		}
+		return Mismatches;
+	}
+
+	/// Same as CountMismatches, for shapes other than spheres
+	template <typename TFunc>
+	int32 CountItemMismatches(const TCHAR* Name, int32 ConeIndex, int32 Num, const TArray<uint32>& Mask,
+	                          int32& NumReported, FOutputDevice& Ar, TFunc Reference)
+	{
+		int32 Mismatches = 0;
+		for (int32 i = 0; i < Num; ++i)
+		{
+			const bool bExpected = Reference(i);
+			if (GetMaskBit(Mask, i) != bExpected)
+			{
+				++Mismatches;
+				if (NumReported++ < MaxReportedMismatches)
+				{
+					Ar.Logf(TEXT("  %s mismatch: cone %d item %d, expected %d"), Name, ConeIndex, i,
+					        bExpected ? 1 : 0);
+				}
+			}
+		}
+		return Mismatches;
+	}
+
+	/// Furthest a ray could travel & still be in a cone
+	float GetMaxRayDistance(const FStevesCone& Cone, const FVector& RayOrigin)
+	{
+		return FVector::Dist(RayOrigin, Cone.Origin) + Cone.Length + Cone.BaseRadius;
+	}
+
+	/// How deep a ray gets into a cone, sampled; rays which only graze it can legitimately disagree
+	float GetSampledRayDepth(const FStevesCone& Cone, const FVector& RayOrigin, const FVector& RayDir)
+	{
+		constexpr int32 NumSteps = 1024;
+		const float MaxT = GetMaxRayDistance(Cone, RayOrigin);
+		float Depth = -MAX_flt;
+		for (int32 Step = 0; Step <= NumSteps; ++Step)
+		{
+			Depth = FMath::Max(Depth, -Cone.GetSignedDistance(RayOrigin + RayDir * (MaxT * Step / NumSteps)));
+		}
+		return Depth;
+	}
+
+	/// Returns the total number of mismatches
+	int32 RunMathVerify(int32 NumTests, int32 Seed, FOutputDevice& Ar)
+	{
+		const FMathTestSet Set = MakeTestSet(NumTests, Seed);
+		Ar.Logf(TEXT("Verifying StevesMathHelpers: %d cones x %d spheres, seed %d"), Set.Cones.Num(), SpheresPerCone,
+		        Seed);
+
+		enum EVariant
+		{
+			ConeStruct, ConeRelative, ConeBatch, CapsuleBatch, SegmentBatch, BoxBatch, CapsuleConeBatch, BoxConeBatch,
+			RayConeBatch, NumVariants
+		};
+		const TCHAR* Names[NumVariants] = {
+			TEXT("FStevesCone::Overlaps"), TEXT("SphereOverlapConeT<float>"), TEXT("SphereOverlapConeBatch"),
+			TEXT("SphereOverlapCapsuleBatch"), TEXT("SegmentOverlapSphereBatch"), TEXT("SphereOverlapBoxBatch"),
+			TEXT("CapsuleOverlapConeBatch"), TEXT("BoxOverlapConeBatch"), TEXT("RayIntersectConeBatch")
+		};
+		int32 Mismatches[NumVariants] = {};
+		int32 NumReported = 0;
+		TArray<uint32> Mask;
+
+		for (int32 c = 0; c < Set.Cones.Num(); ++c)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			const float HalfAngle = Set.HalfAngles[c];
+			const FStevesSphereArray& Spheres = Set.Spheres[c];
+
+			// FStevesCone has no mask output, so build one
+			Mask.Reset();
+			Mask.SetNumZeroed((Spheres.Num() + 31) / 32);
+			for (int32 i = 0; i < Spheres.Num(); ++i)
+			{
+				if (Cone.Overlaps(FVector(Spheres.X[i], Spheres.Y[i], Spheres.Z[i]), Spheres.Radius[i]))
+					Mask[i >> 5] |= 1u << (i & 31);
+			}
+			auto ConeReference = [&](const FVector& Centre, float Radius)
+			{
+				return StevesMathHelpers::SphereOverlapCone(Cone.Origin, Cone.Direction, HalfAngle, Cone.Length,
+				                                            Centre, Radius);
+			};
+			Mismatches[ConeStruct] += CountMismatches(Names[ConeStruct], c, Spheres, Mask, NumReported, Ar,
+			                                          ConeReference);
+
+			Mask.Reset();
+			Mask.SetNumZeroed((Spheres.Num() + 31) / 32);
+			for (int32 i = 0; i < Spheres.Num(); ++i)
+			{
+				if (StevesMathHelpers::SphereOverlapConeT<float>(Cone.Origin, Cone.Direction, HalfAngle, Cone.Length,
+				                                                 FVector(Spheres.X[i], Spheres.Y[i], Spheres.Z[i]),
+				                                                 Spheres.Radius[i]))
+					Mask[i >> 5] |= 1u << (i & 31);
+			}
+			Mismatches[ConeRelative] += CountMismatches(Names[ConeRelative], c, Spheres, Mask, NumReported, Ar,
+			                                            ConeReference);
+
+			StevesMathHelpers::SphereOverlapConeBatch(Cone.Origin, Cone.Direction, HalfAngle, Cone.Length, Spheres,
+			                                          Mask);
+			Mismatches[ConeBatch] += CountMismatches(Names[ConeBatch], c, Spheres, Mask, NumReported, Ar,
+			                                         ConeReference);
+
+			const FConeShapes Shapes(Cone);
+			StevesMathHelpers::SphereOverlapCapsuleBatch(Cone.Origin, Shapes.End, Shapes.CapsuleRadius, Spheres, Mask);
+			Mismatches[CapsuleBatch] += CountMismatches(Names[CapsuleBatch], c, Spheres, Mask, NumReported, Ar,
+				[&](const FVector& Centre, float Radius)
+				{
+					return StevesMathHelpers::SphereOverlapCapsule(Centre, Radius, Cone.Origin, Shapes.End,
+					                                               Shapes.CapsuleRadius);
+				});
+
+			StevesMathHelpers::SegmentOverlapSphereBatch(Cone.Origin, Shapes.End, Spheres, Mask);
+			Mismatches[SegmentBatch] += CountMismatches(Names[SegmentBatch], c, Spheres, Mask, NumReported, Ar,
+				[&](const FVector& Centre, float Radius)
+				{
+					return StevesMathHelpers::SegmentOverlapSphere(Cone.Origin, Shapes.End, Centre, Radius);
+				});
+
+			StevesMathHelpers::SphereOverlapBoxBatch(Shapes.BoxCentre, Shapes.BoxRotation, Shapes.BoxExtent, Spheres,
+			                                         Mask);
+			Mismatches[BoxBatch] += CountMismatches(Names[BoxBatch], c, Spheres, Mask, NumReported, Ar,
+				[&](const FVector& Centre, float Radius)
+				{
+					return StevesMathHelpers::SphereOverlapBox(Shapes.BoxCentre, Shapes.BoxRotation, Shapes.BoxExtent,
+					                                           Centre, Radius);
+				});
+
+			const FStevesCapsuleArray& Capsules = Set.Capsules[c];
+			StevesMathHelpers::CapsuleOverlapConeBatch(Cone.Origin, Cone.Direction, HalfAngle, Cone.Length,
+			                                           Capsules, Mask);
+			Mismatches[CapsuleConeBatch] += CountItemMismatches(Names[CapsuleConeBatch], c, Capsules.Num(), Mask,
+			                                                    NumReported, Ar, [&](int32 i)
+			{
+				return StevesMathHelpers::CapsuleOverlapCone(Cone.Origin, Cone.Direction, HalfAngle, Cone.Length,
+				                                             Capsules.GetStart(i), Capsules.GetEnd(i),
+				                                             Capsules.Radius[i]);
+			});
+
+			const FStevesBoxArray& Boxes = Set.Boxes[c];
+			StevesMathHelpers::BoxOverlapConeBatch(Cone.Origin, Cone.Direction, HalfAngle, Cone.Length, Boxes,
+			                                       Mask);
+			Mismatches[BoxConeBatch] += CountItemMismatches(Names[BoxConeBatch], c, Boxes.Num(), Mask, NumReported,
+			                                                Ar, [&](int32 i)
+			{
+				return StevesMathHelpers::BoxOverlapCone(Cone.Origin, Cone.Direction, HalfAngle, Cone.Length,
+				                                         Boxes.GetBox(i));
+			});
+
+			// The SIMD ray test rounds differently, so only rays which get properly inside (or well clear of) the
+			// cone must agree, and hit distances must agree to float precision
+			const FStevesRayArray& Rays = Set.Rays[c];
+			TArray<float> Distances;
+			StevesMathHelpers::RayIntersectConeBatch(Rays, Cone.Origin, Cone.Direction, HalfAngle, Cone.Length,
+			                                         Mask, Distances);
+			for (int32 i = 0; i < Rays.Num(); ++i)
+			{
+				const FVector RayOrigin = Rays.GetOrigin(i);
+				const FVector RayDir = Rays.GetDir(i);
+				const float Tolerance = KINDA_SMALL_NUMBER * GetMaxRayDistance(Cone, RayOrigin);
+				float Expected = MAX_flt;
+				const bool bExpected = StevesMathHelpers::RayIntersectCone(RayOrigin, RayDir, Cone.Origin,
+				                                                           Cone.Direction, HalfAngle,
+				                                                           Cone.Length, Expected);
+				const bool bHit = GetMaskBit(Mask, i);
+				const bool bWrong = bHit != bExpected
+					                    ? FMath::Abs(GetSampledRayDepth(Cone, RayOrigin, RayDir)) > Tolerance
+					                    : bHit && FMath::Abs(Distances[i] - Expected) > Tolerance;
+				if (bWrong)
+				{
+					++Mismatches[RayConeBatch];
+					if (NumReported++ < MaxReportedMismatches)
+					{
+						Ar.Logf(TEXT("  %s mismatch: cone %d ray %d, expected %d at %f, got %d at %f"),
+						        Names[RayConeBatch], c, i, bExpected ? 1 : 0, Expected, bHit ? 1 : 0, Distances[i]);
+					}
+				}
+			}
+		}
+
+		int32 Total = 0;
+		for (int32 v = 0; v < NumVariants; ++v)
+		{
+			Ar.Logf(TEXT("  %-28s %d / %d mismatches"), Names[v], Mismatches[v], Set.NumTests());
+			Total += Mismatches[v];
+		}
+		Ar.Log(Total ? TEXT("FAILED: results differ from the scalar reference") : TEXT("PASSED"));
+		return Total;
+	}
+
+	/// Points on the surface & through the volume of a cone, for brute force references
+	struct FConeSamples
+	{
+		TArray<FVector> Surface;
+		TArray<FVector> Volume;
+		/// Every point on the surface is within this of a surface sample
+		float Spacing;
+
+		explicit FConeSamples(const FStevesCone& Cone)
+		{
+			constexpr int32 NumAround = 32;
+			constexpr int32 NumAlong = 32;
+			constexpr int32 NumAcrossBase = 8;
+			FVector Y, Z;
+			Cone.Direction.FindBestAxisVectors(Y, Z);
+			auto PointAt = [&](float Axial, float Radial, float Angle)
+			{
+				return Cone.Origin + Cone.Direction * Axial + (Y * FMath::Cos(Angle) + Z * FMath::Sin(Angle)) * Radial;
+			};
+
+			for (int32 a = 0; a < NumAround; ++a)
+			{
+				const float Angle = 2.f * PI * a / NumAround;
+				for (int32 i = 0; i <= NumAlong; ++i)
+				{
+					const float Axial = Cone.Length * i / NumAlong;
+					Surface.Add(PointAt(Axial, Axial * Cone.TanHalfAngle, Angle));
+					if (i % 4 == 0)
+					{
+						for (int32 j = 0; j < 4; ++j)
+						{
+							Volume.Add(PointAt(Axial, Axial * Cone.TanHalfAngle * j / 4, Angle));
+						}
+					}
+				}
+				for (int32 j = 0; j < NumAcrossBase; ++j)
+				{
+					Surface.Add(PointAt(Cone.Length, Cone.BaseRadius * j / NumAcrossBase, Angle));
+				}
+			}
+
+			// Diagonal of the largest cell between samples, on the side or the base
+			const float SlantLength = FMath::Sqrt(Cone.Length * Cone.Length + Cone.BaseRadius * Cone.BaseRadius);
+			const float AroundStep = 2.f * PI * Cone.BaseRadius / NumAround;
+			const float AlongStep = FMath::Max(SlantLength / NumAlong, Cone.BaseRadius / NumAcrossBase);
+			Spacing = FMath::Sqrt(AroundStep * AroundStep + AlongStep * AlongStep);
+		}
+
+		/// Distance from a point outside the cone to its surface; over by up to Spacing
+		float GetDistance(const FVector& Point) const
+		{
+			float DistSq = MAX_flt;
+			for (const FVector& Sample : Surface)
+			{
+				DistSq = FMath::Min(DistSq, FVector::DistSquared(Point, Sample));
+			}
+			return FMath::Sqrt(DistSq);
+		}
+	};
+
+	/// Returns whether a point is in a cone, allowing for float error
+	bool IsInCone(const FStevesCone& Cone, const FVector& Point, float Epsilon)
+	{
+		const FVector V = Point - Cone.Origin;
+		const float Axial = FVector::DotProduct(V, Cone.Direction);
+		const float Radial = FMath::Sqrt(FMath::Max(V.SizeSquared() - Axial * Axial, 0.f));
+		// Error in the axial distance is magnified by the tangent for wide cones
+		return Axial >= -Epsilon && Axial <= Cone.Length + Epsilon &&
+			Radial <= (Axial + Epsilon) * Cone.TanHalfAngle + Epsilon;
+	}
+
+	/**
+	 * Check the cone functions which aren't otherwise verified against densely sampled references: closest points &
+	 * signed distances from the sphere centres, and overlaps with the test set's capsules, boxes & rays. Cases within
+	 * the sampling error of the answer changing are too close to call, and skipped. Returns the number wrong.
+	 */
+	int32 RunBruteForceCheck(int32 NumTests, int32 Seed, FOutputDevice& Ar)
+	{
+		const FMathTestSet Set = MakeTestSet(NumTests, Seed);
+		const int32 NumCones = FMath::Min(Set.Cones.Num(), MaxBruteForceCones);
+		Ar.Logf(TEXT("Checking against brute force references: %d cones, every %dth shape"), NumCones,
+		        BruteForceStride);
+
+		enum ECheck { ClosestPoint, SignedDistance, Capsule, Box, Ray, NumChecks };
+		const TCHAR* Names[NumChecks] = {
+			TEXT("ClosestPointOnCone"), TEXT("GetSignedDistance"), TEXT("CapsuleOverlapCone"), TEXT("BoxOverlapCone"),
+			TEXT("RayIntersectCone")
+		};
+		int32 Failures[NumChecks] = {};
+		int32 Tested[NumChecks] = {};
+		int32 Skipped[NumChecks] = {};
+		int32 NumReported = 0;
+		auto Check = [&](ECheck Which, bool bCorrect, int32 ConeIndex, int32 Index)
+		{
+			++Tested[Which];
+			if (!bCorrect)
+			{
+				++Failures[Which];
+				if (NumReported++ < MaxReportedMismatches)
+					Ar.Logf(TEXT("  %s wrong: cone %d item %d"), Names[Which], ConeIndex, Index);
+			}
+		};
+
+		for (int32 c = 0; c < NumCones; ++c)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			const FConeSamples Samples(Cone);
+			// Float error from working away from the world origin
+			const float Epsilon = 1e-5f * (Cone.Origin.GetAbsMax() + Cone.Length);
+			auto GetSampledDistance = [&](const FVector& Point)
+			{
+				return Cone.Contains(Point) ? 0.f : Samples.GetDistance(Point);
+			};
+
+			for (int32 i = 0; i < SpheresPerCone; i += BruteForceStride)
+			{
+				const FStevesSphereArray& Spheres = Set.Spheres[c];
+				const FVector Point(Spheres.X[i], Spheres.Y[i], Spheres.Z[i]);
+				const bool bInside = Cone.Contains(Point);
+				const float SurfaceDistance = Samples.GetDistance(Point);
+
+				// Nothing on the surface can be closer than the closest point, which is no further than the sampling
+				const FVector Closest = Cone.GetClosestPointTo(Point);
+				const float ClosestDistance = FVector::Dist(Point, Closest);
+				Check(ClosestPoint, bInside
+					                    ? Closest.Equals(Point, Epsilon)
+					                    : IsInCone(Cone, Closest, Epsilon) &&
+					                    ClosestDistance <= SurfaceDistance + Epsilon &&
+					                    ClosestDistance >= SurfaceDistance - Samples.Spacing - Epsilon, c, i);
+
+				// Inside, the signed distance is allowed to underestimate near the rim
+				const float Signed = Cone.GetSignedDistance(Point);
+				Check(SignedDistance, bInside
+					                      ? Signed <= Epsilon && -Signed <= SurfaceDistance + Epsilon
+					                      : FMath::Abs(Signed - SurfaceDistance) <= Samples.Spacing + Epsilon, c, i);
+
+				// Capsules: the closest sample along the segment
+				{
+					constexpr int32 NumSteps = 64;
+					const FStevesCapsuleArray& Capsules = Set.Capsules[c];
+					const FVector Start = Capsules.GetStart(i);
+					const FVector End = Capsules.GetEnd(i);
+					float Distance = MAX_flt;
+					for (int32 Step = 0; Step <= NumSteps && Distance > 0; ++Step)
+					{
+						Distance = FMath::Min(Distance, GetSampledDistance(FMath::Lerp(Start, End, float(Step) / NumSteps)));
+					}
+					const float Tolerance = Samples.Spacing + FVector::Dist(Start, End) * 0.5f / NumSteps + Epsilon;
+					if (FMath::Abs(Distance - Capsules.Radius[i]) <= Tolerance)
+					{
+						++Skipped[Capsule];
+					}
+					else
+					{
+						Check(Capsule, StevesMathHelpers::CapsuleOverlapCone(
+							      Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length, Start, End,
+							      Capsules.Radius[i]) == (Distance < Capsules.Radius[i]), c, i);
+					}
+				}
+
+				// Boxes: any sample of one inside the other, or the closest of a grid over the box
+				{
+					constexpr int32 NumSteps = 4;
+					const FBox TestBox = Set.Boxes[c].GetBox(i);
+					bool bOverlaps = Samples.Volume.ContainsByPredicate([&](const FVector& V)
+					{
+						return TestBox.IsInsideOrOn(V);
+					});
+					float Distance = MAX_flt;
+					for (int32 x = 0; x <= NumSteps && !bOverlaps; ++x)
+					{
+						for (int32 y = 0; y <= NumSteps && !bOverlaps; ++y)
+						{
+							for (int32 z = 0; z <= NumSteps && !bOverlaps; ++z)
+							{
+								const FVector GridPoint = TestBox.Min + TestBox.GetSize() * FVector(x, y, z) / NumSteps;
+								Distance = FMath::Min(Distance, GetSampledDistance(GridPoint));
+								bOverlaps = Distance <= 0;
+							}
+						}
+					}
+					const float Tolerance = Samples.Spacing + (TestBox.GetSize() * 0.5f / NumSteps).Size() + Epsilon;
+					if (!bOverlaps && Distance <= Tolerance)
+					{
+						++Skipped[Box];
+					}
+					else
+					{
+						Check(Box, StevesMathHelpers::BoxOverlapCone(Cone.Origin, Cone.Direction, Cone.HalfAngle,
+						                                             Cone.Length, TestBox) == bOverlaps, c, i);
+					}
+				}
+
+				// Rays: march along until inside; a hit must be on the cone, and no later than that
+				{
+					constexpr int32 NumSteps = 2048;
+					const FStevesRayArray& Rays = Set.Rays[c];
+					const FVector RayOrigin = Rays.GetOrigin(i);
+					const FVector RayDir = Rays.GetDir(i);
+					const float MaxT = GetMaxRayDistance(Cone, RayOrigin);
+					float FirstInside = -1;
+					for (int32 Step = 0; Step <= NumSteps && FirstInside < 0; ++Step)
+					{
+						const float T = MaxT * Step / NumSteps;
+						if (Cone.Contains(RayOrigin + RayDir * T))
+							FirstInside = T;
+					}
+
+					float HitDistance = 0;
+					const bool bHit = StevesMathHelpers::RayIntersectCone(RayOrigin, RayDir, Cone.Origin, Cone.Direction,
+					                                                      Cone.HalfAngle, Cone.Length, HitDistance);
+					// Solving the quadratic loses precision in proportion to the distance from the apex
+					const float Tolerance = KINDA_SMALL_NUMBER * MaxT;
+					if (!bHit && FirstInside >= 0 && GetSampledRayDepth(Cone, RayOrigin, RayDir) <= Tolerance)
+					{
+						++Skipped[Ray];
+					}
+					else
+					{
+						Check(Ray, bHit
+							           ? IsInCone(Cone, RayOrigin + RayDir * HitDistance, Tolerance) &&
+							           (FirstInside < 0 || HitDistance <= FirstInside + Tolerance)
+							           : FirstInside < 0, c, i);
+					}
+				}
+			}
+		}
+
+		int32 Total = 0;
+		for (int32 v = 0; v < NumChecks; ++v)
+		{
+			Ar.Logf(TEXT("  %-28s %d / %d wrong, %d too close to call"), Names[v], Failures[v], Tested[v],
+			        Skipped[v]);
+			Total += Failures[v];
+		}
+		Ar.Log(Total ? TEXT("FAILED: results differ from the brute force reference") : TEXT("PASSED"));
+		return Total;
+	}
+
+	/**
+	 * Check cones at & past the limits of the angle range behave as documented on ClampConeHalfAngle, the same
+	 * whichever way they're tested: a half-angle of 0 or less is a very thin cone, and 90 degrees or more a very wide,
+	 * flat one. Returns the number of wrong answers.
+	 */
+	int32 RunConeLimitsCheck(FOutputDevice& Ar)
+	{
+		Ar.Log(TEXT("Checking cones at the limits of the angle range"));
+		const FVector Origin(100.f, -200.f, 300.f);
+		const FVector Dir = FVector(1.f, 2.f, -1.f).GetSafeNormal();
+		const FVector Perp = GetPerpendicular(Dir);
+		const float Length = 100.f;
+		const float HalfAngles[] = {-0.5f, 0, HALF_PI, PI * 0.75f};
+
+		int32 Failures = 0;
+		for (const float HalfAngle : HalfAngles)
+		{
+			const FStevesCone Cone(Origin, Dir, HalfAngle, Length);
+			if (Cone.HalfAngle != StevesMathHelpers::ClampConeHalfAngle(HalfAngle))
+			{
+				++Failures;
+				Ar.Logf(TEXT("  Half-angle %f clamped to %f by FStevesCone"), HalfAngle, Cone.HalfAngle);
+			}
+
+			const float ConeAngle = FMath::RadiansToDegrees(HalfAngle * 2.f);
+			const FStevesCone BPLCone = UStevesBPL::MakeCone(Origin, Dir, ConeAngle, Length);
+			auto Probe = [&](const TCHAR* Name, const FVector& Centre, float Radius, bool bExpected)
+			{
+				const bool Results[] = {
+					StevesMathHelpers::SphereOverlapCone(Origin, Dir, HalfAngle, Length, Centre, Radius),
+					StevesMathHelpers::SphereOverlapConeT<float>(Origin, Dir, HalfAngle, Length, Centre, Radius),
+					StevesMathHelpers::SphereOverlapConeT<double>(Origin, Dir, HalfAngle, Length, Centre, Radius),
+					Cone.Overlaps(Centre, Radius),
+					UStevesBPL::SphereOverlapCone(Origin, Dir, ConeAngle, Length, Centre, Radius),
+					UStevesBPL::ConeOverlapsSphere(BPLCone, Centre, Radius)
+				};
+				for (int32 i = 0; i < UE_ARRAY_COUNT(Results); ++i)
+				{
+					if (Results[i] != bExpected)
+					{
+						++Failures;
+						Ar.Logf(TEXT("  Half-angle %f, %s: test %d gave %d"), HalfAngle, Name, i, Results[i] ? 1 : 0);
+					}
+				}
+			};
+
+			const FVector Middle = Origin + Dir * Length * 0.5f;
+			Probe(TEXT("on the axis"), Middle, 0, true);
+			Probe(TEXT("behind the apex"), Origin - Dir * 10.f, 1.f, false);
+			Probe(TEXT("past the base"), Origin + Dir * (Length + 10.f), 1.f, false);
+			if (HalfAngle < HALF_PI)
+				Probe(TEXT("beside the thin cone"), Middle + Perp * 10.f, 1.f, false);
+			else
+				Probe(TEXT("far out in the wide cone"), Middle + Perp * 1000.f, 0, true);
+		}
+		Ar.Log(Failures ? TEXT("FAILED: cones at the angle limits are inconsistent") : TEXT("PASSED"));
+		return Failures;
+	}
+
+	/// Compare the float tests against SphereOverlapConeT<double> far from the origin. Differences here are
+	/// precision loss rather than bugs, so they're reported but don't fail the verify.
+	void RunLargeWorldCheck(int32 NumTests, int32 Seed, FOutputDevice& Ar)
+	{
+		const FMathTestSet Set = MakeTestSet(NumTests, Seed, LargeWorldOriginRange);
+		Ar.Logf(TEXT("Large world precision, cones up to %.0f from the origin, against SphereOverlapConeT<double>:"),
+		        LargeWorldOriginRange);
+
+		enum EVariant { WorldSpace, Relative, ConeStruct, NumVariants };
+		const TCHAR* Names[NumVariants] = {
+			TEXT("SphereOverlapCone"), TEXT("SphereOverlapConeT<float>"), TEXT("FStevesCone::Overlaps")
+		};
+		int32 Mismatches[NumVariants] = {};
+		for (int32 c = 0; c < Set.Cones.Num(); ++c)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			const FStevesSphereArray& Spheres = Set.Spheres[c];
+			for (int32 i = 0; i < Spheres.Num(); ++i)
+			{
+				const FVector Centre(Spheres.X[i], Spheres.Y[i], Spheres.Z[i]);
+				const float Radius = Spheres.Radius[i];
+				const bool bExpected = StevesMathHelpers::SphereOverlapConeT<double>(
+					Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length, Centre, Radius);
+				Mismatches[WorldSpace] += StevesMathHelpers::SphereOverlapCone(
+					Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length, Centre, Radius) != bExpected;
+				Mismatches[Relative] += StevesMathHelpers::SphereOverlapConeT<float>(
+					Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length, Centre, Radius) != bExpected;
+				Mismatches[ConeStruct] += Cone.Overlaps(Centre, Radius) != bExpected;
+			}
+		}
+		for (int32 v = 0; v < NumVariants; ++v)
+		{
+			Ar.Logf(TEXT("  %-28s %d / %d differ"), Names[v], Mismatches[v], Set.NumTests());
+		}
+	}
+
+	/// Move a cone & some targets around for a while, and check the cached answers are always the same as testing.
+	/// Returns the number of mismatches.
+	int32 RunConeCacheCheck(int32 NumTests, int32 Seed, FOutputDevice& Ar)
+	{
+		constexpr int32 NumFrames = 100;
+		const int32 NumTargets = FMath::Max(1, NumTests / NumFrames);
+		FRandomStream Rand(Seed);
+
+		TArray<FVector> Positions, Velocities;
+		for (int32 i = 0; i < NumTargets; ++i)
+		{
+			Positions.Add(FVector(Rand.FRandRange(-100.f, 1100.f), Rand.FRandRange(-600.f, 600.f),
+			                      Rand.FRandRange(-600.f, 600.f)));
+			// Mostly slow, some fast
+			Velocities.Add(Rand.GetUnitVector() * (i % 10 ? Rand.FRandRange(0, 2.f) : Rand.FRandRange(10.f, 50.f)));
+		}
+
+		TStevesConeQueryCache<int32> Cache;
+		int32 Mismatches = 0;
+		for (int32 f = 0; f < NumFrames; ++f)
+		{
+			// A slowly turning & moving cone, as on a patrolling AI
+			const float Yaw = f * 0.01f;
+			const FStevesCone Cone(FVector(f * 0.5f, 0, 0), FVector(FMath::Cos(Yaw), FMath::Sin(Yaw), 0),
+			                       FMath::DegreesToRadians(30.f), 1000.f);
+			Cache.SetCone(Cone);
+			for (int32 i = 0; i < NumTargets; ++i)
+			{
+				Positions[i] += Velocities[i];
+				const float Radius = 20.f;
+				Mismatches += Cache.Overlaps(i, Positions[i], Radius) != Cone.Overlaps(Positions[i], Radius);
+			}
+		}
+
+		const int32 Total = Cache.GetNumTested() + Cache.GetNumSkipped();
+		Ar.Logf(TEXT("TStevesConeQueryCache: %d targets x %d frames, %d mismatches, %.1f%% of tests skipped"),
+		        NumTargets, NumFrames, Mismatches, Total ? 100.0 * Cache.GetNumSkipped() / Total : 0.0);
+		Ar.Log(Mismatches ? TEXT("FAILED: cached results differ") : TEXT("PASSED"));
+		return Mismatches;
+	}
+
+	void RunMathBenchmark(int32 NumTests, int32 Seed, FOutputDevice& Ar)
+	{
+		const FMathTestSet Set = MakeTestSet(NumTests, Seed);
+		const int32 Count = Set.NumTests();
+
+		struct FResult
+		{
+			const TCHAR* Name;
+			double Seconds;
+			int32 Overlaps;
+		};
+		TArray<FResult> Results;
+		// The overlap count is reported so that none of the work can be optimised away
+		auto Time = [&](const TCHAR* Name, auto Func)
+		{
+			const double Start = FPlatformTime::Seconds();
+			const int32 Overlaps = Func();
+			Results.Add(FResult {Name, FPlatformTime::Seconds() - Start, Overlaps});
+		};
+
+		TArray<FConeShapes> Shapes;
+		for (const FStevesCone& Cone : Set.Cones)
+		{
+			Shapes.Add(FConeShapes(Cone));
+		}
+
+		// Test(ConeIndex, Index) for every shape around every cone
+		auto TimeScalar = [&](const TCHAR* Name, auto Test)
+		{
+			Time(Name, [&]()
+			{
+				int32 Overlaps = 0;
+				for (int32 c = 0; c < Set.Cones.Num(); ++c)
+				{
+					for (int32 i = 0; i < SpheresPerCone; ++i)
+					{
+						Overlaps += Test(c, i) ? 1 : 0;
+					}
+				}
+				return Overlaps;
+			});
+		};
+		// Test(ConeIndex, Mask) for each cone
+		auto TimeBatch = [&](const TCHAR* Name, auto Test)
+		{
+			Time(Name, [&]()
+			{
+				int32 Overlaps = 0;
+				TArray<uint32> Mask;
+				for (int32 c = 0; c < Set.Cones.Num(); ++c)
+				{
+					Test(c, Mask);
+					for (uint32 Word : Mask)
+					{
+						Overlaps += FPlatformMath::CountBits(Word);
+					}
+				}
+				return Overlaps;
+			});
+		};
+		// Test(ConeIndex, Cone, Centre, Radius) for every sphere around every cone
+		auto TimeSpheres = [&](const TCHAR* Name, auto Test)
+		{
+			TimeScalar(Name, [&](int32 c, int32 i)
+			{
+				const FStevesSphereArray& Spheres = Set.Spheres[c];
+				return Test(c, Set.Cones[c], FVector(Spheres.X[i], Spheres.Y[i], Spheres.Z[i]), Spheres.Radius[i]);
+			});
+		};
+
+		TimeSpheres(TEXT("SphereOverlapCone"), [](int32, const FStevesCone& Cone, const FVector& Centre, float Radius)
+		{
+			return StevesMathHelpers::SphereOverlapCone(Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length,
+			                                            Centre, Radius);
+		});
+		TimeSpheres(TEXT("SphereOverlapConeT<float>"), [](int32, const FStevesCone& Cone, const FVector& Centre, float Radius)
+		{
+			return StevesMathHelpers::SphereOverlapConeT<float>(Cone.Origin, Cone.Direction, Cone.HalfAngle,
+			                                                    Cone.Length, Centre, Radius);
+		});
+		TimeSpheres(TEXT("SphereOverlapConeT<double>"),
+		            [](int32, const FStevesCone& Cone, const FVector& Centre, float Radius)
+		{
+			return StevesMathHelpers::SphereOverlapConeT<double>(Cone.Origin, Cone.Direction, Cone.HalfAngle,
+			                                                     Cone.Length, Centre, Radius);
+		});
+		TimeSpheres(TEXT("FStevesCone::Overlaps"), [](int32, const FStevesCone& Cone, const FVector& Centre, float Radius)
+		{
+			return Cone.Overlaps(Centre, Radius);
+		});
+		TimeBatch(TEXT("SphereOverlapConeBatch"), [&](int32 c, TArray<uint32>& Mask)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			StevesMathHelpers::SphereOverlapConeBatch(Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length,
+			                                          Set.Spheres[c], Mask);
+		});
+
+		// Spheres against the shapes made from each cone
+		TimeSpheres(TEXT("SphereOverlapCapsule"), [&](int32 c, const FStevesCone& Cone, const FVector& Centre, float Radius)
+		{
+			const FConeShapes& S = Shapes[c];
+			return StevesMathHelpers::SphereOverlapCapsule(Centre, Radius, Cone.Origin, S.End, S.CapsuleRadius);
+		});
+		TimeBatch(TEXT("SphereOverlapCapsuleBatch"), [&](int32 c, TArray<uint32>& Mask)
+		{
+			StevesMathHelpers::SphereOverlapCapsuleBatch(Set.Cones[c].Origin, Shapes[c].End, Shapes[c].CapsuleRadius,
+			                                             Set.Spheres[c], Mask);
+		});
+		TimeSpheres(TEXT("SegmentOverlapSphere"), [&](int32 c, const FStevesCone& Cone, const FVector& Centre, float Radius)
+		{
+			const FConeShapes& S = Shapes[c];
+			return StevesMathHelpers::SegmentOverlapSphere(Cone.Origin, S.End, Centre, Radius);
+		});
+		TimeBatch(TEXT("SegmentOverlapSphereBatch"), [&](int32 c, TArray<uint32>& Mask)
+		{
+			StevesMathHelpers::SegmentOverlapSphereBatch(Set.Cones[c].Origin, Shapes[c].End, Set.Spheres[c], Mask);
+		});
+		TimeSpheres(TEXT("SphereOverlapBox"), [&](int32 c, const FStevesCone& Cone, const FVector& Centre, float Radius)
+		{
+			const FConeShapes& S = Shapes[c];
+			return StevesMathHelpers::SphereOverlapBox(S.BoxCentre, S.BoxRotation, S.BoxExtent, Centre, Radius);
+		});
+		TimeBatch(TEXT("SphereOverlapBoxBatch"), [&](int32 c, TArray<uint32>& Mask)
+		{
+			StevesMathHelpers::SphereOverlapBoxBatch(Shapes[c].BoxCentre, Shapes[c].BoxRotation, Shapes[c].BoxExtent,
+			                                         Set.Spheres[c], Mask);
+		});
+
+		// Capsules, boxes & rays against each cone
+		TimeScalar(TEXT("CapsuleOverlapCone"), [&](int32 c, int32 i)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			const FStevesCapsuleArray& Capsules = Set.Capsules[c];
+			return StevesMathHelpers::CapsuleOverlapCone(Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length,
+			                                             Capsules.GetStart(i), Capsules.GetEnd(i), Capsules.Radius[i]);
+		});
+		TimeBatch(TEXT("CapsuleOverlapConeBatch"), [&](int32 c, TArray<uint32>& Mask)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			StevesMathHelpers::CapsuleOverlapConeBatch(Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length,
+			                                           Set.Capsules[c], Mask);
+		});
+		TimeScalar(TEXT("BoxOverlapCone"), [&](int32 c, int32 i)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			return StevesMathHelpers::BoxOverlapCone(Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length,
+			                                         Set.Boxes[c].GetBox(i));
+		});
+		TimeBatch(TEXT("BoxOverlapConeBatch"), [&](int32 c, TArray<uint32>& Mask)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			StevesMathHelpers::BoxOverlapConeBatch(Cone.Origin, Cone.Direction, Cone.HalfAngle, Cone.Length,
+			                                       Set.Boxes[c], Mask);
+		});
+		TimeScalar(TEXT("RayIntersectCone"), [&](int32 c, int32 i)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			float Distance;
+			return StevesMathHelpers::RayIntersectCone(Set.Rays[c].GetOrigin(i), Set.Rays[c].GetDir(i), Cone.Origin,
+			                                           Cone.Direction, Cone.HalfAngle, Cone.Length, Distance);
+		});
+		TArray<float> Distances;
+		TimeBatch(TEXT("RayIntersectConeBatch"), [&](int32 c, TArray<uint32>& Mask)
+		{
+			const FStevesCone& Cone = Set.Cones[c];
+			StevesMathHelpers::RayIntersectConeBatch(Set.Rays[c], Cone.Origin, Cone.Direction, Cone.HalfAngle,
+			                                         Cone.Length, Mask, Distances);
+		});
+
+		const FString Report = FPaths::ProfilingDir() / TEXT("StevesMathBenchmark.csv");
+		FString Csv;
+		if (!IFileManager::Get().FileExists(*Report))
+			Csv += TEXT("Timestamp,Tests,Seed,Variant,TotalMs,NsPerTest,Overlaps\n");
+		const FString Timestamp = FDateTime::Now().ToString();
+
+		Ar.Logf(TEXT("StevesMathHelpers benchmark: %d cones x %d spheres, seed %d"), Set.Cones.Num(), SpheresPerCone,
+		        Seed);
+		for (const auto& R : Results)
+		{
+			const double TotalMs = R.Seconds * 1000.0;
+			const double NsPerTest = R.Seconds * 1000000000.0 / Count;
+			Ar.Logf(TEXT("  %-28s %10.3f ms %8.2f ns/test (%d overlaps)"), R.Name, TotalMs, NsPerTest, R.Overlaps);
+			Csv += FString::Printf(TEXT("%s,%d,%d,%s,%f,%f,%d\n"), *Timestamp, Count, Seed, R.Name, TotalMs, NsPerTest,
+			                       R.Overlaps);
+		}
+		FFileHelper::SaveStringToFile(Csv, *Report, FFileHelper::EEncodingOptions::AutoDetect,
+		                              &IFileManager::Get(), FILEWRITE_Append);
+		Ar.Logf(TEXT("Appended results to %s"), *Report);
+	}
+
+	void ParseMathArgs(const TArray<FString>& Args, int32& OutNumTests, int32& OutSeed)
+	{
+		OutNumTests = FMath::Max(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000000, 1);
+		OutSeed = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 0;
+	}
+}
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice GStevesMathVerifyCmd(
+	TEXT("Steves.Math.Verify"),
+	TEXT("Check the optimised overlap tests in StevesMathHelpers & FStevesCone agree with the scalar versions, and ")
+	TEXT("the scalar cone tests with brute force references, on random & edge case shapes. Also reports precision ")
+	TEXT("far from the origin. Args: [NumTests=1000000] [Seed=0]"),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+		[](const TArray<FString>& Args, UWorld*, FOutputDevice& Ar)
+		{
+			int32 NumTests, Seed;
+			ParseMathArgs(Args, NumTests, Seed);
+			RunMathVerify(NumTests, Seed, Ar);
+			RunBruteForceCheck(NumTests, Seed, Ar);
+			RunConeLimitsCheck(Ar);
+			RunLargeWorldCheck(NumTests, Seed, Ar);
+			RunConeCacheCheck(NumTests, Seed, Ar);
+		}));
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice GStevesMathBenchmarkCmd(
+	TEXT("Steves.Math.Benchmark"),
+	TEXT("Time the scalar, float / double, FStevesCone & SIMD batch sphere / cone overlap tests, and the scalar & ")
+	TEXT("batch capsule, segment, box & ray tests. ")
+	TEXT("Args: [NumTests=1000000] [Seed=0]. Results are appended to Saved/Profiling."),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda(
+		[](const TArray<FString>& Args, UWorld*, FOutputDevice& Ar)
+		{
+			int32 NumTests, Seed;
+			ParseMathArgs(Args, NumTests, Seed);
+			RunMathBenchmark(NumTests, Seed, Ar);
+		}));
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/// Sends the verify output to an automation test's log
+	class FAutomationTestOutput : public FOutputDevice
+	{
+	public:
+		explicit FAutomationTestOutput(FAutomationTestBase& InTest) : Test(InTest) {}
+
+		virtual void Serialize(const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category) override
+		{
+			Test.AddInfo(V);
+		}
+
+	private:
+		FAutomationTestBase& Test;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FStevesMathVerifyTest, "Steves.Math.Verify",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::ServerContext | EAutomationTestFlags::CommandletContext |
+                                 EAutomationTestFlags::EngineFilter)
+
+bool FStevesMathVerifyTest::RunTest(const FString& Parameters)
+{
+	// Smaller than the console command's default, so it's quick enough to run on every build
+	constexpr int32 NumTests = 65536;
+	constexpr int32 Seed = 0;
+	FAutomationTestOutput Ar(*this);
+	TestEqual(TEXT("Batch & scalar mismatches"), RunMathVerify(NumTests, Seed, Ar), 0);
+	TestEqual(TEXT("Brute force reference mismatches"), RunBruteForceCheck(NumTests, Seed, Ar), 0);
+	TestEqual(TEXT("Cone angle limit failures"), RunConeLimitsCheck(Ar), 0);
+	TestEqual(TEXT("Cone query cache mismatches"), RunConeCacheCheck(NumTests, Seed, Ar), 0);
+	return true;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+﻿#include "StevesRectPacker.h"
+
+#include "Algo/BinarySearch.h"
+
+bool FStevesShelfRectPacker::Allocate(FIntPoint RectSize, FIntRect& OutRect)
+{
+	if (RectSize.X <= 0 || RectSize.Y <= 0 || RectSize.X > Size.X || RectSize.Y > Size.Y)
+		return false;
+
+	// Best fit on height; empty shelves count as a perfect fit because they can be split to size
+	int32 BestShelf = INDEX_NONE;
+	int32 BestSpan = INDEX_NONE;
+	int32 BestWaste = MAX_int32;
+	for (int32 i = 0; i < Shelves.Num(); ++i)
+	{
+		const FShelf& S = Shelves[i];
+		if (S.Height < RectSize.Y)
+			continue;
+
+		const int32 Waste = S.NumAllocated == 0 ? 0 : S.Height - RectSize.Y;
+		if (Waste >= BestWaste)
+			continue;
+
+		for (int32 j = 0; j < S.FreeSpans.Num(); ++j)
+		{
+			if (S.FreeSpans[j].Width >= RectSize.X)
+			{
+				BestShelf = i;
+				BestSpan = j;
+				BestWaste = Waste;
+				break;
+			}
+		}
+	}
+
+	// Prefer opening a new shelf to wasting more than half the height of an existing one
+	const bool bCanAddShelf = Top + RectSize.Y <= Size.Y;
+	if (bCanAddShelf && (BestShelf == INDEX_NONE || BestWaste > RectSize.Y / 2))
+	{
+		BestShelf = Shelves.Emplace(Top, RectSize.Y, Size.X);
+		BestSpan = 0;
+		Top += RectSize.Y;
+	}
+
+	if (BestShelf == INDEX_NONE)
+		return false;
+
+	if (Shelves[BestShelf].NumAllocated == 0 && Shelves[BestShelf].Height > RectSize.Y)
+	{
+		SplitShelf(BestShelf, RectSize.Y);
+	}
+
+	FShelf& Shelf = Shelves[BestShelf];
+	FSpan& Span = Shelf.FreeSpans[BestSpan];
+	OutRect = FIntRect(Span.X, Shelf.Y, Span.X + RectSize.X, Shelf.Y + RectSize.Y);
+	Span.X += RectSize.X;
+	Span.Width -= RectSize.X;
+	if (Span.Width == 0)
+		Shelf.FreeSpans.RemoveAt(BestSpan);
+	++Shelf.NumAllocated;
+
+	return true;
+}
+
+void FStevesShelfRectPacker::SplitShelf(int32 ShelfIndex, int32 Height)
+{
+	FShelf& Shelf = Shelves[ShelfIndex];
+	const int32 RemainingHeight = Shelf.Height - Height;
+	const int32 RemainingY = Shelf.Y + Height;
+	Shelf.Height = Height;
+	Shelves.Insert(FShelf(RemainingY, RemainingHeight, Size.X), ShelfIndex + 1);
+}
+
+void FStevesShelfRectPacker::Free(const FIntRect& Rect)
+{
+	const int32 ShelfIndex = Algo::LowerBoundBy(Shelves, Rect.Min.Y, [](const FShelf& S) { return S.Y; });
+	if (!Shelves.IsValidIndex(ShelfIndex) || Shelves[ShelfIndex].Y != Rect.Min.Y)
+	{
+		ensureMsgf(false, TEXT("FStevesShelfRectPacker: Freed a rect which was not allocated"));
+		return;
+	}
+
+	FShelf& Shelf = Shelves[ShelfIndex];
+	const FSpan Freed {Rect.Min.X, Rect.Width()};
+	int32 SpanIndex = Algo::LowerBoundBy(Shelf.FreeSpans, Freed.X, [](const FSpan& S) { return S.X; });
+	Shelf.FreeSpans.Insert(Freed, SpanIndex);
+
+	// Coalesce with the gap after, then the gap before
+	if (Shelf.FreeSpans.IsValidIndex(SpanIndex + 1))
+	{
+		FSpan& Next = Shelf.FreeSpans[SpanIndex + 1];
+		if (Freed.X + Freed.Width == Next.X)
+		{
+			Shelf.FreeSpans[SpanIndex].Width += Next.Width;
+			Shelf.FreeSpans.RemoveAt(SpanIndex + 1);
+		}
+	}
+	if (SpanIndex > 0)
+	{
+		FSpan& Prev = Shelf.FreeSpans[SpanIndex - 1];
+		if (Prev.X + Prev.Width == Freed.X)
+		{
+			Prev.Width += Shelf.FreeSpans[SpanIndex].Width;
+			Shelf.FreeSpans.RemoveAt(SpanIndex);
+		}
+	}
+
+	--Shelf.NumAllocated;
+	if (Shelf.NumAllocated == 0)
+	{
+		MergeEmptyShelf(ShelfIndex);
+	}
+}
+
+void FStevesShelfRectPacker::MergeEmptyShelf(int32 ShelfIndex)
+{
+	if (Shelves.IsValidIndex(ShelfIndex + 1) && Shelves[ShelfIndex + 1].NumAllocated == 0)
+	{
+		Shelves[ShelfIndex].Height += Shelves[ShelfIndex + 1].Height;
+		Shelves.RemoveAt(ShelfIndex + 1);
+	}
+	if (ShelfIndex > 0 && Shelves[ShelfIndex - 1].NumAllocated == 0)
+	{
+		Shelves[ShelfIndex - 1].Height += Shelves[ShelfIndex].Height;
+		Shelves.RemoveAt(ShelfIndex);
+		--ShelfIndex;
+	}
+	// An empty shelf at the end just goes back to unused space
+	if (ShelfIndex == Shelves.Num() - 1)
+	{
+		Top = Shelves[ShelfIndex].Y;
+		Shelves.RemoveAt(ShelfIndex);
+	}
+}
+
+void FStevesShelfRectPacker::Reset()
+{
+	Shelves.Empty();
+	Top = 0;
+}
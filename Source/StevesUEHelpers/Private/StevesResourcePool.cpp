@@ -0,0 +1,44 @@
+﻿#include "StevesResourcePool.h"
+
+#include "ProfilingDebugging/CsvProfiler.h"
+
+CSV_DEFINE_CATEGORY(StevesResourcePool, true);
+
+FStevesResourcePoolCsvStats::FStevesResourcePoolCsvStats(const TCHAR* TypeName)
+	: Hits(*FString::Printf(TEXT("%s_Hits"), TypeName)),
+	  Misses(*FString::Printf(TEXT("%s_Misses"), TypeName)),
+	  Released(*FString::Printf(TEXT("%s_Released"), TypeName)),
+	  CreatedMB(*FString::Printf(TEXT("%s_CreatedMB"), TypeName)),
+	  DestroyedMB(*FString::Printf(TEXT("%s_DestroyedMB"), TypeName))
+{
+}
+
+void FStevesResourcePoolCsvStats::Accumulate(const FName& Stat, float Value)
+{
+#if CSV_PROFILER
+	FCsvProfiler* Profiler = FCsvProfiler::Get();
+	if (Profiler && Profiler->IsCapturing())
+	{
+		Profiler->RecordCustomStat(Stat, CSV_CATEGORY_INDEX(StevesResourcePool), Value, ECsvCustomStatOp::Accumulate);
+	}
+#endif
+}
+
+void FStevesResourcePoolStats::Dump(FOutputDevice& Ar) const
+{
+	Ar.Logf(TEXT("Pool '%s': %d reserved, %d unreserved, %d pending release, %.2f MB"),
+	        *PoolName.ToString(), NumReserved, NumUnreserved, NumPendingRelease, TotalBytes / (1024.0 * 1024.0));
+	Ar.Logf(TEXT("  Hits: %llu Misses: %llu Hit rate: %.1f%% Avg reservation lifetime: %.2fs"),
+	        NumHits, NumMisses, GetHitRate() * 100.f, AverageReservationLifetime);
+	for (auto& KS : Keys)
+	{
+		Ar.Logf(TEXT("  %s: %d reserved, %d unreserved, %d pending release, %.2f MB"),
+		        *KS.Key, KS.NumReserved, KS.NumUnreserved, KS.NumPendingRelease, KS.TotalBytes / (1024.0 * 1024.0));
+	}
+	for (auto& L : Leaks)
+	{
+		Ar.Logf(TEXT("  LEAK: %s still reserved by destroyed owner %s for %.2fs"),
+		        L.Resource.IsValid() ? *L.Resource->GetName() : TEXT("(null)"),
+		        *L.OwnerName.ToString(), L.Age);
+	}
+}
@@ -1,120 +1,407 @@
 ﻿#include "StevesTextureRenderTargetPool.h"
 
 #include "StevesUEHelpers.h"
+#include "ClearQuad.h"
+#include "RHICommandList.h"
+#include "TextureResource.h"
 #include "Kismet/KismetRenderingLibrary.h"
+#include "Misc/CoreDelegates.h"
 
-FStevesTextureRenderTargetReservation::~FStevesTextureRenderTargetReservation()
+namespace
 {
-	//UE_LOG(LogStevesUEHelpers, Log, TEXT("FStevesTextureRenderTargetReservation: destruction"));
-	if (ParentPool.IsValid() && Texture.IsValid())
+	struct FRenderTargetClear
 	{
-		ParentPool.Pin()->ReleaseReservation(Texture.Get());
-		Texture = nullptr;
+		FTextureRenderTargetResource* Resource;
+		FLinearColor Colour;
+	};
+
+	/// Clear a set of render targets in one render command, without touching their ClearColor.
+	/// The textures must be kept alive until the render thread has run the command.
+	void EnqueueRenderTargetClears(TArray<FRenderTargetClear>&& Clears)
+	{
+		if (Clears.Num() == 0)
+			return;
+
+		ENQUEUE_RENDER_COMMAND(StevesClearRenderTargets)(
+			[Clears = MoveTemp(Clears)](FRHICommandListImmediate& RHICmdList)
+			{
+				for (const auto& C : Clears)
+				{
+					FRHITexture* RT = C.Resource->GetRenderTargetTexture();
+					if (!RT)
+						continue;
+
+					RHICmdList.Transition(FRHITransitionInfo(RT, ERHIAccess::Unknown, ERHIAccess::RTV));
+					FRHIRenderPassInfo RPInfo(RT, ERenderTargetActions::DontLoad_Store);
+					RHICmdList.BeginRenderPass(RPInfo, TEXT("StevesClearRenderTarget"));
+					DrawClearQuad(RHICmdList, C.Colour);
+					RHICmdList.EndRenderPass();
+					RHICmdList.Transition(FRHITransitionInfo(RT, ERHIAccess::RTV, ERHIAccess::SRVMask));
+				}
+			});
 	}
 }
 
-void FStevesTextureRenderTargetPool::ReleaseReservation(UTextureRenderTarget2D* Tex)
+UTextureRenderTarget2D* FStevesTextureRenderTargetFactory::Create(const FStevesTextureRenderTargetKey& Key, UObject* Outer)
+{
+	if (Key.Size.X <= 0 || Key.Size.Y <= 0)
+		return nullptr;
+
+	UClass* Class = TextureClass ? TextureClass.Get() : UTextureRenderTarget2D::StaticClass();
+	UTextureRenderTarget2D* Tex = NewObject<UTextureRenderTarget2D>(Outer, Class);
+	Tex->RenderTargetFormat = Key.Format;
+	Tex->InitAutoFormat(Key.Size.X, Key.Size.Y);
+	Tex->UpdateResourceImmediate(true);
+	return Tex;
+}
+
+void FStevesTextureRenderTargetFactory::Destroy(UTextureRenderTarget2D* Tex)
+{
+	UKismetRenderingLibrary::ReleaseRenderTarget2D(Tex);
+}
+
+int64 FStevesTextureRenderTargetFactory::GetResourceSize(UTextureRenderTarget2D* Tex) const
+{
+	return Tex ? Tex->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal) : 0;
+}
+
+FString FStevesTextureRenderTargetFactory::DescribeKey(const FStevesTextureRenderTargetKey& Key) const
+{
+	const UEnum* FormatEnum = StaticEnum<ETextureRenderTargetFormat>();
+	return FString::Printf(TEXT("%dx%d %s"), Key.Size.X, Key.Size.Y,
+	                       FormatEnum ? *FormatEnum->GetNameStringByValue(Key.Format) : TEXT("?"));
+}
+
+UTextureRenderTargetCube* FStevesTextureRenderTargetCubeFactory::Create(const FStevesTextureRenderTargetCubeKey& Key,
+	UObject* Outer)
+{
+	if (Key.Size <= 0)
+		return nullptr;
+
+	UTextureRenderTargetCube* Tex = NewObject<UTextureRenderTargetCube>(Outer);
+	Tex->Init(Key.Size, Key.Format);
+	Tex->UpdateResourceImmediate(true);
+	return Tex;
+}
+
+void FStevesTextureRenderTargetCubeFactory::Destroy(UTextureRenderTargetCube* Tex)
+{
+	if (Tex)
+		Tex->ReleaseResource();
+}
+
+int64 FStevesTextureRenderTargetCubeFactory::GetResourceSize(UTextureRenderTargetCube* Tex) const
+{
+	return Tex ? Tex->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal) : 0;
+}
+
+FString FStevesTextureRenderTargetCubeFactory::DescribeKey(const FStevesTextureRenderTargetCubeKey& Key) const
+{
+	return FString::Printf(TEXT("Cube %d %s"), Key.Size, GetPixelFormatString(Key.Format));
+}
+
+FStevesTextureRenderTargetPool::FStevesTextureRenderTargetPool(const FName& InName, UObject* InOwner,
+	TSubclassOf<UTextureRenderTarget2D> InTextureClass)
+	: Super(InName, InOwner, FStevesTextureRenderTargetFactory(InTextureClass))
 {
-	if (!Tex)
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FStevesTextureRenderTargetPool::OnEndFrame);
+}
+
+FStevesTextureRenderTargetPool::~FStevesTextureRenderTargetPool()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	// Base class destructor can only drain its own state, we need to drain pending releases too
+	DrainPool(true);
+}
+
+void FStevesTextureRenderTargetPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Super::AddReferencedObjects(Collector);
+
+	// Released textures aren't in either the reserved or unreserved sets until the GPU is done with them
+	for (auto& P : PendingReleases)
 	{
-		UE_LOG(LogStevesUEHelpers, Warning, TEXT("FStevesTextureRenderTargetPool: Attempted to release a null texture"));
-		return;
+		Collector.AddReferencedObject(P.Texture);
 	}
-	
-	for (int i = 0; i < Reservations.Num(); ++i)
+	for (auto& Batch : ReleaseBatches)
 	{
-		const FReservationInfo& R = Reservations[i];
-		if (R.Texture.IsValid() && R.Texture.Get() == Tex)
+		for (auto& P : Batch->Textures)
 		{
-			UE_LOG(LogStevesUEHelpers, Verbose, TEXT("FStevesTextureRenderTargetPool: Released texture reservation on %s"), *Tex->GetName());
-			UnreservedTextures.Add(R.Key, Tex);
-			Reservations.RemoveAtSwap(i);
-			ReservedTextures.Remove(Tex);
-			return;
+			Collector.AddReferencedObject(P.Texture);
 		}
 	}
+}
 
-	UE_LOG(LogStevesUEHelpers, Warning, TEXT("FStevesTextureRenderTargetPool: Attempted to release a reservation on %s that was not found"), *Tex->GetName());
+FStevesTextureRenderTargetReservationPtr FStevesTextureRenderTargetPool::ReserveTexture(FIntPoint Size,
+	ETextureRenderTargetFormat Format,
+	const UObject* Owner,
+	const FStevesTextureRenderTargetReserveOptions& Options)
+{
+	// Pick up anything the GPU has finished with before looking for a free texture
+	ReturnCompletedReleases(false);
 
+	auto Ret = Reserve(FStevesTextureRenderTargetKey {Size, Format}, Owner);
+	if (UTextureRenderTarget2D* Tex = Ret->Get())
+	{
+		FLinearColor ClearedColour;
+		const bool bWasCleared = ClearedTextures.RemoveAndCopyValue(Tex, ClearedColour);
+		if (Options.bClearOnReuse)
+		{
+			ReservationOptions.Add(Tex, Options);
+			if (!bWasCleared || !ClearedColour.Equals(Options.ClearColour))
+			{
+				// Not already cleared to this colour when released. This is queued now rather than with the releases
+				// at the end of the frame, so that it happens before anything the caller renders into it this frame
+				if (auto Resource = Tex->GameThread_GetRenderTargetResource())
+					EnqueueRenderTargetClears({FRenderTargetClear {Resource, Options.ClearColour}});
+			}
+		}
+	}
+	return Ret;
 }
 
-FStevesTextureRenderTargetPool::~FStevesTextureRenderTargetPool()
+void FStevesTextureRenderTargetPool::ReturnToPool(const FStevesTextureRenderTargetKey& Key, UTextureRenderTarget2D* Tex)
 {
-	DrainPool(true);
+	// Don't make the texture available until render commands queued so far have completed
+	FStevesTextureRenderTargetReserveOptions Options;
+	ReservationOptions.RemoveAndCopyValue(Tex, Options);
+	PendingReleases.Add(FPendingRelease {Key, Tex, Options.bClearOnReuse, Options.ClearColour});
 }
 
-void FStevesTextureRenderTargetPool::AddReferencedObjects(FReferenceCollector& Collector)
+void FStevesTextureRenderTargetPool::GetPendingReleases(
+	TArray<TPair<FStevesTextureRenderTargetKey, UTextureRenderTarget2D*>>& OutPending) const
 {
-	// We need to hold on to the texture references
-	Collector.AddReferencedObjects(ReservedTextures);
-	Collector.AddReferencedObjects(UnreservedTextures);
+	for (auto& P : PendingReleases)
+	{
+		OutPending.Emplace(P.Key, P.Texture);
+	}
+	for (auto& Batch : ReleaseBatches)
+	{
+		for (auto& P : Batch->Textures)
+		{
+			OutPending.Emplace(P.Key, P.Texture);
+		}
+	}
 }
 
-FStevesTextureRenderTargetReservationPtr FStevesTextureRenderTargetPool::ReserveTexture(FIntPoint Size,
-                                                                                        ETextureRenderTargetFormat Format, const UObject* Owner)
+void FStevesTextureRenderTargetPool::OnEndFrame()
+{
+	SubmitPendingReleases();
+	ReturnCompletedReleases(false);
+}
+
+void FStevesTextureRenderTargetPool::SubmitPendingReleases()
 {
-	const FTextureKey Key {Size, Format};
-	UTextureRenderTarget2D* Tex = nullptr;
-	if (auto Pooled = UnreservedTextures.Find(Key))
+	if (PendingReleases.Num() == 0)
+		return;
+
+	TArray<FRenderTargetClear> Clears;
+	for (auto& P : PendingReleases)
 	{
-		Tex = *Pooled;
-		UnreservedTextures.RemoveSingle(Key, Tex);
-		UE_LOG(LogStevesUEHelpers, Verbose, TEXT("FStevesTextureRenderTargetPool: Re-used pooled texture %s"), *Tex->GetName());
+		if (P.bClear)
+		{
+			if (auto Resource = P.Texture->GameThread_GetRenderTargetResource())
+				Clears.Add(FRenderTargetClear {Resource, P.ClearColour});
+		}
 	}
-	else if (Size.X > 0 && Size.Y > 0)
+	// Textures are kept alive by this pool until the fence below has passed, so the resources remain valid
+	EnqueueRenderTargetClears(MoveTemp(Clears));
+
+	auto Batch = MakeUnique<FReleaseBatch>();
+	Batch->Textures = MoveTemp(PendingReleases);
+	// A plain fence only waits for the render thread to reach it; the GPU could still be reading or writing these
+	Batch->Fence.BeginFence(/*bSyncToRHIAndGPU=*/true);
+	ReleaseBatches.Add(MoveTemp(Batch));
+}
+
+void FStevesTextureRenderTargetPool::ReturnCompletedReleases(bool bWait)
+{
+	int32 NumCompleted = 0;
+	for (auto& Batch : ReleaseBatches)
 	{
-		// No existing texture, so create
-		// Texture owner should be a valid UObject that will determine lifespan
-		UObject* TextureOwner = PoolOwner.IsValid() ? PoolOwner.Get() : GetTransientPackage();
-		Tex = NewObject<UTextureRenderTarget2D>(TextureOwner);
-		Tex->RenderTargetFormat = Format;
-		Tex->InitAutoFormat(Size.X, Size.Y);
-		Tex->UpdateResourceImmediate(true);
+		// Fences complete in order, so stop at the first one that's still pending
+		if (bWait)
+			Batch->Fence.Wait();
+		else if (!Batch->Fence.IsFenceComplete())
+			break;
 
-		UE_LOG(LogStevesUEHelpers, Verbose, TEXT("FStevesTextureRenderTargetPool: Created new texture %s"), *Tex->GetName());
+		for (auto& P : Batch->Textures)
+		{
+			if (P.bClear)
+				ClearedTextures.Add(P.Texture, P.ClearColour);
+			Super::ReturnToPool(P.Key, P.Texture);
+		}
+		++NumCompleted;
 	}
+	ReleaseBatches.RemoveAt(0, NumCompleted);
+}
 
-	// Record reservation
-	Reservations.Add(FReservationInfo(Key, Owner, Tex));
+FStevesTextureRenderTargetAtlasReservation::FStevesTextureRenderTargetAtlasReservation(
+	UTextureRenderTarget2D* InTexture,
+	const FIntRect& InRect,
+	const FIntRect& InAllocatedRect,
+	FStevesTextureRenderTargetPoolPtr InParent,
+	const UObject* InOwner)
+	: Texture(InTexture),
+	  Rect(InRect),
+	  ParentPool(InParent),
+	  CurrentOwner(InOwner),
+	  AllocatedRect(InAllocatedRect)
+{
+	const FVector2D TexSize(InTexture->SizeX, InTexture->SizeY);
+	UVMin = FVector2D(Rect.Min) / TexSize;
+	UVMax = FVector2D(Rect.Max) / TexSize;
 
-	// Reservation doesn't keep the texture alive; if caller doesn't hold a strong pointer to it, it'll be destroyed
-	// So we need to hold it ourselves
-	ReservedTextures.Add(Tex);
-	
-	return MakeShared<FStevesTextureRenderTargetReservation>(Tex, this->AsShared(), Owner);
+	Brush.SetResourceObject(InTexture);
+	Brush.ImageSize = FVector2D(Rect.Size());
+	Brush.SetUVRegion(FBox2D(UVMin, UVMax));
 }
 
-void FStevesTextureRenderTargetPool::RevokeReservations(const UObject* ForOwner)
+FStevesTextureRenderTargetAtlasReservation::~FStevesTextureRenderTargetAtlasReservation()
+{
+	if (ParentPool.IsValid() && Texture.IsValid())
+	{
+		ParentPool.Pin()->ReleaseAtlasRegion(Texture.Get(), AllocatedRect);
+		Texture = nullptr;
+	}
+}
+
+void FStevesTextureRenderTargetPool::SetAtlasOptions(int32 PageSize, int32 Padding)
 {
-	for (int i = 0; i < Reservations.Num(); ++i)
+	AtlasPageSize = FMath::Max(PageSize, 1);
+	AtlasPadding = FMath::Max(Padding, 0);
+}
+
+FStevesTextureRenderTargetAtlasReservationPtr FStevesTextureRenderTargetPool::ReserveAtlasRegion(FIntPoint Size,
+	ETextureRenderTargetFormat Format,
+	const UObject* Owner)
+{
+	if (Size.X <= 0 || Size.Y <= 0 || Size.X > AtlasPageSize || Size.Y > AtlasPageSize)
 	{
-		const FReservationInfo& R = Reservations[i];
-		if (!ForOwner || R.Owner == ForOwner)
+		UE_LOG(LogStevesUEHelpers, Warning, TEXT("FStevesTextureRenderTargetPool: Atlas region %dx%d does not fit in atlas page size %d"),
+		       Size.X, Size.Y, AtlasPageSize);
+		return nullptr;
+	}
+
+	// Padding goes on the right & bottom, clamped so a region the size of the page still fits
+	const FIntPoint PaddedSize = (Size + FIntPoint(AtlasPadding)).ComponentMin(FIntPoint(AtlasPageSize));
+	FIntRect Allocated;
+	FAtlasPage* Page = nullptr;
+	for (auto& P : AtlasPages)
+	{
+		if (P.Format == Format && IsAtlasPageValid(P) && P.Packer.Allocate(PaddedSize, Allocated))
 		{
-			if (R.Texture.IsValid())
-			{
-				UE_LOG(LogStevesUEHelpers, Verbose, TEXT("FStevesTextureRenderTargetPool: Revoked texture reservation on %s"), *R.Texture->GetName());
-				UnreservedTextures.Add(R.Key, R.Texture.Get());
-				ReservedTextures.Remove(R.Texture.Get());
-			}
-			// Can't use RemoveAtSwap because it'll change order
-			Reservations.RemoveAt(i);
-			// Adjust index backwards to compensate
-			--i;
+			Page = &P;
+			break;
 		}
 	}
+
+	if (!Page)
+	{
+		auto PageRes = ReserveTexture(FIntPoint(AtlasPageSize), Format, PoolOwner.Get());
+		if (!PageRes->Get())
+			return nullptr;
+
+		Page = &AtlasPages.Emplace_GetRef(PageRes, Format, AtlasPageSize);
+		if (!Page->Packer.Allocate(PaddedSize, Allocated))
+			return nullptr;
+
+		UE_LOG(LogStevesUEHelpers, Verbose, TEXT("FStevesTextureRenderTargetPool: Created atlas page %s"), *PageRes->Get()->GetName());
+	}
+
+	++Page->NumRegions;
+	const FIntRect Rect(Allocated.Min, Allocated.Min + Size);
+	auto Region = MakeShared<FStevesTextureRenderTargetAtlasReservation>(Page->PageReservation->Get(), Rect, Allocated,
+	                                                                     StaticCastSharedRef<FStevesTextureRenderTargetPool>(AsShared()),
+	                                                                     Owner);
+	Page->Regions.Add(Region);
+	return Region;
+}
+
+void FStevesTextureRenderTargetPool::ReleaseAtlasRegion(UTextureRenderTarget2D* Page, const FIntRect& AllocatedRect)
+{
+	for (auto& P : AtlasPages)
+	{
+		if (P.PageReservation->Get() == Page)
+		{
+			P.Packer.Free(AllocatedRect);
+			--P.NumRegions;
+			// The region being released is mid-destruction, so its weak pointer has already expired
+			P.Regions.RemoveAll([](const TWeakPtr<FStevesTextureRenderTargetAtlasReservation>& R) { return !R.IsValid(); });
+			return;
+		}
+	}
+	// Page may legitimately have been dropped by a forced drain
+	UE_LOG(LogStevesUEHelpers, Verbose, TEXT("FStevesTextureRenderTargetPool: Released an atlas region on %s which is no longer a page"), *Page->GetName());
+}
+
+bool FStevesTextureRenderTargetPool::IsAtlasPageValid(const FAtlasPage& Page) const
+{
+	UTextureRenderTarget2D* Tex = Page.PageReservation->Get();
+	return Tex && Reservations.Contains(Tex);
+}
+
+void FStevesTextureRenderTargetPool::RevokeAtlasRegions(FAtlasPage& Page, const UObject* ForOwner)
+{
+	Page.Regions.RemoveAll([&](const TWeakPtr<FStevesTextureRenderTargetAtlasReservation>& Weak)
+	{
+		auto Region = Weak.Pin();
+		if (!Region.IsValid())
+			return true;
+		if (ForOwner && Region->CurrentOwner != ForOwner)
+			return false;
+
+		Page.Packer.Free(Region->AllocatedRect);
+		--Page.NumRegions;
+		Region->Texture = nullptr;
+		Region->Brush.SetResourceObject(nullptr);
+		return true;
+	});
+}
+
+void FStevesTextureRenderTargetPool::DropAtlasPages(TFunctionRef<bool(const FAtlasPage&)> Predicate)
+{
+	// Dropping a page releases its reservation, unless that was revoked already
+	AtlasPages.RemoveAll([&](FAtlasPage& P)
+	{
+		if (!Predicate(P))
+			return false;
+
+		RevokeAtlasRegions(P, nullptr);
+		return true;
+	});
+}
+
+void FStevesTextureRenderTargetPool::RevokeReservations(const UObject* ForOwner)
+{
+	// Regions are reserved by their own owners, though the pages they're on are reserved by the pool owner
+	for (auto& P : AtlasPages)
+	{
+		RevokeAtlasRegions(P, ForOwner);
+	}
+
+	Super::RevokeReservations(ForOwner);
+
+	// A page whose texture was revoked could be reserved by anyone now, so nothing must be packed onto it
+	DropAtlasPages([this](const FAtlasPage& P) { return !IsAtlasPageValid(P); });
 }
 
 void FStevesTextureRenderTargetPool::DrainPool(bool bForceAndRevokeReservations)
 {
+	// Dropping pages releases their reservations so the base class can destroy the textures
 	if (bForceAndRevokeReservations)
+	{
+		DropAtlasPages([](const FAtlasPage&) { return true; });
 		RevokeReservations();
-
-	for (auto& TexPair : UnreservedTextures)
+		// Everything released needs to come back into the pool to be destroyed
+		SubmitPendingReleases();
+		ReturnCompletedReleases(true);
+	}
+	else
 	{
-		UKismetRenderingLibrary::ReleaseRenderTarget2D(TexPair.Value);
+		AtlasPages.RemoveAll([](const FAtlasPage& P) { return P.NumRegions == 0; });
 	}
-	UnreservedTextures.Empty();
-	ReservedTextures.Empty();
+	ClearedTextures.Empty();
 
+	Super::DrainPool(bForceAndRevokeReservations);
 }
@@ -1,41 +1,66 @@
 #include "StevesUI/FocusSystem.h"
 #include "StevesUI/FocusableUserWidget.h"
+#include "Algo/BinarySearch.h"
 
 DEFINE_LOG_CATEGORY(LogFocusSystem)
 
 TWeakObjectPtr<UFocusableUserWidget> FFocusSystem::GetHighestFocusPriority()
 {
-    int Highest = -999;
-    TWeakObjectPtr<UFocusableUserWidget> Ret;
-    
-    for (auto && S : ActiveAutoFocusWidgets)
+    for (int i = 0; i < ActiveAutoFocusWidgets.Num(); ++i)
     {
-        if (S.IsValid() && S->IsRequestingFocus() && S->GetAutomaticFocusPriority() > Highest)
+        auto& Entry = ActiveAutoFocusWidgets[i];
+        if (!Entry.Widget.IsValid())
         {
-            Highest = S->GetAutomaticFocusPriority();
-            Ret = S;
+            // Collected without being destructed, just forget it
+            WidgetKeys.Remove(Entry.ObjectKey);
+            ActiveAutoFocusWidgets.RemoveAt(i--);
+            continue;
         }
+        // Requesting focus is volatile, so ask each widget in priority order until one wants it
+        if (Entry.Widget->IsRequestingFocus())
+            return Entry.Widget;
+    }
+
+    return nullptr;
+}
+
+int32 FFocusSystem::FindEntryIndex(const FFocusKey& Key) const
+{
+    const int32 Index = Algo::LowerBoundBy(ActiveAutoFocusWidgets, Key, [](const FFocusEntry& E) { return E.Key; });
+    if (ActiveAutoFocusWidgets.IsValidIndex(Index) && ActiveAutoFocusWidgets[Index].Key.Order == Key.Order)
+        return Index;
+    return INDEX_NONE;
+}
+
+void FFocusSystem::AddEntry(UFocusableUserWidget* Widget, uint32 Order)
+{
+    FFocusEntry Entry;
+    Entry.Key = FFocusKey { Widget->GetAutomaticFocusPriority(), Order };
+    Entry.Widget = Widget;
+    Entry.ObjectKey = FObjectKey(Widget);
+
+    const int32 Index = Algo::UpperBoundBy(ActiveAutoFocusWidgets, Entry.Key, [](const FFocusEntry& E) { return E.Key; });
+    ActiveAutoFocusWidgets.Insert(Entry, Index);
+    WidgetKeys.Add(Entry.ObjectKey, Entry.Key);
+}
+
+void FFocusSystem::RemoveEntry(const FObjectKey& Widget)
+{
+    FFocusKey Key;
+    if (WidgetKeys.RemoveAndCopyValue(Widget, Key))
+    {
+        const int32 Index = FindEntryIndex(Key);
+        if (Index != INDEX_NONE)
+            ActiveAutoFocusWidgets.RemoveAt(Index);
     }
-        
-    return Ret;
 }
 
 void FFocusSystem::FocusableWidgetConstructed(UFocusableUserWidget* Widget)
 {
     UE_LOG(LogFocusSystem, Display, TEXT("FocusableUserWidget %s opened"), *Widget->GetName());
     // check to make sure we never dupe, shouldn't normally be a problem
-    // but let's just be safe, there will never be that many
-    bool bPresent = false;    
-    for (auto && S : ActiveAutoFocusWidgets)
-    {
-        if (S.Get() == Widget)
-        {
-            bPresent = true;
-            break;
-        }
-    }
-    if (!bPresent)
-        ActiveAutoFocusWidgets.Add(Widget);
+    if (!WidgetKeys.Contains(FObjectKey(Widget)))
+        AddEntry(Widget, NextOrder++);
 
     if (Widget->IsRequestingFocus())
     {
@@ -45,22 +70,15 @@ void FFocusSystem::FocusableWidgetConstructed(UFocusableUserWidget* Widget)
             // give new stack the focus if it's equal or higher priority than anything else
             UE_LOG(LogFocusSystem, Display, TEXT("Giving focus to %s"), *Widget->GetName());
             Widget->TakeFocusIfDesired();
-        }        
+        }
     }
 }
 
 void FFocusSystem::FocusableWidgetDestructed(UFocusableUserWidget* Widget)
 {
     UE_LOG(LogFocusSystem, Display, TEXT("FocusableUserWidget %s closed"), *Widget->GetName());
-    
-    for (int i = 0; i < ActiveAutoFocusWidgets.Num(); ++i)
-    {
-        if (ActiveAutoFocusWidgets[i].Get() == Widget)
-        {
-            ActiveAutoFocusWidgets.RemoveAt(i);
-            break;
-        }
-    }
+
+    RemoveEntry(FObjectKey(Widget));
 
     // if the menu closing had focus, give it to the highest remaining stack
     if (Widget->HasFocusedDescendants())
@@ -70,6 +88,26 @@ void FFocusSystem::FocusableWidgetDestructed(UFocusableUserWidget* Widget)
         {
             UE_LOG(LogFocusSystem, Display, TEXT("Giving focus to %s"), *Highest->GetName());
             Highest->TakeFocusIfDesired();
-        }       
+        }
+    }
+}
+
+void FFocusSystem::FocusableWidgetStateChanged(UFocusableUserWidget* Widget)
+{
+    const FObjectKey ObjectKey(Widget);
+    const FFocusKey* Key = WidgetKeys.Find(ObjectKey);
+    if (!Key)
+        return;
+
+    const int32 Index = FindEntryIndex(*Key);
+    if (Index != INDEX_NONE && ActiveAutoFocusWidgets[Index].Key.Priority == Widget->GetAutomaticFocusPriority())
+    {
+        // Still in the right place
+        return;
     }
+
+    // Re-insert with the new priority, keeping its original order among equals
+    const uint32 Order = Key->Order;
+    RemoveEntry(ObjectKey);
+    AddEntry(Widget, Order);
 }
@@ -15,6 +15,15 @@ void UFocusablePanel::NativeConstruct()
         InitialFocusWidget = WidgetTree->FindWidget(InitialFocusWidgetName);
     }
 
+    InvalidateSlateWidgetMap();
+}
+
+void UFocusablePanel::OnWidgetRebuilt()
+{
+    Super::OnWidgetRebuilt();
+
+    // Every Slate widget under us is new
+    InvalidateSlateWidgetMap();
 }
 
 void UFocusablePanel::NativeDestruct()
@@ -22,6 +31,37 @@ void UFocusablePanel::NativeDestruct()
     Super::NativeDestruct();
 
     InitialFocusWidget.Reset();
+    SlateWidgetMap.Empty();
+    bSlateWidgetMapDirty = true;
+}
+
+UWidget* UFocusablePanel::FindChildFromSlate(const SWidget* SW)
+{
+    const TSharedPtr<SWidget> Mine = GetCachedWidget();
+    if (!Mine.IsValid())
+        return nullptr;
+
+    if (bSlateWidgetMapDirty)
+    {
+        SlateWidgetMap.Reset();
+        BuildSlateToWidgetMap(this, SlateWidgetMap);
+        bSlateWidgetMapDirty = false;
+    }
+
+    // Walk up the Slate parents to the nearest one of ours, which is at most the depth of the focussed widget
+    TSharedPtr<SWidget> Parent;
+    for (const SWidget* Current = SW; Current; Parent = Current->GetParentWidget(), Current = Parent.Get())
+    {
+        // Stop at our own widget, we're not a child of ourselves
+        if (Current == Mine.Get())
+            return nullptr;
+
+        // Check the entry is still current, Slate widgets may have been freed & their addresses reused
+        const auto Found = SlateWidgetMap.Find(Current);
+        if (Found && Found->IsValid() && (*Found)->GetCachedWidget().Get() == Current)
+            return Found->Get();
+    }
+    return nullptr;
 }
 
 bool UFocusablePanel::SetFocusToInitialWidget() const
@@ -50,7 +90,7 @@ bool UFocusablePanel::SavePreviousFocus()
     const auto SW = FSlateApplication::Get().GetUserFocusedWidget(0);
     if (SW)
     {
-        PreviousFocusWidget = FindWidgetFromSlate(SW.Get(), this);
+        PreviousFocusWidget = FindChildFromSlate(SW.Get());
         return true;
     }
     else
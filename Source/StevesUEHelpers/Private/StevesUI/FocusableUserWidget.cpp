@@ -27,6 +27,16 @@ bool UFocusableUserWidget::TakeFocusIfDesired_Implementation()
     return false;
 }
 
+void UFocusableUserWidget::NotifyFocusStateChanged()
+{
+    if (bEnableAutomaticFocus)
+    {
+        auto GS = GetStevesGameSubsystem(GetWorld());
+        if (GS)
+            GS->GetFocusSystem()->FocusableWidgetStateChanged(this);
+    }
+}
+
 void UFocusableUserWidget::NativeConstruct()
 {
     Super::NativeConstruct();
@@ -40,6 +40,34 @@ UWidget* FindWidgetFromSlate(SWidget* SW, UWidget* Parent)
     return nullptr;
 }
 
+void BuildSlateToWidgetMap(UWidget* Parent, TMap<const SWidget*, TWeakObjectPtr<UWidget>>& OutMap)
+{
+    if (!Parent)
+        return;
+
+    const TSharedPtr<SWidget> SW = Parent->GetCachedWidget();
+    if (SW.IsValid())
+        OutMap.Add(SW.Get(), Parent);
+
+    // Same descent as FindWidgetFromSlate
+    auto PW = Cast<UPanelWidget>(Parent);
+    if (PW)
+    {
+        for (int i = 0; i < PW->GetChildrenCount(); ++i)
+        {
+            BuildSlateToWidgetMap(PW->GetChildAt(i), OutMap);
+        }
+    }
+    else
+    {
+        auto UW = Cast<UUserWidget>(Parent);
+        if (UW && UW->WidgetTree)
+        {
+            BuildSlateToWidgetMap(UW->WidgetTree->RootWidget, OutMap);
+        }
+    }
+}
+
 void SetWidgetFocusProperly(UWidget* Widget)
 {
     auto FW = Cast<UFocusableUserWidget>(Widget);
@@ -17,6 +17,14 @@ DECLARE_LOG_CATEGORY_EXTERN(LogStevesUI, Warning, Warning)
  */
 UWidget* FindWidgetFromSlate(SWidget* SW, UWidget* Parent);
 
+/**
+ * @brief Map every Slate widget under a UMG widget back to the UMG widget using it as its native implementation,
+ * so that repeated lookups don't have to search the tree like FindWidgetFromSlate
+ * @param Parent Parent widget, which is included along with all its descendants
+ * @param OutMap Map to add to
+ */
+void BuildSlateToWidgetMap(UWidget* Parent, TMap<const SWidget*, TWeakObjectPtr<UWidget>>& OutMap);
+
 /**
  * @brief Set the focus to a given widget "properly", which means that if this is a widget derived
  * from UFocusableWidget, it calls SetFocusProperly on it which allows a customised implementation.
@@ -4,9 +4,12 @@
 
 #include "CoreMinimal.h"
 
+#include "StevesCone.h"
 #include "StevesMathHelpers.h"
 #include "StevesBPL.generated.h"
 
+class AActor;
+class USceneComponent;
 class UWidget;
 /**
  * Blueprint library exposing various things in a Blueprint-friendly way e.g. using by-value FVectors so they can
@@ -22,7 +25,7 @@ public:
 	* Return whether a sphere overlaps a cone
 	* @param ConeOrigin Origin of the cone
 	* @param ConeDir Direction of the cone, must be normalised
-	* @param ConeAngle Angle of the cone, in degrees
+	* @param ConeAngle Angle of the cone, in degrees. Clamped to just above 0 and just below 180
 	* @param Distance Length of the cone
 	* @param SphereCentre Centre of the sphere
 	* @param SphereRadius Radius of the sphere
@@ -34,6 +37,266 @@ public:
 		return StevesMathHelpers::SphereOverlapCone(ConeOrigin, ConeDir, FMath::DegreesToRadians(ConeAngle*0.5f), Distance, SphereCentre, SphereRadius);
 	}
 
+	/**
+	* Return whether a capsule overlaps a cone
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeAngle Angle of the cone, in degrees. Clamped to just above 0 and just below 180
+	* @param Distance Length of the cone
+	* @param CapsuleStart Centre of the hemisphere at one end of the capsule
+	* @param CapsuleEnd Centre of the hemisphere at the other end of the capsule
+	* @param CapsuleRadius Radius of the capsule
+	* @return True if the capsule overlaps the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool CapsuleOverlapCone(FVector ConeOrigin, FVector ConeDir, float ConeAngle, float Distance, FVector CapsuleStart, FVector CapsuleEnd, float CapsuleRadius)
+	{
+		return StevesMathHelpers::CapsuleOverlapCone(ConeOrigin, ConeDir, FMath::DegreesToRadians(ConeAngle*0.5f), Distance, CapsuleStart, CapsuleEnd, CapsuleRadius);
+	}
+
+	/**
+	* Return whether an axis-aligned box overlaps a cone
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeAngle Angle of the cone, in degrees. Clamped to just above 0 and just below 180
+	* @param Distance Length of the cone
+	* @param Box The box
+	* @return True if the box overlaps the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool BoxOverlapCone(FVector ConeOrigin, FVector ConeDir, float ConeAngle, float Distance, FBox Box)
+	{
+		return StevesMathHelpers::BoxOverlapCone(ConeOrigin, ConeDir, FMath::DegreesToRadians(ConeAngle*0.5f), Distance, Box);
+	}
+
+	/**
+	* Find where a ray first hits a cone
+	* @param RayOrigin Start of the ray
+	* @param RayDir Direction of the ray, must be normalised
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeAngle Angle of the cone, in degrees. Clamped to just above 0 and just below 180
+	* @param Distance Length of the cone
+	* @param HitDistance Distance along the ray of the first hit, 0 if the ray starts inside the cone
+	* @return True if the ray hits the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool RayIntersectCone(FVector RayOrigin, FVector RayDir, FVector ConeOrigin, FVector ConeDir, float ConeAngle, float Distance, float& HitDistance)
+	{
+		return StevesMathHelpers::RayIntersectCone(RayOrigin, RayDir, ConeOrigin, ConeDir, FMath::DegreesToRadians(ConeAngle*0.5f), Distance, HitDistance);
+	}
+
+	/**
+	* Return whether a sphere overlaps a capsule
+	* @param SphereCentre Centre of the sphere
+	* @param SphereRadius Radius of the sphere
+	* @param CapsuleStart Centre of the hemisphere at one end of the capsule
+	* @param CapsuleEnd Centre of the hemisphere at the other end of the capsule
+	* @param CapsuleRadius Radius of the capsule
+	* @return True if the sphere overlaps the capsule
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool SphereOverlapCapsule(FVector SphereCentre, float SphereRadius, FVector CapsuleStart, FVector CapsuleEnd, float CapsuleRadius)
+	{
+		return StevesMathHelpers::SphereOverlapCapsule(SphereCentre, SphereRadius, CapsuleStart, CapsuleEnd, CapsuleRadius);
+	}
+
+	/**
+	* Return whether a sphere overlaps an oriented box
+	* @param BoxCentre Centre of the box
+	* @param BoxRotation Rotation of the box
+	* @param BoxExtent Half the size of the box on each of its local axes
+	* @param SphereCentre Centre of the sphere
+	* @param SphereRadius Radius of the sphere
+	* @return True if the sphere overlaps the box
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool SphereOverlapBox(FVector BoxCentre, FRotator BoxRotation, FVector BoxExtent, FVector SphereCentre, float SphereRadius)
+	{
+		return StevesMathHelpers::SphereOverlapBox(BoxCentre, BoxRotation.Quaternion(), BoxExtent, SphereCentre, SphereRadius);
+	}
+
+	/**
+	* Return whether a line segment overlaps a sphere
+	* @param Start Start of the segment
+	* @param End End of the segment
+	* @param SphereCentre Centre of the sphere
+	* @param SphereRadius Radius of the sphere
+	* @return True if any part of the segment is inside the sphere
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool SegmentOverlapSphere(FVector Start, FVector End, FVector SphereCentre, float SphereRadius)
+	{
+		return StevesMathHelpers::SegmentOverlapSphere(Start, End, SphereCentre, SphereRadius);
+	}
+
+	/**
+	* Make a cone for repeated overlap tests, so the trig is only calculated once rather than on every test
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone
+	* @param ConeAngle Angle of the cone, in degrees. Clamped to just above 0 and just below 180
+	* @param Distance Length of the cone
+	*/
+	UFUNCTION(BlueprintPure, Category="StevesUEHelpers|Math")
+	static FStevesCone MakeCone(FVector ConeOrigin, FVector ConeDir, float ConeAngle, float Distance)
+	{
+		return FStevesCone(ConeOrigin, ConeDir, FMath::DegreesToRadians(ConeAngle*0.5f), Distance);
+	}
+
+	/**
+	* Return whether a sphere overlaps a cone made with MakeCone
+	* @param Cone The cone
+	* @param SphereCentre Centre of the sphere
+	* @param SphereRadius Radius of the sphere
+	* @return True if the sphere overlaps the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool ConeOverlapsSphere(const FStevesCone& Cone, FVector SphereCentre, float SphereRadius)
+	{
+		return Cone.Overlaps(SphereCentre, SphereRadius);
+	}
+
+	/**
+	* Return whether an axis-aligned box overlaps a cone made with MakeCone
+	* @param Cone The cone
+	* @param Box The box
+	* @return True if the box overlaps the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool ConeOverlapsBox(const FStevesCone& Cone, FBox Box)
+	{
+		return Cone.Overlaps(Box);
+	}
+
+	/**
+	* Return whether a capsule overlaps a cone made with MakeCone
+	* @param Cone The cone
+	* @param CapsuleStart Centre of the hemisphere at one end of the capsule
+	* @param CapsuleEnd Centre of the hemisphere at the other end of the capsule
+	* @param CapsuleRadius Radius of the capsule
+	* @return True if the capsule overlaps the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool ConeOverlapsCapsule(const FStevesCone& Cone, FVector CapsuleStart, FVector CapsuleEnd, float CapsuleRadius)
+	{
+		return Cone.Overlaps(CapsuleStart, CapsuleEnd, CapsuleRadius);
+	}
+
+	/**
+	* Find where a ray first hits a cone made with MakeCone
+	* @param Cone The cone
+	* @param RayOrigin Start of the ray
+	* @param RayDir Direction of the ray, must be normalised
+	* @param HitDistance Distance along the ray of the first hit, 0 if the ray starts inside the cone
+	* @return True if the ray hits the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool ConeIntersectRay(const FStevesCone& Cone, FVector RayOrigin, FVector RayDir, float& HitDistance)
+	{
+		return Cone.IntersectRay(RayOrigin, RayDir, HitDistance);
+	}
+
+	/**
+	* Return whether a point is inside a cone made with MakeCone
+	* @param Cone The cone
+	* @param Point The point
+	* @return True if the point is inside the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static bool ConeContainsPoint(const FStevesCone& Cone, FVector Point)
+	{
+		return Cone.Contains(Point);
+	}
+
+	/**
+	* Find which actors overlap a cone made with MakeCone
+	* @param Cone The cone
+	* @param Actors The actors to test
+	* @param bUseBounds If true, test each actor's bounding sphere, otherwise just its location
+	* @param OutActors The actors in the cone, in the same order as Actors
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static void FilterActorsByCone(const FStevesCone& Cone, const TArray<AActor*>& Actors, bool bUseBounds, TArray<AActor*>& OutActors);
+
+	/**
+	* Find which scene components overlap a cone made with MakeCone
+	* @param Cone The cone
+	* @param Components The components to test
+	* @param bUseBounds If true, test each component's bounding sphere, otherwise just its location
+	* @param OutComponents The components in the cone, in the same order as Components
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static void FilterComponentsByCone(const FStevesCone& Cone, const TArray<USceneComponent*>& Components, bool bUseBounds, TArray<USceneComponent*>& OutComponents);
+
+	/**
+	* Find which locations are in a cone made with MakeCone. Tests 4 at a time with SIMD.
+	* @param Cone The cone
+	* @param Locations The locations to test
+	* @param Radius Treat each location as a sphere of this radius; 0 to test points
+	* @param OutIndices Indices of the locations in the cone, in ascending order
+	* @return The number of locations in the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static int32 FilterLocationsByCone(const FStevesCone& Cone, const TArray<FVector>& Locations, float Radius, TArray<int32>& OutIndices);
+
+	/**
+	* Find which axis-aligned boxes overlap a cone made with MakeCone. Culls 4 at a time with SIMD.
+	* @param Cone The cone
+	* @param Boxes The boxes to test
+	* @param OutIndices Indices of the boxes which overlap the cone, in ascending order
+	* @return The number of boxes which overlap the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static int32 FilterBoxesByCone(const FStevesCone& Cone, const TArray<FBox>& Boxes, TArray<int32>& OutIndices);
+
+	/**
+	* Find which capsules overlap a cone made with MakeCone. Culls 4 at a time with SIMD.
+	* @param Cone The cone
+	* @param CapsuleStarts Centre of the hemisphere at one end of each capsule
+	* @param CapsuleEnds Centre of the hemisphere at the other end of each capsule, the same number as CapsuleStarts
+	* @param CapsuleRadius Radius of every capsule
+	* @param OutIndices Indices of the capsules which overlap the cone, in ascending order
+	* @return The number of capsules which overlap the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static int32 FilterCapsulesByCone(const FStevesCone& Cone, const TArray<FVector>& CapsuleStarts, const TArray<FVector>& CapsuleEnds, float CapsuleRadius, TArray<int32>& OutIndices);
+
+	/**
+	* Find which rays hit a cone made with MakeCone, and where. Tests 4 at a time with SIMD.
+	* @param Cone The cone
+	* @param RayOrigins Start of each ray
+	* @param RayDirs Normalised direction of each ray, the same number as RayOrigins
+	* @param OutIndices Indices of the rays which hit the cone, in ascending order
+	* @param OutDistances Distance along each ray in OutIndices of its first hit, 0 if it starts inside the cone
+	* @return The number of rays which hit the cone
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static int32 IntersectRaysWithCone(const FStevesCone& Cone, const TArray<FVector>& RayOrigins, const TArray<FVector>& RayDirs, TArray<int32>& OutIndices, TArray<float>& OutDistances);
+
+	/**
+	* Find the actors which overlap a cone made with MakeCone, best first
+	* @param Cone The cone
+	* @param Actors The actors to test
+	* @param SortBy How to order the actors
+	* @param bUseBounds If true, test each actor's bounding sphere, otherwise just its location
+	* @param MaxCount Only return this many of the best actors; 0 for all of them
+	* @param OutActors The actors in the cone, best first
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static void SortActorsInCone(const FStevesCone& Cone, const TArray<AActor*>& Actors, EStevesConeSort SortBy, bool bUseBounds, int32 MaxCount, TArray<AActor*>& OutActors);
+
+	/**
+	* Find the locations which are in a cone made with MakeCone, best first
+	* @param Cone The cone
+	* @param Locations The locations to test
+	* @param Radius Treat each location as a sphere of this radius; 0 to test points
+	* @param SortBy How to order the locations
+	* @param MaxCount Only return this many of the best locations; 0 for all of them
+	* @param OutIndices Indices of the locations in the cone, best first
+	*/
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|Math")
+	static void SortLocationsInCone(const FStevesCone& Cone, const TArray<FVector>& Locations, float Radius, EStevesConeSort SortBy, int32 MaxCount, TArray<int32>& OutIndices);
+
 
 	
 	/**
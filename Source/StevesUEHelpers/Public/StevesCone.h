@@ -0,0 +1,242 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StevesMathHelpers.h"
+#include "StevesCone.generated.h"
+
+/// How to order things found in a cone
+UENUM(BlueprintType)
+enum class EStevesConeSort : uint8
+{
+	/// Nearest to the cone's origin first
+	Distance,
+	/// Nearest to the cone's axis, by angle, first
+	Angle
+};
+
+/**
+ * A cone with a flat base, the same shape as StevesMathHelpers::SphereOverlapCone tests against, with its trig
+ * calculated once up front. Use this when testing the same cone many times, e.g. against every actor in a frame.
+ */
+USTRUCT(BlueprintType)
+struct STEVESUEHELPERS_API FStevesCone
+{
+	GENERATED_BODY()
+
+	/// Apex of the cone
+	UPROPERTY()
+	FVector Origin;
+	/// Normalised direction of the cone
+	UPROPERTY()
+	FVector Direction;
+	/// Half-angle of the cone, in radians, clamped by StevesMathHelpers::ClampConeHalfAngle
+	UPROPERTY()
+	float HalfAngle;
+	/// Length of the cone, from the apex to the base
+	UPROPERTY()
+	float Length;
+
+	// Derived from the above
+	UPROPERTY()
+	float SinHalfAngle;
+	UPROPERTY()
+	float InvSinHalfAngle;
+	UPROPERTY()
+	float CosHalfAngleSq;
+	UPROPERTY()
+	float TanHalfAngle;
+	/// Radius of the base
+	UPROPERTY()
+	float BaseRadius;
+
+	FStevesCone() : FStevesCone(FVector::ZeroVector, FVector::ForwardVector, PI * 0.25f, 100.f)
+	{
+	}
+
+	/**
+	* @param InOrigin Apex of the cone
+	* @param InDirection Direction of the cone; doesn't need to be normalised
+	* @param InHalfAngle Half-angle of the cone, in radians. Clamped to just above 0 and just below 90 degrees, the
+	* same as every StevesMathHelpers cone function, see StevesMathHelpers::ClampConeHalfAngle
+	* @param InLength Length of the cone
+	*/
+	FStevesCone(const FVector& InOrigin, const FVector& InDirection, float InHalfAngle, float InLength) :
+		Origin(InOrigin),
+		Direction(InDirection.GetSafeNormal()),
+		HalfAngle(StevesMathHelpers::ClampConeHalfAngle(InHalfAngle)),
+		Length(InLength)
+	{
+		if (Direction.IsZero())
+			Direction = FVector::ForwardVector;
+		SinHalfAngle = FMath::Sin(HalfAngle);
+		InvSinHalfAngle = 1.f / SinHalfAngle;
+		const float CosHalfAngle = FMath::Cos(HalfAngle);
+		CosHalfAngleSq = CosHalfAngle * CosHalfAngle;
+		TanHalfAngle = SinHalfAngle / CosHalfAngle;
+		BaseRadius = Length * TanHalfAngle;
+	}
+
+	/// The apex of the cone pushed back so that its surface is Radius from the real one ("U" in SphereOverlapCone).
+	/// Spheres of this radius overlap the cone only if their centre is inside this expanded cone.
+	FVector GetApexOffset(float Radius) const
+	{
+		return Origin - (Radius * InvSinHalfAngle) * Direction;
+	}
+
+	/// Return whether a point is inside the cone
+	bool Contains(const FVector& Point) const
+	{
+		const FVector CmV = Point - Origin;
+		const float AdCmV = FVector::DotProduct(Direction, CmV);
+		return AdCmV >= 0 && AdCmV <= Length && AdCmV * AdCmV >= CmV.SizeSquared() * CosHalfAngleSq;
+	}
+
+	/// Return whether a sphere overlaps the cone; same results as StevesMathHelpers::SphereOverlapCone
+	bool Overlaps(const FVector& SphereCentre, float SphereRadius) const
+	{
+		// Same algorithm as SphereOverlapCone, with U derived from the vector from the origin
+		const FVector CmV = SphereCentre - Origin;
+		const float AdCmV = FVector::DotProduct(Direction, CmV);
+		const float RInvSin = SphereRadius * InvSinHalfAngle;
+		const float AdCmU = AdCmV + RInvSin;
+		if (AdCmU <= 0)
+			return false;
+
+		const float SqrLengthCmV = CmV.SizeSquared();
+		const float SqrLengthCmU = SqrLengthCmV + RInvSin * (2.f * AdCmV + RInvSin);
+		if (AdCmU * AdCmU < SqrLengthCmU * CosHalfAngleSq)
+			return false;
+
+		if (AdCmV < -SphereRadius || AdCmV > Length + SphereRadius)
+			return false;
+
+		const float RSin = SphereRadius * SinHalfAngle;
+		if (AdCmV < -RSin)
+			return SqrLengthCmV <= SphereRadius * SphereRadius;
+
+		if (AdCmV <= Length - RSin)
+			return true;
+
+		const float LengthAxBarD = FMath::Sqrt(FMath::Max(SqrLengthCmV - AdCmV * AdCmV, 0.f));
+		if (LengthAxBarD <= BaseRadius)
+			return true;
+
+		const float AdBarD = AdCmV - Length;
+		const float Diff = LengthAxBarD - BaseRadius;
+		return AdBarD * AdBarD + Diff * Diff <= SphereRadius * SphereRadius;
+	}
+
+	bool Overlaps(const FSphere& Sphere) const
+	{
+		return Overlaps(Sphere.Center, Sphere.W);
+	}
+
+	/// Return whether an axis-aligned box overlaps the cone, see StevesMathHelpers::BoxOverlapCone. Boxes within 4 float
+	/// epsilons of the largest coordinate relative to the apex count as overlapping.
+	bool Overlaps(const FBox& Box) const
+	{
+		if (!Overlaps(Box.GetCenter(), Box.GetExtent().Size()))
+			return false;
+
+		return StevesMathHelpers::BoxOverlapConeTan(Origin, Direction, TanHalfAngle, Length, Box);
+	}
+
+	/// Return whether a capsule overlaps the cone, see StevesMathHelpers::CapsuleOverlapCone
+	bool Overlaps(const FVector& CapsuleStart, const FVector& CapsuleEnd, float CapsuleRadius) const
+	{
+		return StevesMathHelpers::CapsuleOverlapConeTan(Origin, Direction, TanHalfAngle, Length, CapsuleStart,
+		                                                CapsuleEnd, CapsuleRadius);
+	}
+
+	/// Return the closest point in the cone to a point, which is the point itself if it's inside
+	FVector GetClosestPointTo(const FVector& Point) const
+	{
+		return StevesMathHelpers::ClosestPointOnCone(Origin, Direction, TanHalfAngle, Length, Point);
+	}
+
+	/// Return the distance from a point to the surface of the cone, negative inside. Inside, this is the distance to
+	/// the nearer of the base & the side, extended past the rim, so it can underestimate near the rim.
+	float GetSignedDistance(const FVector& Point) const
+	{
+		const FVector CmV = Point - Origin;
+		const float AdCmV = FVector::DotProduct(Direction, CmV);
+		const float Radial = FMath::Sqrt(FMath::Max(CmV.SizeSquared() - AdCmV * AdCmV, 0.f));
+		if (AdCmV >= 0 && AdCmV <= Length && Radial <= AdCmV * TanHalfAngle)
+		{
+			const float ToSide = (AdCmV * TanHalfAngle - Radial) * FMath::Sqrt(CosHalfAngleSq);
+			return -FMath::Min(Length - AdCmV, ToSide);
+		}
+		return FVector::Dist(Point, GetClosestPointTo(Point));
+	}
+
+	/// Find where a ray first hits the cone, see StevesMathHelpers::RayIntersectCone
+	bool IntersectRay(const FVector& RayOrigin, const FVector& RayDir, float& OutDistance) const
+	{
+		return StevesMathHelpers::RayIntersectCone(RayOrigin, RayDir, Origin, Direction, HalfAngle, Length, OutDistance);
+	}
+
+	/**
+	* @brief Test many spheres against this cone
+	* @param Spheres The spheres to test
+	* @param OutIndices Indices of overlapping spheres are added to this, in ascending order
+	* @return The number of overlapping spheres
+	*/
+	int32 OverlapsAll(TArrayView<const FSphere> Spheres, TArray<int32>& OutIndices) const
+	{
+		const int32 OldNum = OutIndices.Num();
+		for (int32 i = 0; i < Spheres.Num(); ++i)
+		{
+			if (Overlaps(Spheres[i]))
+				OutIndices.Add(i);
+		}
+		return OutIndices.Num() - OldNum;
+	}
+
+	/// Test many spheres against this cone with SIMD, see StevesMathHelpers::SphereOverlapConeBatch
+	int32 OverlapsAll(const FStevesSphereArray& Spheres, TArray<int32>& OutIndices) const
+	{
+		return StevesMathHelpers::SphereOverlapConeBatch(Origin, Direction, HalfAngle, Length, Spheres, OutIndices);
+	}
+
+	/// Test many spheres against this cone with SIMD, see StevesMathHelpers::SphereOverlapConeBatch
+	void OverlapsAll(const FStevesSphereArray& Spheres, TArray<uint32>& OutMask) const
+	{
+		StevesMathHelpers::SphereOverlapConeBatch(Origin, Direction, HalfAngle, Length, Spheres, OutMask);
+	}
+
+	/// Test many capsules against this cone, see StevesMathHelpers::CapsuleOverlapConeBatch
+	void OverlapsAll(const FStevesCapsuleArray& Capsules, TArray<uint32>& OutMask) const
+	{
+		StevesMathHelpers::CapsuleOverlapConeBatch(Origin, Direction, HalfAngle, Length, Capsules, OutMask);
+	}
+
+	/// Test many capsules against this cone, adding the indices of the ones which overlap to OutIndices
+	int32 OverlapsAll(const FStevesCapsuleArray& Capsules, TArray<int32>& OutIndices) const
+	{
+		TArray<uint32> Mask;
+		OverlapsAll(Capsules, Mask);
+		return StevesMathHelpers::AppendMaskIndices(Mask, OutIndices);
+	}
+
+	/// Test many axis-aligned boxes against this cone, see StevesMathHelpers::BoxOverlapConeBatch
+	void OverlapsAll(const FStevesBoxArray& Boxes, TArray<uint32>& OutMask) const
+	{
+		StevesMathHelpers::BoxOverlapConeBatch(Origin, Direction, HalfAngle, Length, Boxes, OutMask);
+	}
+
+	/// Test many axis-aligned boxes against this cone, adding the indices of the ones which overlap to OutIndices
+	int32 OverlapsAll(const FStevesBoxArray& Boxes, TArray<int32>& OutIndices) const
+	{
+		TArray<uint32> Mask;
+		OverlapsAll(Boxes, Mask);
+		return StevesMathHelpers::AppendMaskIndices(Mask, OutIndices);
+	}
+
+	/// Find where many rays first hit this cone with SIMD, see StevesMathHelpers::RayIntersectConeBatch
+	void IntersectRays(const FStevesRayArray& Rays, TArray<uint32>& OutMask, TArray<float>& OutDistances) const
+	{
+		StevesMathHelpers::RayIntersectConeBatch(Rays, Origin, Direction, HalfAngle, Length, OutMask, OutDistances);
+	}
+};
@@ -0,0 +1,135 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StevesCone.h"
+
+/**
+ * Remembers whether each of a set of targets overlapped a cone, so that targets which are re-tested every frame
+ * (e.g. against an AI's vision cone) are only properly tested again when the answer could have changed.
+ *
+ * Each test records how far the target's sphere was from changing state: the gap to the cone if it was outside, or
+ * how deep it was if it overlapped. When the cone changes, an upper bound on how far its surface could have moved is
+ * accumulated. The cached answer is used while the target's movement, its change in radius & the cone's movement
+ * since the test add up to less than that margin, so it's always the same answer a new test would give (to float
+ * precision). Slow moving scenes mostly skip the test; fast moving ones pay a small overhead for the bookkeeping.
+ *
+ * TKey identifies targets, e.g. an index, or an FObjectKey for actors. Entries aren't removed automatically, so call
+ * Remove for targets which are gone.
+ */
+template <typename TKey>
+class TStevesConeQueryCache
+{
+public:
+	/// Set the cone to test against, e.g. once per frame
+	void SetCone(const FStevesCone& InCone)
+	{
+		if (bHasCone)
+			ConeMovement += GetMaxSurfaceMovement(Cone, InCone);
+		Cone = InCone;
+		bHasCone = true;
+	}
+
+	const FStevesCone& GetCone() const { return Cone; }
+
+	/// Return whether a target sphere overlaps the cone, only testing it if it could have changed since last time
+	bool Overlaps(const TKey& Key, const FVector& Centre, float Radius)
+	{
+		check(bHasCone);
+		FEntry* Entry = Entries.Find(Key);
+		if (Entry)
+		{
+			const double Movement = FVector::Dist(Centre, Entry->Centre) + FMath::Abs(Radius - Entry->Radius) +
+				(ConeMovement - Entry->ConeMovement);
+			if (Movement < Entry->Margin)
+			{
+				++NumSkipped;
+				return Entry->bOverlaps;
+			}
+		}
+		else
+		{
+			Entry = &Entries.Add(Key);
+		}
+
+		++NumTested;
+		Entry->Centre = Centre;
+		Entry->Radius = Radius;
+		Entry->ConeMovement = ConeMovement;
+		Entry->bOverlaps = Cone.Overlaps(Centre, Radius);
+		// Overlapping spheres are Radius - Distance deep, the rest are Distance - Radius away
+		Entry->Margin = FMath::Abs(Cone.GetSignedDistance(Centre) - Radius);
+		return Entry->bOverlaps;
+	}
+
+	bool Overlaps(const TKey& Key, const FSphere& Sphere)
+	{
+		return Overlaps(Key, Sphere.Center, Sphere.W);
+	}
+
+	/// Forget a target
+	void Remove(const TKey& Key)
+	{
+		Entries.Remove(Key);
+	}
+
+	/// Forget all targets
+	void Reset()
+	{
+		Entries.Reset();
+		ConeMovement = 0;
+	}
+
+	int32 Num() const { return Entries.Num(); }
+
+	/// Number of calls to Overlaps which had to test the cone since the last ResetStats
+	int32 GetNumTested() const { return NumTested; }
+	/// Number of calls to Overlaps which used the cached answer since the last ResetStats
+	int32 GetNumSkipped() const { return NumSkipped; }
+
+	void ResetStats()
+	{
+		NumTested = 0;
+		NumSkipped = 0;
+	}
+
+	/**
+	* @brief Return an upper bound on the Hausdorff distance between two cones, i.e. how far any point on the surface
+	* of one is from the other. Made up of the apex moving, the cone rotating about the apex, the base radius
+	* changing & the length changing, each of which moves no point further than this.
+	*/
+	static float GetMaxSurfaceMovement(const FStevesCone& From, const FStevesCone& To)
+	{
+		// Scaling from the apex moves the rim furthest, along the side
+		const float Lengthen = FMath::Abs(To.Length - From.Length) * FMath::Sqrt(1.f + From.TanHalfAngle * From.TanHalfAngle);
+		// Changing the angle at the new length moves points out from the axis, the rim furthest
+		const float Widen = FMath::Abs(To.BaseRadius - To.Length * From.TanHalfAngle);
+		// Rotating moves each point along a chord, the rim furthest from the apex
+		const float SlantLength = FMath::Sqrt(To.Length * To.Length + To.BaseRadius * To.BaseRadius);
+		const float Rotate = SlantLength * FVector::Dist(From.Direction, To.Direction);
+		return FVector::Dist(From.Origin, To.Origin) + Lengthen + Widen + Rotate;
+	}
+
+protected:
+	struct FEntry
+	{
+		/// Sphere when it was last tested
+		FVector Centre;
+		float Radius;
+		/// How far the sphere & cone could move together before the answer might change
+		float Margin;
+		/// ConeMovement when it was last tested
+		double ConeMovement;
+		bool bOverlaps;
+	};
+
+	FStevesCone Cone;
+	bool bHasCone = false;
+	/// Total of the cone's possible surface movement over every SetCone
+	double ConeMovement = 0;
+	TMap<TKey, FEntry> Entries;
+
+	int32 NumTested = 0;
+	int32 NumSkipped = 0;
+};
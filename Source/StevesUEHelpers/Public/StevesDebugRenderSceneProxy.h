@@ -4,34 +4,123 @@
 
 #include "CoreMinimal.h"
 #include "DebugRenderSceneProxy.h"
+#include "DynamicMeshBuilder.h"
+#include "LocalVertexFactory.h"
+#include "StaticMeshResources.h"
 
 /**
- * An extension to FDebugRenderSceneProxy to support other shapes, e.g. circles and arcs
+ * An extension to FDebugRenderSceneProxy to support other shapes, e.g. circles, arcs, cylinders, cones, frustums and
+ * polylines, some of which can be solid. Shapes are built from unit shapes in FStevesDebugShapeCache.
+ *
+ * If bCacheShapes is enabled, thin line shapes are tessellated once when render resources are created, into a
+ * static line list which is drawn as one mesh element per depth priority per view. Per-frame cost is then
+ * independent of the number of shapes. Anything which can't be cached (thick or translucent lines, solids, text) is
+ * drawn every frame: lines from every shape type are collected into one bucket per depth priority & thickness, each
+ * submitted as one reserved run of batched lines.
+ * Wire boxes, spheres, cylinders etc are instances of a shared unit mesh, generated once, stamped with each shape's
+ * transform and colour. Solid shapes are drawn every frame, one mesh per colour & depth priority.
+ *
+ * If bLocalSpace is enabled, all shapes are expected in component space and are transformed at render time, so the
+ * proxy doesn't need to be recreated when the component moves. Base class shapes other than lines, arrows, boxes &
+ * spheres are not supported in this mode.
  */
 class FStevesDebugRenderSceneProxy : public FDebugRenderSceneProxy
 {
 public:
-	FStevesDebugRenderSceneProxy(const UPrimitiveComponent* InComponent)
-		: FDebugRenderSceneProxy(InComponent)
-	{
-	}
+	STEVESUEHELPERS_API FStevesDebugRenderSceneProxy(const UPrimitiveComponent* InComponent, bool bInCacheShapes = false,
+	                                                 bool bInLocalSpace = false);
+	STEVESUEHELPERS_API virtual ~FStevesDebugRenderSceneProxy() override;
+
+	STEVESUEHELPERS_API virtual void CreateRenderThreadResources() override;
 
 	STEVESUEHELPERS_API virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily,
 	                                    uint32 VisibilityMap, FMeshElementCollector& Collector) const override;
 
 	STEVESUEHELPERS_API virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override;
 
-	struct FDebugCircle
+	/// Line thickness & depth priority, which all of our shapes have. Shapes with the same style are drawn together.
+	struct FDebugShapeStyle
+	{
+		FDebugShapeStyle(float InThickness = 0, ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			Thickness(InThickness),
+			DepthPriority(InDepthPriority)
+		{
+		}
+
+		float Thickness;
+		ESceneDepthPriorityGroup DepthPriority;
+	};
+
+	/// Same as FDebugLine but with a style
+	struct FStyledLine : FDebugShapeStyle
+	{
+		FStyledLine(const FVector& InStart, const FVector& InEnd, const FColor& InColor, float InThickness = 0,
+		            ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
+			Start(InStart),
+			End(InEnd),
+			Color(InColor)
+		{
+		}
+
+		FVector Start;
+		FVector End;
+		FColor Color;
+	};
+
+	/// Same as FArrowLine but with a style
+	typedef FStyledLine FStyledArrow;
+
+	/// Same as FSphere but with a style, and optionally solid
+	struct FStyledSphere : FDebugShapeStyle
+	{
+		FStyledSphere(const FVector& InLocation, float InRadius, const FColor& InColor, bool bInSolid,
+		              float InThickness = 0, ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
+			Location(InLocation),
+			Radius(InRadius),
+			Color(InColor),
+			bSolid(bInSolid)
+		{
+		}
+
+		FVector Location;
+		float Radius;
+		FColor Color;
+		bool bSolid;
+	};
+
+	/// Same as FDebugBox but with a style, and optionally solid
+	struct FStyledBox : FDebugShapeStyle
+	{
+		FStyledBox(const FBox& InBox, const FTransform& InTransform, const FColor& InColor, bool bInSolid,
+		           float InThickness = 0, ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
+			Box(InBox),
+			Transform(InTransform),
+			Color(InColor),
+			bSolid(bInSolid)
+		{
+		}
+
+		FBox Box;
+		FTransform Transform;
+		FColor Color;
+		bool bSolid;
+	};
+
+	struct FDebugCircle : FDebugShapeStyle
 	{
 		FDebugCircle(const FVector& InCentre, const FVector& InX, const FVector& InY, float InRadius, int InNumSegments,
-		             const FColor& InColor, float InThickness = 0) :
+		             const FColor& InColor, float InThickness = 0,
+		             ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
 			Centre(InCentre),
 			X(InX),
 			Y(InY),
 			Radius(InRadius),
 			NumSegments(InNumSegments),
-			Color(InColor),
-			Thickness(InThickness)
+			Color(InColor)
 		{
 		}
 
@@ -41,14 +130,15 @@ public:
 		float Radius;
 		int NumSegments;
 		FColor Color;
-		float Thickness;
 	};
 
 	/// An arc which is a section of a circle
-	struct FDebugArc
+	struct FDebugArc : FDebugShapeStyle
 	{
 		FDebugArc(const FVector& InCentre, const FVector& InX, const FVector& InY, float InMinAngle, float InMaxAngle,
-		          float InRadius, int InNumSegments, const FColor& InColor) :
+		          float InRadius, int InNumSegments, const FColor& InColor, float InThickness = 0,
+		          ESceneDepthPriorityGroup InDepthPriority = SDPG_Foreground) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
 			Centre(InCentre),
 			X(InX),
 			Y(InY),
@@ -70,6 +160,160 @@ public:
 		FColor Color;
 	};
 
+	/// Cylinder around the Z axis
+	struct FDebugCylinder : FDebugShapeStyle
+	{
+		FDebugCylinder(const FVector& InCentre, const FVector& InX, const FVector& InY, const FVector& InZ,
+		               float InRadius, float InHalfHeight, int InNumSegments, const FColor& InColor, bool bInSolid,
+		               float InThickness = 0, ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
+			Centre(InCentre),
+			X(InX),
+			Y(InY),
+			Z(InZ),
+			Radius(InRadius),
+			HalfHeight(InHalfHeight),
+			NumSegments(InNumSegments),
+			Color(InColor),
+			bSolid(bInSolid)
+		{
+		}
+
+		FVector Centre;
+		FVector X;
+		FVector Y;
+		FVector Z;
+		float Radius;
+		float HalfHeight;
+		int NumSegments;
+		FColor Color;
+		bool bSolid;
+	};
+
+	/// Capsule around the Z axis; HalfHeight includes the hemispheres, like UCapsuleComponent
+	struct FDebugCapsule : FDebugCylinder
+	{
+		using FDebugCylinder::FDebugCylinder;
+	};
+
+	/// Cone with a flat base, as used by StevesMathHelpers::SphereOverlapCone
+	struct FDebugCone : FDebugShapeStyle
+	{
+		FDebugCone(const FVector& InOrigin, const FVector& InDirection, float InHalfAngle, float InLength,
+		           int InNumSegments, const FColor& InColor, bool bInSolid, float InThickness = 0,
+		           ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
+			Origin(InOrigin),
+			Direction(InDirection),
+			HalfAngle(InHalfAngle),
+			Length(InLength),
+			NumSegments(InNumSegments),
+			Color(InColor),
+			bSolid(bInSolid)
+		{
+		}
+
+		FVector Origin;
+		/// Must be normalised
+		FVector Direction;
+		/// In radians
+		float HalfAngle;
+		float Length;
+		int NumSegments;
+		FColor Color;
+		bool bSolid;
+	};
+
+	/// Frustum from its 8 corners, see FStevesDebugShapeCache::BoxTriangleCorners for the order
+	struct FDebugFrustum : FDebugShapeStyle
+	{
+		FDebugFrustum(const FVector (&InCorners)[8], const FColor& InColor, bool bInSolid, float InThickness = 0,
+		              ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
+			Color(InColor),
+			bSolid(bInSolid)
+		{
+			FMemory::Memcpy(Corners, InCorners, sizeof(Corners));
+		}
+
+		FVector Corners[8];
+		FColor Color;
+		bool bSolid;
+	};
+
+	/// Connected line segments
+	struct FDebugPolyline : FDebugShapeStyle
+	{
+		FDebugPolyline(const TArray<FVector>& InPoints, bool bInClosed, const FColor& InColor, float InThickness = 0,
+		               ESceneDepthPriorityGroup InDepthPriority = SDPG_World) :
+			FDebugShapeStyle(InThickness, InDepthPriority),
+			Points(InPoints),
+			bClosed(bInClosed),
+			Color(InColor)
+		{
+		}
+
+		TArray<FVector> Points;
+		bool bClosed;
+		FColor Color;
+	};
+
+	/// The base class Lines, ArrowLines, Spheres & Boxes are moved into these when render resources are created
+	TArray<FStyledLine> StyledLines;
+	TArray<FStyledArrow> StyledArrows;
+	TArray<FStyledSphere> StyledSpheres;
+	TArray<FStyledBox> StyledBoxes;
 	TArray<FDebugCircle> Circles;
 	TArray<FDebugArc> Arcs;
+	TArray<FDebugCylinder> DebugCylinders;
+	TArray<FDebugCapsule> DebugCapsules;
+	TArray<FDebugCone> DebugCones;
+	TArray<FDebugFrustum> Frustums;
+	TArray<FDebugPolyline> Polylines;
+
+	/// Per-view level of detail settings
+	struct FLODSettings
+	{
+		/// Pick the number of segments for circles & arcs in each view from their size on screen, instead of using
+		/// their NumSegments. Circles & arcs aren't cached when this is enabled.
+		bool bSegmentLOD = false;
+		/// Segment limits for a full circle when bSegmentLOD is enabled, arcs use a proportion of these
+		int32 MinSegments = 4;
+		int32 MaxSegments = 64;
+		/// Don't draw anything with a radius on screen smaller than this many pixels
+		float CullPixelRadius = 1.f;
+	};
+	/// Must be set before the proxy is added to the scene
+	FLODSettings LODSettings;
+
+protected:
+	/// Whether to tessellate shapes into static buffers rather than drawing them every frame
+	bool bCacheShapes;
+	/// Whether shapes are in component space rather than world space
+	bool bLocalSpace;
+	/// Whether any shapes need the translucent solid material
+	bool bHasSolidShapes = false;
+
+	/// A range of the cached index buffer which is drawn as one mesh element
+	struct FCachedLineBatch
+	{
+		ESceneDepthPriorityGroup DepthPriority;
+		uint32 FirstIndex;
+		uint32 NumLines;
+	};
+	TArray<FCachedLineBatch> CachedBatches;
+	uint32 NumCachedVertices = 0;
+
+	FStaticMeshVertexBuffers VertexBuffers;
+	FDynamicMeshIndexBuffer32 IndexBuffer;
+	FLocalVertexFactory VertexFactory;
+
+	/// Move the base class shapes we can draw into our own lists
+	void AdoptBaseShapes();
+	/// Tessellate everything which can be cached into the static buffers, and remove it from the per-frame lists
+	void BuildCachedShapes();
+
+	/// Get the number of segments to draw a circle / arc with in a view, or 0 if it should be culled
+	int32 GetLODSegments(const FVector& WorldCentre, float WorldRadius, float AngleRange, int32 NumSegments,
+	                     const FSceneView& View) const;
 };
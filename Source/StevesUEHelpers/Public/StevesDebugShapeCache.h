@@ -0,0 +1,51 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// Shapes available from FStevesDebugShapeCache
+enum class EStevesDebugUnitShape : uint8
+{
+	/// Radius 1 in the X/Y plane
+	Circle,
+	/// Radius 1, wireframe is 3 rings
+	Sphere,
+	/// Top (+Z) half of Sphere, wireframe includes the equator
+	Hemisphere,
+	/// Radius 1, from Z=-1 to Z=1, with caps
+	Cylinder,
+	/// Sides of Cylinder only; wireframe is just the 4 lines joining the ends
+	OpenCylinder,
+	/// Apex at the origin pointing down +X, base of radius 1 at X=1
+	Cone,
+	/// From 0 to 1 on each axis; NumSegments is ignored
+	Box
+};
+
+/// Unit-space geometry for a debug shape, transformed for each use
+struct FStevesDebugUnitShape
+{
+	/// Pairs of points, for wireframe drawing
+	TArray<FVector> Lines;
+	/// Triples of points, for solid drawing
+	TArray<FVector> Triangles;
+};
+
+/**
+ * Process-wide cache of unit debug shapes, keyed by shape & number of segments. Each is generated once on first
+ * use and never freed, so debug drawing only needs a transform per shape rather than recalculating the trig.
+ */
+class STEVESUEHELPERS_API FStevesDebugShapeCache
+{
+public:
+	/// Get a unit shape, generating it if needed. Safe to call from any thread; the result is valid forever.
+	static const FStevesDebugUnitShape& Get(EStevesDebugUnitShape Shape, int32 NumSegments);
+
+	/// Corner indices of the 12 triangles of a box / frustum, where bit 0 of a corner index is X (or right),
+	/// bit 1 is Y (or up) and bit 2 is Z (or far). Edges join corners which differ by one bit.
+	static const int32 BoxTriangleCorners[36];
+
+protected:
+	static void Generate(EStevesDebugUnitShape Shape, int32 NumSegments, FStevesDebugUnitShape& OutShape);
+};
@@ -0,0 +1,30 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StevesEditorVisComponent.h"
+#include "StevesDebugVisComponent.generated.h"
+
+/**
+ * A runtime version of UStevesEditorVisComponent, for debugging gameplay. Uses the same shapes, but is visible in game
+ * (and in the editor) whenever the console variable Steves.DebugVis is enabled. Unlike DrawDebugLine etc, shapes are
+ * only sent to the renderer when they change, so persistent debug shapes cost nothing per frame. Combine with
+ * bUseSharedBatcher for lots of small components.
+ *
+ * Never draws anything in Shipping builds.
+ */
+UCLASS(Blueprintable, ClassGroup="Utility", hidecategories=(Collision,Physics,Object,LOD,Lighting,TextureStreaming),
+	meta=(DisplayName="Steves Debug Visualisation", BlueprintSpawnableComponent))
+class STEVESUEHELPERS_API UStevesDebugVisComponent : public UStevesEditorVisComponent
+{
+	GENERATED_BODY()
+
+public:
+	UStevesDebugVisComponent(const FObjectInitializer& ObjectInitializer);
+
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+
+	/// Whether debug vis is currently enabled by the Steves.DebugVis console variable
+	static bool IsDebugVisEnabled();
+};
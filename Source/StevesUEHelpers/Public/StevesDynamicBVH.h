@@ -0,0 +1,395 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ConvexVolume.h"
+#include "StevesCone.h"
+
+/**
+ * A dynamic bounding volume hierarchy, for finding candidates for overlap tests in O(log n) rather than testing
+ * everything. Each entry has an FBoxSphereBounds and a Value (e.g. an actor pointer or index).
+ *
+ * This is an AABB tree like Box2D's b2DynamicTree: leaves hold a "fat" box, expanded by Margin, so entries which move
+ * a little don't change the tree at all; inserts pick a sibling by surface area and rotations keep it balanced.
+ * Nodes live in one array and refer to each other by index, so there's no per-node allocation.
+ *
+ * Queries test nodes with their boxes, then entries with their own bounds, and call Func(Id, Value) for each entry
+ * which overlaps. The tree isn't thread safe; queries can run concurrently with each other but not with changes.
+ *
+ * TValue must be default constructible & copyable.
+ */
+template <typename TValue>
+class TStevesDynamicBVH
+{
+public:
+	explicit TStevesDynamicBVH(float InMargin = 10.f) : Margin(InMargin)
+	{
+	}
+
+	/// Add an entry, returning its id for Update / Remove
+	int32 Insert(const FBoxSphereBounds& Bounds, const TValue& Value)
+	{
+		const int32 Id = AllocateNode();
+		FNode& Node = Nodes[Id];
+		Node.Box = Bounds.GetBox().ExpandBy(Margin);
+		Node.Bounds = Bounds;
+		Node.Value = Value;
+		Node.Height = 0;
+		InsertLeaf(Id);
+		++NumEntries;
+		return Id;
+	}
+
+	/// Change an entry's bounds. Returns true if it had to be moved in the tree, false if it's still in its fat box.
+	bool Update(int32 Id, const FBoxSphereBounds& Bounds)
+	{
+		check(IsLeaf(Id));
+		FNode& Node = Nodes[Id];
+		Node.Bounds = Bounds;
+		const FBox Box = Bounds.GetBox();
+		if (Contains(Node.Box, Box))
+			return false;
+
+		RemoveLeaf(Id);
+		Nodes[Id].Box = Box.ExpandBy(Margin);
+		InsertLeaf(Id);
+		return true;
+	}
+
+	void Remove(int32 Id)
+	{
+		check(IsLeaf(Id));
+		RemoveLeaf(Id);
+		FreeNode(Id);
+		--NumEntries;
+	}
+
+	void Reset()
+	{
+		Nodes.Reset();
+		Root = INDEX_NONE;
+		FreeList = INDEX_NONE;
+		NumEntries = 0;
+	}
+
+	const TValue& GetValue(int32 Id) const { return Nodes[Id].Value; }
+	TValue& GetValue(int32 Id) { return Nodes[Id].Value; }
+	const FBoxSphereBounds& GetBounds(int32 Id) const { return Nodes[Id].Bounds; }
+	int32 Num() const { return NumEntries; }
+	/// Height of the tree, 0 if it's empty or has one entry
+	int32 GetHeight() const { return Root == INDEX_NONE ? 0 : Nodes[Root].Height; }
+
+	/// Find entries whose box overlaps a box
+	template <typename TFunc>
+	void QueryBox(const FBox& Box, TFunc Func) const
+	{
+		Query([&](const FBox& NodeBox) { return NodeBox.Intersect(Box); },
+		      [&](const FBoxSphereBounds& Bounds) { return Bounds.GetBox().Intersect(Box); },
+		      Func);
+	}
+
+	/// Find entries whose bounds overlap a sphere
+	template <typename TFunc>
+	void QuerySphere(const FVector& Centre, float Radius, TFunc Func) const
+	{
+		const float RadiusSq = Radius * Radius;
+		Query([&](const FBox& NodeBox) { return FMath::SphereAABBIntersection(Centre, RadiusSq, NodeBox); },
+		      [&](const FBoxSphereBounds& Bounds)
+		      {
+			      return FVector::DistSquared(Bounds.Origin, Centre) <= FMath::Square(Radius + Bounds.SphereRadius) &&
+				      FMath::SphereAABBIntersection(Centre, RadiusSq, Bounds.GetBox());
+		      },
+		      Func);
+	}
+
+	/// Find entries whose bounding sphere overlaps a cone
+	template <typename TFunc>
+	void QueryCone(const FStevesCone& Cone, TFunc Func) const
+	{
+		Query([&](const FBox& NodeBox) { return Cone.Overlaps(NodeBox.GetCenter(), NodeBox.GetExtent().Size()); },
+		      [&](const FBoxSphereBounds& Bounds) { return Cone.Overlaps(Bounds.Origin, Bounds.SphereRadius); },
+		      Func);
+	}
+
+	/// Find entries whose bounds overlap a frustum (or any convex volume)
+	template <typename TFunc>
+	void QueryFrustum(const FConvexVolume& Frustum, TFunc Func) const
+	{
+		Query([&](const FBox& NodeBox) { return Frustum.IntersectBox(NodeBox.GetCenter(), NodeBox.GetExtent()); },
+		      [&](const FBoxSphereBounds& Bounds)
+		      {
+			      return Frustum.IntersectSphere(Bounds.Origin, Bounds.SphereRadius) &&
+				      Frustum.IntersectBox(Bounds.Origin, Bounds.BoxExtent);
+		      },
+		      Func);
+	}
+
+protected:
+	struct FNode
+	{
+		/// Fat box for leaves, union of children for others
+		FBox Box = FBox(ForceInit);
+		/// Entry bounds, leaves only
+		FBoxSphereBounds Bounds;
+		TValue Value;
+		int32 Parent = INDEX_NONE;
+		/// Child1 is also the next free node for nodes in the free list
+		int32 Child1 = INDEX_NONE;
+		int32 Child2 = INDEX_NONE;
+		/// 0 for leaves, -1 for free nodes
+		int32 Height = 0;
+	};
+
+	TArray<FNode> Nodes;
+	int32 Root = INDEX_NONE;
+	int32 FreeList = INDEX_NONE;
+	int32 NumEntries = 0;
+	float Margin;
+
+	bool IsLeaf(int32 Index) const { return Nodes[Index].Height == 0; }
+
+	static float GetArea(const FBox& Box)
+	{
+		// Half the surface area, which is all the heuristic needs
+		const FVector Size = Box.GetSize();
+		return Size.X * Size.Y + Size.Y * Size.Z + Size.Z * Size.X;
+	}
+
+	static bool Contains(const FBox& Outer, const FBox& Inner)
+	{
+		return Outer.Min.X <= Inner.Min.X && Outer.Min.Y <= Inner.Min.Y && Outer.Min.Z <= Inner.Min.Z &&
+			Outer.Max.X >= Inner.Max.X && Outer.Max.Y >= Inner.Max.Y && Outer.Max.Z >= Inner.Max.Z;
+	}
+
+	int32 AllocateNode()
+	{
+		if (FreeList == INDEX_NONE)
+			return Nodes.AddDefaulted();
+
+		const int32 Index = FreeList;
+		FreeList = Nodes[Index].Child1;
+		Nodes[Index] = FNode();
+		return Index;
+	}
+
+	void FreeNode(int32 Index)
+	{
+		FNode& Node = Nodes[Index];
+		Node.Value = TValue();
+		Node.Parent = INDEX_NONE;
+		Node.Child1 = FreeList;
+		Node.Child2 = INDEX_NONE;
+		Node.Height = -1;
+		FreeList = Index;
+	}
+
+	void InsertLeaf(int32 Leaf)
+	{
+		if (Root == INDEX_NONE)
+		{
+			Root = Leaf;
+			Nodes[Leaf].Parent = INDEX_NONE;
+			return;
+		}
+
+		// Find the best sibling, by the surface area heuristic
+		const FBox LeafBox = Nodes[Leaf].Box;
+		int32 Index = Root;
+		while (!IsLeaf(Index))
+		{
+			const FNode& Node = Nodes[Index];
+			const float Area = GetArea(Node.Box);
+			const float CombinedArea = GetArea(Node.Box + LeafBox);
+			// Cost of making a new parent for this node and the leaf
+			const float Cost = 2.f * CombinedArea;
+			// Minimum cost of pushing the leaf further down the tree
+			const float InheritanceCost = 2.f * (CombinedArea - Area);
+
+			auto GetDescendCost = [&](int32 Child)
+			{
+				const float NewArea = GetArea(Nodes[Child].Box + LeafBox);
+				return (IsLeaf(Child) ? NewArea : NewArea - GetArea(Nodes[Child].Box)) + InheritanceCost;
+			};
+			const float Cost1 = GetDescendCost(Node.Child1);
+			const float Cost2 = GetDescendCost(Node.Child2);
+
+			if (Cost < Cost1 && Cost < Cost2)
+				break;
+
+			Index = Cost1 < Cost2 ? Node.Child1 : Node.Child2;
+		}
+		const int32 Sibling = Index;
+
+		// New parent for the leaf & sibling; may reallocate Nodes so don't hold references across this
+		const int32 OldParent = Nodes[Sibling].Parent;
+		const int32 NewParent = AllocateNode();
+		{
+			FNode& Parent = Nodes[NewParent];
+			Parent.Parent = OldParent;
+			Parent.Box = LeafBox + Nodes[Sibling].Box;
+			Parent.Height = Nodes[Sibling].Height + 1;
+			Parent.Child1 = Sibling;
+			Parent.Child2 = Leaf;
+		}
+		Nodes[Sibling].Parent = NewParent;
+		Nodes[Leaf].Parent = NewParent;
+
+		if (OldParent != INDEX_NONE)
+		{
+			if (Nodes[OldParent].Child1 == Sibling)
+				Nodes[OldParent].Child1 = NewParent;
+			else
+				Nodes[OldParent].Child2 = NewParent;
+		}
+		else
+		{
+			Root = NewParent;
+		}
+
+		Refit(Nodes[Leaf].Parent);
+	}
+
+	void RemoveLeaf(int32 Leaf)
+	{
+		if (Leaf == Root)
+		{
+			Root = INDEX_NONE;
+			return;
+		}
+
+		const int32 Parent = Nodes[Leaf].Parent;
+		const int32 GrandParent = Nodes[Parent].Parent;
+		const int32 Sibling = Nodes[Parent].Child1 == Leaf ? Nodes[Parent].Child2 : Nodes[Parent].Child1;
+
+		// The sibling takes the parent's place
+		if (GrandParent != INDEX_NONE)
+		{
+			if (Nodes[GrandParent].Child1 == Parent)
+				Nodes[GrandParent].Child1 = Sibling;
+			else
+				Nodes[GrandParent].Child2 = Sibling;
+			Nodes[Sibling].Parent = GrandParent;
+			FreeNode(Parent);
+			Refit(GrandParent);
+		}
+		else
+		{
+			Root = Sibling;
+			Nodes[Sibling].Parent = INDEX_NONE;
+			FreeNode(Parent);
+		}
+		Nodes[Leaf].Parent = INDEX_NONE;
+	}
+
+	/// Rebalance and recalculate boxes & heights from Index up to the root
+	void Refit(int32 Index)
+	{
+		while (Index != INDEX_NONE)
+		{
+			Index = Balance(Index);
+
+			FNode& Node = Nodes[Index];
+			const FNode& Child1 = Nodes[Node.Child1];
+			const FNode& Child2 = Nodes[Node.Child2];
+			Node.Height = 1 + FMath::Max(Child1.Height, Child2.Height);
+			Node.Box = Child1.Box + Child2.Box;
+
+			Index = Node.Parent;
+		}
+	}
+
+	/// If either child of A is more than 1 taller than the other, rotate it up. Returns the index of the node now in
+	/// A's place.
+	int32 Balance(int32 IndexA)
+	{
+		FNode& A = Nodes[IndexA];
+		if (IsLeaf(IndexA) || A.Height < 2)
+			return IndexA;
+
+		const int32 HeightDiff = Nodes[A.Child2].Height - Nodes[A.Child1].Height;
+		if (HeightDiff > 1)
+			return RotateUp(IndexA, A.Child2, false);
+		if (HeightDiff < -1)
+			return RotateUp(IndexA, A.Child1, true);
+		return IndexA;
+	}
+
+	/// Swap A with its child Up; Up's shorter child becomes A's child in Up's place
+	int32 RotateUp(int32 IndexA, int32 IndexUp, bool bUpIsChild1)
+	{
+		FNode& A = Nodes[IndexA];
+		FNode& Up = Nodes[IndexUp];
+		const int32 IndexOther = bUpIsChild1 ? A.Child2 : A.Child1;
+		const int32 IndexF = Up.Child1;
+		const int32 IndexG = Up.Child2;
+		FNode& F = Nodes[IndexF];
+		FNode& G = Nodes[IndexG];
+
+		Up.Child1 = IndexA;
+		Up.Parent = A.Parent;
+		A.Parent = IndexUp;
+
+		if (Up.Parent != INDEX_NONE)
+		{
+			FNode& Parent = Nodes[Up.Parent];
+			if (Parent.Child1 == IndexA)
+				Parent.Child1 = IndexUp;
+			else
+				Parent.Child2 = IndexUp;
+		}
+		else
+		{
+			Root = IndexUp;
+		}
+
+		// Keep the taller grandchild under Up, give the other to A
+		const bool bKeepF = F.Height > G.Height;
+		const int32 IndexKeep = bKeepF ? IndexF : IndexG;
+		const int32 IndexMove = bKeepF ? IndexG : IndexF;
+		Up.Child2 = IndexKeep;
+		if (bUpIsChild1)
+			A.Child1 = IndexMove;
+		else
+			A.Child2 = IndexMove;
+		Nodes[IndexMove].Parent = IndexA;
+
+		const FNode& Other = Nodes[IndexOther];
+		const FNode& Move = Nodes[IndexMove];
+		const FNode& Keep = Nodes[IndexKeep];
+		A.Box = Other.Box + Move.Box;
+		A.Height = 1 + FMath::Max(Other.Height, Move.Height);
+		Up.Box = A.Box + Keep.Box;
+		Up.Height = 1 + FMath::Max(A.Height, Keep.Height);
+
+		return IndexUp;
+	}
+
+	template <typename TNodeTest, typename TLeafTest, typename TFunc>
+	void Query(TNodeTest NodeTest, TLeafTest LeafTest, TFunc& Func) const
+	{
+		if (Root == INDEX_NONE)
+			return;
+
+		TArray<int32, TInlineAllocator<64>> Stack;
+		Stack.Push(Root);
+		while (Stack.Num() > 0)
+		{
+			const int32 Index = Stack.Pop(false);
+			const FNode& Node = Nodes[Index];
+			if (!NodeTest(Node.Box))
+				continue;
+
+			if (IsLeaf(Index))
+			{
+				if (LeafTest(Node.Bounds))
+					Func(Index, Node.Value);
+			}
+			else
+			{
+				Stack.Push(Node.Child1);
+				Stack.Push(Node.Child2);
+			}
+		}
+	}
+};
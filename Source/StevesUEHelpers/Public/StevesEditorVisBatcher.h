@@ -0,0 +1,193 @@
+﻿// Copyright 2020 Old Doorways Ltd
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "UObject/ObjectKey.h"
+#include "StevesDebugRenderSceneProxy.h"
+#include "StevesEditorVisBatcher.generated.h"
+
+/// Component space shapes for one component. Each shape type is kept in its own flat array.
+struct STEVESUEHELPERS_API FStevesEditorVisBatchShapes
+{
+	TArray<FStevesDebugRenderSceneProxy::FStyledLine> StyledLines;
+	TArray<FStevesDebugRenderSceneProxy::FStyledArrow> StyledArrows;
+	TArray<FStevesDebugRenderSceneProxy::FDebugCircle> Circles;
+	TArray<FStevesDebugRenderSceneProxy::FDebugArc> Arcs;
+	TArray<FStevesDebugRenderSceneProxy::FStyledSphere> StyledSpheres;
+	TArray<FStevesDebugRenderSceneProxy::FStyledBox> StyledBoxes;
+	TArray<FStevesDebugRenderSceneProxy::FDebugCylinder> DebugCylinders;
+	TArray<FStevesDebugRenderSceneProxy::FDebugCapsule> DebugCapsules;
+	TArray<FStevesDebugRenderSceneProxy::FDebugCone> DebugCones;
+	TArray<FStevesDebugRenderSceneProxy::FDebugFrustum> Frustums;
+	TArray<FStevesDebugRenderSceneProxy::FDebugPolyline> Polylines;
+
+	/// Call Func(Array) for each shape array
+	template <typename TFunc>
+	void ForEachArray(TFunc Func) const
+	{
+		Func(StyledLines);
+		Func(StyledArrows);
+		Func(Circles);
+		Func(Arcs);
+		Func(StyledSpheres);
+		Func(StyledBoxes);
+		Func(DebugCylinders);
+		Func(DebugCapsules);
+		Func(DebugCones);
+		Func(Frustums);
+		Func(Polylines);
+	}
+};
+
+/**
+ * One component's shapes prepared for the batch proxy. Thin opaque wireframe shapes are tessellated once into flat
+ * point & colour arrays, which are copied straight into the component's range of the proxy's line buffers; everything
+ * else is kept to be drawn every frame. Never changed once built, so it's shared with the render thread.
+ */
+struct STEVESUEHELPERS_API FStevesEditorVisBatchEntryData
+{
+	/// Line end points in component space, 2 per line, for each depth priority
+	TArray<FVector> LinePoints[SDPG_MAX];
+	/// Colour of each point in LinePoints
+	TArray<FColor> LineColours[SDPG_MAX];
+	/// Shapes which can't go in the line buffers (thick, translucent or solid), in component space
+	FStevesEditorVisBatchShapes Uncached;
+	bool bHasUncached = false;
+	bool bHasSolid = false;
+
+	explicit FStevesEditorVisBatchEntryData(FStevesEditorVisBatchShapes&& Shapes);
+};
+typedef TSharedPtr<const FStevesEditorVisBatchEntryData, ESPMode::ThreadSafe> FStevesEditorVisBatchEntryDataPtr;
+
+/// One component's state as sent to the batch proxy
+struct FStevesEditorVisBatchEntryUpdate
+{
+	FObjectKey Key;
+	/// New shapes, or null if only the transform changed
+	FStevesEditorVisBatchEntryDataPtr Data;
+	FMatrix LocalToWorld;
+};
+
+/// Everything which changed in a batch since the last flush, applied to the batch proxy on the render thread
+struct FStevesEditorVisBatchUpdate
+{
+	TArray<FStevesEditorVisBatchEntryUpdate> Updates;
+	TArray<FObjectKey> Removals;
+};
+
+/// Primitive which draws everything registered with a UStevesEditorVisBatcher as one proxy
+UCLASS()
+class STEVESUEHELPERS_API UStevesEditorVisBatchComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	class UStevesEditorVisBatcher* Batcher;
+	/// Which of the batcher's batches this draws
+	int32 BatchIndex = 0;
+
+	UStevesEditorVisBatchComponent(const FObjectInitializer& ObjectInitializer);
+
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+};
+
+/**
+ * Collects shapes from any number of UStevesEditorVisComponents in a world (those with bUseSharedBatcher enabled)
+ * and draws them with a single primitive, so the scene only has one proxy to cull and submit instead of one per
+ * component.
+ *
+ * The batch proxy is only created once. It owns persistent line buffers in which each component has its own range,
+ * so adding, changing or moving a component only rewrites that component's range, and removing one just frees its
+ * range. Changes are collected per component and sent to the render thread together once per frame.
+ *
+ * Components which are hidden in game and those which aren't (e.g. UStevesDebugVisComponent) go in separate
+ * batches, so that editor-only shapes don't show up in game.
+ */
+UCLASS()
+class STEVESUEHELPERS_API UStevesEditorVisBatcher : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+protected:
+	/// A component's shapes as of the last flush, which is what the batch proxy has
+	struct FEntry
+	{
+		FObjectKey Key;
+		FStevesEditorVisBatchEntryDataPtr Data;
+		FMatrix LocalToWorld;
+		FBox WorldBounds;
+	};
+
+	/// A change to a component since the last flush
+	struct FPendingChange
+	{
+		/// New shapes, or null if only the transform changed
+		FStevesEditorVisBatchEntryDataPtr Data;
+		FMatrix LocalToWorld;
+		FBox WorldBounds;
+		bool bRemove = false;
+	};
+
+	struct FBatch
+	{
+		TArray<FEntry> Entries;
+		/// Index of each component's entry in Entries, which are swap-removed so removal doesn't move anything else
+		TMap<FObjectKey, int32> EntryIndices;
+		/// At most one change per component, so a component changing several times a frame is only sent once
+		TMap<FObjectKey, FPendingChange> Pending;
+		FBox Bounds = FBox(ForceInit);
+	};
+
+	/// Batch 0 is hidden in game, batch 1 is visible in game
+	static constexpr int32 NumBatches = 2;
+
+	/// Pending changes may be added from concurrent render state updates
+	mutable FCriticalSection CriticalSection;
+	FBatch Batches[NumBatches];
+
+	UPROPERTY(Transient)
+	UStevesEditorVisBatchComponent* BatchComponents[NumBatches];
+
+	static int32 GetBatchIndex(const UPrimitiveComponent* Component);
+	/// Queue removing a component from a batch, or drop its pending change if it never got there
+	static void RemoveFromBatch(FBatch& Batch, const FObjectKey& Key);
+	/// Apply pending changes to the entries, returning them so they can be sent to an existing proxy.
+	/// Returns whether the batch bounds changed.
+	static bool CommitPending(FBatch& Batch, FStevesEditorVisBatchUpdate& OutUpdate);
+	void Flush();
+
+public:
+	virtual void Deinitialize() override;
+
+	/**
+	 * Add or replace the shapes for a component
+	 * @param Component The component the shapes belong to
+	 * @param InShapes Shapes in component space
+	 * @param LocalToWorld The component transform
+	 * @param LocalBounds Bounds of the shapes in component space
+	 */
+	void UpdateShapes(const UPrimitiveComponent* Component, FStevesEditorVisBatchShapes&& InShapes,
+	                  const FTransform& LocalToWorld, const FBox& LocalBounds);
+	/// Move a component's shapes without changing them. Only rewrites that component's range of the batch.
+	void UpdateTransform(const UPrimitiveComponent* Component, const FTransform& LocalToWorld, const FBox& LocalBounds);
+	/// Remove a component's shapes (deferred until the next flush, so a re-update in the same frame is cheap)
+	void RemoveShapes(const UPrimitiveComponent* Component);
+
+	/// Get every entry in a batch as of the last flush, for a new batch proxy
+	void GetEntries(int32 BatchIndex, TArray<FStevesEditorVisBatchEntryUpdate>& OutEntries) const;
+	FBox GetBounds(int32 BatchIndex) const;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual bool IsTickableInEditor() const override { return true; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+};
@@ -22,18 +22,29 @@ struct STEVESUEHELPERS_API FStevesEditorVisLine
 	UPROPERTY(EditAnywhere)
 	FColor Colour;
 
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
+
 	FStevesEditorVisLine(const FVector& InStart, const FVector& InEnd,
 	                     const FColor& InColour)
 		: Start(InStart),
 		  End(InEnd),
-		  Colour(InColour)
+		  Colour(InColour),
+		  Thickness(0),
+		  DepthPriority(SDPG_World)
 	{
 	}
 
 	FStevesEditorVisLine():
 		Start(FVector::ZeroVector),
 		End(FVector(100, 0, 0)),
-		Colour(FColor::White)
+		Colour(FColor::White),
+		Thickness(0),
+		DepthPriority(SDPG_World)
 	{
 	}
 };
@@ -59,13 +70,22 @@ struct STEVESUEHELPERS_API FStevesEditorVisCircle
 	UPROPERTY(EditAnywhere)
 	FColor Colour;
 
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
+
 	FStevesEditorVisCircle(const FVector& InLocation, const FRotator& InRotation, float InRadius, int InNumSegments,
 	                       const FColor& InColour)
 		: Location(InLocation),
 		  Rotation(InRotation),
 		  Radius(InRadius),
 		  NumSegments(InNumSegments),
-		  Colour(InColour)
+		  Colour(InColour),
+		  Thickness(0),
+		  DepthPriority(SDPG_World)
 	{
 	}
 
@@ -73,7 +93,9 @@ struct STEVESUEHELPERS_API FStevesEditorVisCircle
 		Location(FVector::ZeroVector),
 		Rotation(FRotator::ZeroRotator),
 		Radius(50), NumSegments(12),
-		Colour(FColor::White)
+		Colour(FColor::White),
+		Thickness(0),
+		DepthPriority(SDPG_World)
 	{
 	}
 };
@@ -105,6 +127,13 @@ struct STEVESUEHELPERS_API FStevesEditorVisArc
 	UPROPERTY(EditAnywhere)
 	FColor Colour;
 
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
+
 	FStevesEditorVisArc(const FVector& InLocation, const FRotator& InRotation, float InMinAngle, float InMaxAngle,
 	                    float InRadius, int InNumSegments,
 	                    const FColor& InColour)
@@ -114,7 +143,9 @@ struct STEVESUEHELPERS_API FStevesEditorVisArc
 		  MaxAngle(InMaxAngle),
 		  Radius(InRadius),
 		  NumSegments(InNumSegments),
-		  Colour(InColour)
+		  Colour(InColour),
+		  Thickness(0),
+		  DepthPriority(SDPG_Foreground)
 	{
 	}
 
@@ -124,7 +155,9 @@ struct STEVESUEHELPERS_API FStevesEditorVisArc
 		MinAngle(0),
 		MaxAngle(180),
 		Radius(50), NumSegments(12),
-		Colour(FColor::White)
+		Colour(FColor::White),
+		Thickness(0),
+		DepthPriority(SDPG_Foreground)
 	{
 	}
 };
@@ -143,18 +176,34 @@ struct STEVESUEHELPERS_API FStevesEditorVisSphere
 	/// The colour of the line render 
 	UPROPERTY(EditAnywhere)
 	FColor Colour;
+	/// Whether to render as a translucent solid rather than lines
+	UPROPERTY(EditAnywhere)
+	bool bSolid;
+
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
 
-	FStevesEditorVisSphere(const FVector& InLocation, float InRadius, const FColor& InColour) :
+	FStevesEditorVisSphere(const FVector& InLocation, float InRadius, const FColor& InColour, bool bInSolid = false) :
 		Location(InLocation),
 		Radius(InRadius),
-		Colour(InColour)
+		Colour(InColour),
+		bSolid(bInSolid),
+		Thickness(0),
+		DepthPriority(SDPG_World)
 	{
 	}
 
 	FStevesEditorVisSphere():
 		Location(FVector::ZeroVector),
 		Radius(50),
-		Colour(FColor::White)
+		Colour(FColor::White),
+		bSolid(false),
+		Thickness(0),
+		DepthPriority(SDPG_World)
 	{
 	}
 };
@@ -176,13 +225,26 @@ struct STEVESUEHELPERS_API FStevesEditorVisBox
 	/// The colour of the line render 
 	UPROPERTY(EditAnywhere)
 	FColor Colour;
+	/// Whether to render as a translucent solid rather than lines
+	UPROPERTY(EditAnywhere)
+	bool bSolid;
+
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
 
 	FStevesEditorVisBox(const FVector& InLocation, const FVector& InSize, const FRotator& InRot,
-	                    const FColor& InColour) :
+	                    const FColor& InColour, bool bInSolid = false) :
 		Location(InLocation),
 		Size(InSize),
 		Rotation(InRot),
-		Colour(InColour)
+		Colour(InColour),
+		bSolid(bInSolid),
+		Thickness(0),
+		DepthPriority(SDPG_World)
 	{
 	}
 
@@ -190,7 +252,299 @@ struct STEVESUEHELPERS_API FStevesEditorVisBox
 		Location(FVector::ZeroVector),
 		Size(FVector(50, 50, 50)),
 		Rotation(FRotator::ZeroRotator),
-		Colour(FColor::White)
+		Colour(FColor::White),
+		bSolid(false),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct STEVESUEHELPERS_API FStevesEditorVisCylinder
+{
+	GENERATED_BODY()
+
+	/// Location of the centre relative to component
+	UPROPERTY(EditAnywhere)
+	FVector Location;
+	/// Rotation relative to component; the cylinder's axis is Z
+	UPROPERTY(EditAnywhere)
+	FRotator Rotation;
+	/// Cylinder radius
+	UPROPERTY(EditAnywhere)
+	float Radius;
+	/// Half the length of the cylinder
+	UPROPERTY(EditAnywhere)
+	float HalfHeight;
+	/// The number of segments to render each end with
+	UPROPERTY(EditAnywhere)
+	int NumSegments;
+	/// The colour of the line render 
+	UPROPERTY(EditAnywhere)
+	FColor Colour;
+	/// Whether to render as a translucent solid rather than lines
+	UPROPERTY(EditAnywhere)
+	bool bSolid;
+
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
+
+	FStevesEditorVisCylinder(const FVector& InLocation, const FRotator& InRotation, float InRadius,
+	                         float InHalfHeight, int InNumSegments, const FColor& InColour, bool bInSolid = false) :
+		Location(InLocation),
+		Rotation(InRotation),
+		Radius(InRadius),
+		HalfHeight(InHalfHeight),
+		NumSegments(InNumSegments),
+		Colour(InColour),
+		bSolid(bInSolid),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+
+	FStevesEditorVisCylinder():
+		Location(FVector::ZeroVector),
+		Rotation(FRotator::ZeroRotator),
+		Radius(50), HalfHeight(50), NumSegments(12),
+		Colour(FColor::White),
+		bSolid(false),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+};
+
+USTRUCT(BlueprintType)
+struct STEVESUEHELPERS_API FStevesEditorVisCapsule
+{
+	GENERATED_BODY()
+
+	/// Location of the centre relative to component
+	UPROPERTY(EditAnywhere)
+	FVector Location;
+	/// Rotation relative to component; the capsule's axis is Z
+	UPROPERTY(EditAnywhere)
+	FRotator Rotation;
+	/// Capsule radius
+	UPROPERTY(EditAnywhere)
+	float Radius;
+	/// Half the length of the capsule including the hemispheres, like UCapsuleComponent
+	UPROPERTY(EditAnywhere)
+	float HalfHeight;
+	/// The number of segments to render each ring with
+	UPROPERTY(EditAnywhere)
+	int NumSegments;
+	/// The colour of the line render 
+	UPROPERTY(EditAnywhere)
+	FColor Colour;
+	/// Whether to render as a translucent solid rather than lines
+	UPROPERTY(EditAnywhere)
+	bool bSolid;
+
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
+
+	FStevesEditorVisCapsule(const FVector& InLocation, const FRotator& InRotation, float InRadius,
+	                        float InHalfHeight, int InNumSegments, const FColor& InColour, bool bInSolid = false) :
+		Location(InLocation),
+		Rotation(InRotation),
+		Radius(InRadius),
+		HalfHeight(InHalfHeight),
+		NumSegments(InNumSegments),
+		Colour(InColour),
+		bSolid(bInSolid),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+
+	FStevesEditorVisCapsule():
+		Location(FVector::ZeroVector),
+		Rotation(FRotator::ZeroRotator),
+		Radius(50), HalfHeight(100), NumSegments(12),
+		Colour(FColor::White),
+		bSolid(false),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+};
+
+/// A cone with a flat base, the same shape as StevesMathHelpers::SphereOverlapCone tests against
+USTRUCT(BlueprintType)
+struct STEVESUEHELPERS_API FStevesEditorVisCone
+{
+	GENERATED_BODY()
+
+	/// Location of the apex relative to component
+	UPROPERTY(EditAnywhere)
+	FVector Location;
+	/// Rotation relative to component; the cone points down X
+	UPROPERTY(EditAnywhere)
+	FRotator Rotation;
+	/// Full angle of the cone, in degrees
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0, ClampMax=178))
+	float Angle;
+	/// Length of the cone from the apex to the base
+	UPROPERTY(EditAnywhere)
+	float Length;
+	/// The number of segments to render the base with
+	UPROPERTY(EditAnywhere)
+	int NumSegments;
+	/// The colour of the line render 
+	UPROPERTY(EditAnywhere)
+	FColor Colour;
+	/// Whether to render as a translucent solid rather than lines
+	UPROPERTY(EditAnywhere)
+	bool bSolid;
+
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
+
+	FStevesEditorVisCone(const FVector& InLocation, const FRotator& InRotation, float InAngle, float InLength,
+	                     int InNumSegments, const FColor& InColour, bool bInSolid = false) :
+		Location(InLocation),
+		Rotation(InRotation),
+		Angle(InAngle),
+		Length(InLength),
+		NumSegments(InNumSegments),
+		Colour(InColour),
+		bSolid(bInSolid),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+
+	FStevesEditorVisCone():
+		Location(FVector::ZeroVector),
+		Rotation(FRotator::ZeroRotator),
+		Angle(45), Length(100), NumSegments(12),
+		Colour(FColor::White),
+		bSolid(false),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+};
+
+/// A perspective view frustum, like a camera's
+USTRUCT(BlueprintType)
+struct STEVESUEHELPERS_API FStevesEditorVisFrustum
+{
+	GENERATED_BODY()
+
+	/// Location of the eye relative to component
+	UPROPERTY(EditAnywhere)
+	FVector Location;
+	/// Rotation relative to component; the frustum looks down X
+	UPROPERTY(EditAnywhere)
+	FRotator Rotation;
+	/// Horizontal field of view, in degrees
+	UPROPERTY(EditAnywhere, meta=(ClampMin=1, ClampMax=170))
+	float FieldOfView;
+	/// Width / height
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0.01))
+	float AspectRatio;
+	UPROPERTY(EditAnywhere)
+	float NearDistance;
+	UPROPERTY(EditAnywhere)
+	float FarDistance;
+	/// The colour of the line render 
+	UPROPERTY(EditAnywhere)
+	FColor Colour;
+	/// Whether to render as a translucent solid rather than lines
+	UPROPERTY(EditAnywhere)
+	bool bSolid;
+
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
+
+	FStevesEditorVisFrustum(const FVector& InLocation, const FRotator& InRotation, float InFieldOfView,
+	                        float InAspectRatio, float InNearDistance, float InFarDistance, const FColor& InColour,
+	                        bool bInSolid = false) :
+		Location(InLocation),
+		Rotation(InRotation),
+		FieldOfView(InFieldOfView),
+		AspectRatio(InAspectRatio),
+		NearDistance(InNearDistance),
+		FarDistance(InFarDistance),
+		Colour(InColour),
+		bSolid(bInSolid),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+
+	FStevesEditorVisFrustum():
+		Location(FVector::ZeroVector),
+		Rotation(FRotator::ZeroRotator),
+		FieldOfView(90), AspectRatio(16.f / 9.f), NearDistance(10), FarDistance(200),
+		Colour(FColor::White),
+		bSolid(false),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+
+	/// Get the 8 corners relative to the component; bit 0 of the index is right, bit 1 up, bit 2 far
+	void GetCorners(FVector (&OutCorners)[8]) const;
+};
+
+/// Connected line segments
+USTRUCT(BlueprintType)
+struct STEVESUEHELPERS_API FStevesEditorVisPolyline
+{
+	GENERATED_BODY()
+
+	/// Points relative to component
+	UPROPERTY(EditAnywhere)
+	TArray<FVector> Points;
+	/// Whether to join the last point back to the first
+	UPROPERTY(EditAnywhere)
+	bool bClosed;
+	/// The colour of the line render 
+	UPROPERTY(EditAnywhere)
+	FColor Colour;
+
+	/// Line thickness, 0 for the thinnest. Thick lines are drawn every frame rather than cached
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float Thickness;
+	/// Depth priority to draw with, e.g. Foreground to draw on top of the scene
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	TEnumAsByte<ESceneDepthPriorityGroup> DepthPriority;
+
+	FStevesEditorVisPolyline(const TArray<FVector>& InPoints, bool bInClosed, const FColor& InColour) :
+		Points(InPoints),
+		bClosed(bInClosed),
+		Colour(InColour),
+		Thickness(0),
+		DepthPriority(SDPG_World)
+	{
+	}
+
+	FStevesEditorVisPolyline():
+		bClosed(false),
+		Colour(FColor::White),
+		Thickness(0),
+		DepthPriority(SDPG_World)
 	{
 	}
 };
@@ -227,11 +581,66 @@ public:
 	TArray<FStevesEditorVisSphere> Spheres;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<FStevesEditorVisBox> Boxes;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FStevesEditorVisCylinder> Cylinders;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FStevesEditorVisCapsule> Capsules;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FStevesEditorVisCone> Cones;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FStevesEditorVisFrustum> Frustums;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FStevesEditorVisPolyline> Polylines;
+
+	/// Tessellate shapes once into a static line buffer when the proxy is created, instead of every frame.
+	/// Much faster with many shapes / components.
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	bool bCacheShapes = true;
+
+	/// Pick the number of segments for circles & arcs from their size on screen in each view, rather than using
+	/// their NumSegments. LOD'd shapes are drawn every frame rather than cached.
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	bool bSegmentLOD = false;
+	/// Fewest segments used for a full circle when bSegmentLOD is enabled
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(EditCondition="bSegmentLOD", ClampMin=3))
+	int MinLODSegments = 4;
+	/// Most segments used for a full circle when bSegmentLOD is enabled
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(EditCondition="bSegmentLOD", ClampMin=3))
+	int MaxLODSegments = 64;
+	/// Shapes smaller than this radius on screen, in pixels, aren't drawn
+	UPROPERTY(EditAnywhere, AdvancedDisplay, meta=(ClampMin=0))
+	float CullPixelRadius = 1.f;
+
+	/// Draw shapes through the world's UStevesEditorVisBatcher instead of a proxy of our own. Cheaper for large
+	/// numbers of small visualisers; changing or moving one only updates its own part of the batch. LOD settings
+	/// don't apply.
+	UPROPERTY(EditAnywhere, AdvancedDisplay)
+	bool bUseSharedBatcher = false;
 
 	UStevesEditorVisComponent(const FObjectInitializer& ObjectInitializer);
 
+	/// Call after changing any of the shapes at runtime, rather than MarkRenderStateDirty, so that the cached
+	/// bounds are recalculated as well as the shapes being sent to the renderer again
+	UFUNCTION(BlueprintCallable, Category="StevesUEHelpers|EditorVis")
+	void MarkShapesDirty();
+
 	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
 	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
-	/// Needs to update on transform since proxy is detached
-	virtual bool ShouldRecreateProxyOnUpdateTransform() const override { return true; }
+	virtual void DestroyRenderState_Concurrent() override;
+	virtual bool ShouldRecreateProxyOnUpdateTransform() const override;
+	virtual void OnRegister() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+protected:
+	virtual void SendRenderTransform_Concurrent() override;
+
+	/// Bounds of all shapes in component space, cached until the shapes change. Only invalidated on the game thread,
+	/// since render state updates which read it may be running concurrently.
+	mutable FBox LocalShapeBounds;
+	mutable bool bLocalShapeBoundsValid = false;
+
+	class UStevesEditorVisBatcher* GetBatcher() const;
+	const FBox& GetLocalShapeBounds() const;
 };
@@ -5,6 +5,7 @@
 #include "InputCoreTypes.h"
 #include "PaperSprite.h"
 #include "Framework/Application/IInputProcessor.h"
+#include "UObject/ObjectKey.h"
 #include "StevesHelperCommon.h"
 #include "StevesTextureRenderTargetPool.h"
 #include "StevesUI/FocusSystem.h"
@@ -119,13 +120,19 @@ protected:
     UPROPERTY(BlueprintReadWrite)
     UUiTheme* DefaultUiTheme;
 
-    TArray<FStevesTextureRenderTargetPoolPtr> TextureRenderTargetPools;
+    typedef TMap<FName, FStevesTextureRenderTargetPoolPtr> FTextureRenderTargetPoolMap;
+    /// Pools which live as long as the game instance
+    FTextureRenderTargetPoolMap TextureRenderTargetPools;
+    /// Pools scoped to a single world, which are dropped when that world is cleaned up
+    TMap<FObjectKey, FTextureRenderTargetPoolMap> WorldTextureRenderTargetPools;
+    FDelegateHandle WorldCleanupHandle;
 
     void CreateInputDetector();
     void DestroyInputDetector();
     void InitTheme();
     void InitForegroundCheck();
     void CheckForeground();
+    void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
 
 
     // Called by detector
@@ -250,4 +257,31 @@ public:
     */
     FStevesTextureRenderTargetPoolPtr GetTextureRenderTargetPool(FName Name, bool bAutoCreate = true);
 
+    /**
+    * Retrieve a pool of texture render targets which is scoped to a world. The pool and its textures are
+    * dropped automatically when the world is cleaned up (e.g. on travel), so they can't outlive the content using them.
+    * Pool names are separate per world, and separate from the pools returned by GetTextureRenderTargetPool.
+    * @param World The world which the pool belongs to
+    * @param Name Identifier for the pool.
+    * @param bAutoCreate
+    * @return The pool, or null if it doesn't exist and bAutoCreate is false
+    */
+    FStevesTextureRenderTargetPoolPtr GetWorldTextureRenderTargetPool(UWorld* World, FName Name, bool bAutoCreate = true);
+
+    /**
+    * Drain and drop all texture render target pools scoped to a world. This is called automatically when a world is
+    * cleaned up, but you can call it earlier e.g. when you start travelling.
+    * @param World The world whose pools should be released
+    */
+    void ReleaseWorldTextureRenderTargetPools(UWorld* World);
+
+    /**
+    * Gather stats for every texture render target pool, including any leaked reservations.
+    * @param OutStats Array to receive one entry per pool
+    */
+    void GetTextureRenderTargetPoolStats(TArray<FStevesResourcePoolStats>& OutStats) const;
+
+    /// Write the stats for all texture render target pools to an output device (e.g. the log)
+    void DumpTextureRenderTargetPoolStats(FOutputDevice& Ar) const;
+
 };
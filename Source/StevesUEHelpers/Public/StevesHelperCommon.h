@@ -1,6 +1,10 @@
 #pragma once
+#include "Logging/LogMacros.h"
 #include "UObject/ObjectMacros.h"
 
+/// Declared here rather than in StevesUEHelpers.h so that headers it includes can log too
+DECLARE_LOG_CATEGORY_EXTERN(LogStevesUEHelpers, Verbose, Verbose);
+
 UENUM(BlueprintType)
 enum class EInputMode : uint8
 {
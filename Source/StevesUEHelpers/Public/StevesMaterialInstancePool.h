@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "StevesResourcePool.h"
+#include "Materials/MaterialInstanceDynamic.h"
+
+/// Factory for TStevesResourcePool which creates dynamic material instances, keyed on their parent material.
+/// Parameter overrides are cleared when an instance is re-used so it behaves like a freshly created one.
+struct FStevesMaterialInstanceDynamicFactory
+{
+	UMaterialInstanceDynamic* Create(UMaterialInterface* Parent, UObject* Outer)
+	{
+		return Parent ? UMaterialInstanceDynamic::Create(Parent, Outer) : nullptr;
+	}
+
+	void Reset(UMaterialInstanceDynamic* MID, UMaterialInterface* Parent)
+	{
+		MID->ClearParameterValues();
+	}
+
+	void Destroy(UMaterialInstanceDynamic* MID)
+	{
+		// Nothing to free explicitly, garbage collection will take it once the pool lets go
+	}
+
+	int64 GetResourceSize(UMaterialInstanceDynamic* MID) const
+	{
+		return MID ? MID->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal) : 0;
+	}
+
+	FString DescribeKey(UMaterialInterface* Parent) const
+	{
+		return Parent ? Parent->GetPathName() : TEXT("None");
+	}
+
+	static const TCHAR* GetTypeName() { return TEXT("MaterialInstanceDynamic"); }
+};
+
+/// A pool of dynamic material instances, so that transient MIDs don't need to be created & collected constantly
+typedef TStevesResourcePool<UMaterialInstanceDynamic, UMaterialInterface*, FStevesMaterialInstanceDynamicFactory> FStevesMaterialInstanceDynamicPool;
+typedef TSharedPtr<FStevesMaterialInstanceDynamicPool> FStevesMaterialInstanceDynamicPoolPtr;
+typedef TStevesResourceReservation<UMaterialInstanceDynamic> FStevesMaterialInstanceDynamicReservation;
+typedef TSharedPtr<FStevesMaterialInstanceDynamicReservation> FStevesMaterialInstanceDynamicReservationPtr;
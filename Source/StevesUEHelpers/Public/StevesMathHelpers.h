@@ -1,15 +1,210 @@
 ﻿#pragma once
 
+#include "CoreMinimal.h"
+#include <cmath>
+
+/// Spheres in structure-of-arrays layout, for the batch overlap tests in StevesMathHelpers
+struct FStevesSphereArray
+{
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+	TArray<float> Radius;
+
+	int32 Num() const { return Radius.Num(); }
+
+	void Reserve(int32 Number)
+	{
+		X.Reserve(Number);
+		Y.Reserve(Number);
+		Z.Reserve(Number);
+		Radius.Reserve(Number);
+	}
+
+	void Add(const FVector& Centre, float InRadius)
+	{
+		X.Add(Centre.X);
+		Y.Add(Centre.Y);
+		Z.Add(Centre.Z);
+		Radius.Add(InRadius);
+	}
+
+	void Reset()
+	{
+		X.Reset();
+		Y.Reset();
+		Z.Reset();
+		Radius.Reset();
+	}
+};
+
+/// Capsules in structure-of-arrays layout, for CapsuleOverlapConeBatch
+struct FStevesCapsuleArray
+{
+	TArray<float> StartX;
+	TArray<float> StartY;
+	TArray<float> StartZ;
+	TArray<float> EndX;
+	TArray<float> EndY;
+	TArray<float> EndZ;
+	TArray<float> Radius;
+
+	int32 Num() const { return Radius.Num(); }
+
+	FVector GetStart(int32 Index) const { return FVector(StartX[Index], StartY[Index], StartZ[Index]); }
+	FVector GetEnd(int32 Index) const { return FVector(EndX[Index], EndY[Index], EndZ[Index]); }
+
+	void Reserve(int32 Number)
+	{
+		StartX.Reserve(Number);
+		StartY.Reserve(Number);
+		StartZ.Reserve(Number);
+		EndX.Reserve(Number);
+		EndY.Reserve(Number);
+		EndZ.Reserve(Number);
+		Radius.Reserve(Number);
+	}
+
+	void Add(const FVector& Start, const FVector& End, float InRadius)
+	{
+		StartX.Add(Start.X);
+		StartY.Add(Start.Y);
+		StartZ.Add(Start.Z);
+		EndX.Add(End.X);
+		EndY.Add(End.Y);
+		EndZ.Add(End.Z);
+		Radius.Add(InRadius);
+	}
+
+	void Reset()
+	{
+		StartX.Reset();
+		StartY.Reset();
+		StartZ.Reset();
+		EndX.Reset();
+		EndY.Reset();
+		EndZ.Reset();
+		Radius.Reset();
+	}
+};
+
+/// Axis-aligned boxes in structure-of-arrays layout, for BoxOverlapConeBatch
+struct FStevesBoxArray
+{
+	TArray<float> MinX;
+	TArray<float> MinY;
+	TArray<float> MinZ;
+	TArray<float> MaxX;
+	TArray<float> MaxY;
+	TArray<float> MaxZ;
+
+	int32 Num() const { return MinX.Num(); }
+
+	FBox GetBox(int32 Index) const
+	{
+		return FBox(FVector(MinX[Index], MinY[Index], MinZ[Index]), FVector(MaxX[Index], MaxY[Index], MaxZ[Index]));
+	}
+
+	void Reserve(int32 Number)
+	{
+		MinX.Reserve(Number);
+		MinY.Reserve(Number);
+		MinZ.Reserve(Number);
+		MaxX.Reserve(Number);
+		MaxY.Reserve(Number);
+		MaxZ.Reserve(Number);
+	}
+
+	void Add(const FBox& Box)
+	{
+		MinX.Add(Box.Min.X);
+		MinY.Add(Box.Min.Y);
+		MinZ.Add(Box.Min.Z);
+		MaxX.Add(Box.Max.X);
+		MaxY.Add(Box.Max.Y);
+		MaxZ.Add(Box.Max.Z);
+	}
+
+	void Reset()
+	{
+		MinX.Reset();
+		MinY.Reset();
+		MinZ.Reset();
+		MaxX.Reset();
+		MaxY.Reset();
+		MaxZ.Reset();
+	}
+};
+
+/// Rays in structure-of-arrays layout, for RayIntersectConeBatch. Directions must be normalised.
+struct FStevesRayArray
+{
+	TArray<float> OriginX;
+	TArray<float> OriginY;
+	TArray<float> OriginZ;
+	TArray<float> DirX;
+	TArray<float> DirY;
+	TArray<float> DirZ;
+
+	int32 Num() const { return OriginX.Num(); }
+
+	FVector GetOrigin(int32 Index) const { return FVector(OriginX[Index], OriginY[Index], OriginZ[Index]); }
+	FVector GetDir(int32 Index) const { return FVector(DirX[Index], DirY[Index], DirZ[Index]); }
+
+	void Reserve(int32 Number)
+	{
+		OriginX.Reserve(Number);
+		OriginY.Reserve(Number);
+		OriginZ.Reserve(Number);
+		DirX.Reserve(Number);
+		DirY.Reserve(Number);
+		DirZ.Reserve(Number);
+	}
+
+	void Add(const FVector& Origin, const FVector& Dir)
+	{
+		OriginX.Add(Origin.X);
+		OriginY.Add(Origin.Y);
+		OriginZ.Add(Origin.Z);
+		DirX.Add(Dir.X);
+		DirY.Add(Dir.Y);
+		DirZ.Add(Dir.Z);
+	}
+
+	void Reset()
+	{
+		OriginX.Reset();
+		OriginY.Reset();
+		OriginZ.Reset();
+		DirX.Reset();
+		DirY.Reset();
+		DirZ.Reset();
+	}
+};
+
 /// Helper maths routines that UE4 is missing, all static
 class StevesMathHelpers
 {
 public:
 
+	/**
+	* @brief Clamp a cone half-angle to the range the cone functions support, just above 0 to just below 90 degrees.
+	* Every function here taking a cone half-angle (and FStevesCone) clamps it like this, because the tests divide by
+	* its sine and need a finite base. So a half-angle of 0 gives a very thin cone around the axis, and 90 degrees or
+	* more gives a very wide, flat one, Distance deep, rather than no overlaps at all.
+	* @param HalfAngle Half-angle of the cone, in radians
+	* @return The half-angle the cone functions will use
+	*/
+	static float ClampConeHalfAngle(float HalfAngle)
+	{
+		return FMath::Clamp(HalfAngle, KINDA_SMALL_NUMBER, HALF_PI - KINDA_SMALL_NUMBER);
+	}
+
 	/**
 	* @brief Return whether a sphere overlaps a cone
 	* @param ConeOrigin Origin of the cone
 	* @param ConeDir Direction of the cone, must be normalised
-	* @param ConeHalfAngle Half-angle of the cone, in radians
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
 	* @param Distance Length of the cone
 	* @param SphereCentre Centre of the sphere
 	* @param SphereRadius Radius of the sphere
@@ -17,6 +212,7 @@ public:
 	*/
 	static bool SphereOverlapCone(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FVector& SphereCentre, float SphereRadius)
 	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
 		// Algorithm from https://www.geometrictools.com/GTE/Mathematics/IntrSphere3Cone3.h
 		
 		const float SinHalfAngle = FMath::Sin(ConeHalfAngle);
@@ -79,4 +275,1061 @@ public:
 		}
 		return false;
 	}
-};
\ No newline at end of file
+
+	/**
+	* @brief Return whether a sphere overlaps a cone, calculated relative to the cone's origin & in a choice of
+	* precision. SphereOverlapCone forms its offset apex in world space, so loses precision far from the world origin
+	* and at narrow angles; this only ever uses the vector from the cone's origin to the sphere.
+	* SphereOverlapConeT<float> is about as fast as SphereOverlapCone and is fine for large worlds as long as the
+	* sphere is near the cone; use SphereOverlapConeT<double> where the answer must be exact to float precision, at
+	* some cost.
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param SphereCentre Centre of the sphere
+	* @param SphereRadius Radius of the sphere
+	* @return True if the sphere overlaps the cone
+	*/
+	template <typename T>
+	static bool SphereOverlapConeT(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FVector& SphereCentre, float SphereRadius)
+	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+		const T CmVX = T(SphereCentre.X) - T(ConeOrigin.X);
+		const T CmVY = T(SphereCentre.Y) - T(ConeOrigin.Y);
+		const T CmVZ = T(SphereCentre.Z) - T(ConeOrigin.Z);
+		const T AdCmV = T(ConeDir.X) * CmVX + T(ConeDir.Y) * CmVY + T(ConeDir.Z) * CmVZ;
+		const T Radius = T(SphereRadius);
+		const T Length = T(Distance);
+
+		// Same as SphereOverlapCone, but U - V is along the axis so CmU can be derived from CmV.
+		// FMath's trig & square root only take floats, so use the std overloads to keep doubles in double.
+		const T SinHalfAngle = std::sin(T(ConeHalfAngle));
+		const T CosHalfAngle = std::cos(T(ConeHalfAngle));
+		const T RInvSin = Radius / SinHalfAngle;
+		const T AdCmU = AdCmV + RInvSin;
+		if (AdCmU <= 0)
+			return false;
+
+		const T SqrLengthCmV = CmVX * CmVX + CmVY * CmVY + CmVZ * CmVZ;
+		const T SqrLengthCmU = SqrLengthCmV + RInvSin * (T(2) * AdCmV + RInvSin);
+		if (AdCmU * AdCmU < SqrLengthCmU * CosHalfAngle * CosHalfAngle)
+			return false;
+
+		if (AdCmV < -Radius || AdCmV > Length + Radius)
+			return false;
+
+		const T RSin = Radius * SinHalfAngle;
+		if (AdCmV < -RSin)
+			return SqrLengthCmV <= Radius * Radius;
+
+		if (AdCmV <= Length - RSin)
+			return true;
+
+		const T LengthAxBarD = std::sqrt(FMath::Max(SqrLengthCmV - AdCmV * AdCmV, T(0)));
+		const T BaseRadius = Length * SinHalfAngle / CosHalfAngle;
+		if (LengthAxBarD <= BaseRadius)
+			return true;
+
+		const T AdBarD = AdCmV - Length;
+		const T Diff = LengthAxBarD - BaseRadius;
+		return AdBarD * AdBarD + Diff * Diff <= Radius * Radius;
+	}
+
+	/**
+	* @brief Test many spheres against one cone, 4 at a time with SIMD. Same results as SphereOverlapCone, but the
+	* cone's trig is only calculated once.
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param Spheres The spheres to test
+	* @param OutMask Receives one bit per sphere, set if it overlaps; resized to (Spheres.Num() + 31) / 32 words
+	*/
+	static void SphereOverlapConeBatch(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FStevesSphereArray& Spheres, TArray<uint32>& OutMask)
+	{
+		const int32 Num = Spheres.Num();
+		OutMask.Reset();
+		OutMask.SetNumZeroed((Num + 31) / 32);
+		SphereOverlapConeBatch(ConeOrigin, ConeDir, ConeHalfAngle, Distance, Spheres.X.GetData(), Spheres.Y.GetData(),
+		                       Spheres.Z.GetData(), Spheres.Radius.GetData(), Num, OutMask.GetData());
+	}
+
+	/**
+	* @brief Test many spheres against one cone, 4 at a time with SIMD, and list the ones which overlap
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param Spheres The spheres to test
+	* @param OutIndices Indices of overlapping spheres are added to this, in ascending order
+	* @return The number of overlapping spheres
+	*/
+	static int32 SphereOverlapConeBatch(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FStevesSphereArray& Spheres, TArray<int32>& OutIndices)
+	{
+		TArray<uint32, TInlineAllocator<64>> Mask;
+		const int32 Num = Spheres.Num();
+		Mask.SetNumZeroed((Num + 31) / 32);
+		SphereOverlapConeBatch(ConeOrigin, ConeDir, ConeHalfAngle, Distance, Spheres.X.GetData(), Spheres.Y.GetData(),
+		                       Spheres.Z.GetData(), Spheres.Radius.GetData(), Num, Mask.GetData());
+		return AppendMaskIndices(Mask, OutIndices);
+	}
+
+	/**
+	* @brief Add the index of every set bit in a mask from one of the batch tests to a list
+	* @param Mask The mask
+	* @param OutIndices Indices of the set bits are added to this, in ascending order
+	* @return The number of set bits
+	*/
+	static int32 AppendMaskIndices(TArrayView<const uint32> Mask, TArray<int32>& OutIndices)
+	{
+		const int32 OldNum = OutIndices.Num();
+		for (int32 Word = 0; Word < Mask.Num(); ++Word)
+		{
+			uint32 Bits = Mask[Word];
+			while (Bits)
+			{
+				const uint32 Bit = FMath::CountTrailingZeros(Bits);
+				OutIndices.Add(Word * 32 + Bit);
+				Bits &= Bits - 1;
+			}
+		}
+		return OutIndices.Num() - OldNum;
+	}
+
+	/**
+	* @brief Test many spheres against one cone, 4 at a time with SIMD. Lower level version of the above taking
+	* separate arrays of sphere centre components & radii.
+	* @param OutMask Must have at least (Num + 31) / 32 words, all zero; bits are set for overlapping spheres
+	*/
+	static void SphereOverlapConeBatch(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance,
+	                                   const float* CentreX, const float* CentreY, const float* CentreZ, const float* Radius,
+	                                   int32 Num, uint32* OutMask)
+	{
+		const FSphereConeLanes Cone(ConeOrigin, ConeDir, ConeHalfAngle, Distance);
+		BatchSpheres(CentreX, CentreY, CentreZ, Radius, Num, OutMask,
+		             [&](const VectorRegister& CX, const VectorRegister& CY, const VectorRegister& CZ, const VectorRegister& R)
+		{
+			return Cone.Overlaps(CX, CY, CZ, R);
+		});
+	}
+
+	/**
+	* @brief Return the closest point in a cone (the same flat based cone as SphereOverlapCone) to a point
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param TanHalfAngle Tan of the half-angle of the cone
+	* @param Distance Length of the cone
+	* @param Point The point
+	* @return The closest point inside or on the surface of the cone; Point itself if it's inside
+	*/
+	static FVector ClosestPointOnCone(const FVector& ConeOrigin, const FVector& ConeDir, float TanHalfAngle, float Distance, const FVector& Point)
+	{
+		// Work in the plane through the axis & the point, where the cone is a triangle
+		const FVector V = Point - ConeOrigin;
+		const float Axial = FVector::DotProduct(ConeDir, V);
+		const FVector RadialVec = V - Axial * ConeDir;
+		const float Radial = RadialVec.Size();
+		if (Axial >= 0 && Axial <= Distance && Radial <= Axial * TanHalfAngle)
+			return Point;
+
+		const FVector2D P(Axial, Radial);
+		const FVector2D Rim(Distance, Distance * TanHalfAngle);
+		const FVector2D OnSide = FMath::ClosestPointOnSegment2D(P, FVector2D::ZeroVector, Rim);
+		const FVector2D OnBase = FMath::ClosestPointOnSegment2D(P, FVector2D(Distance, 0), Rim);
+		const FVector2D Closest = FVector2D::DistSquared(P, OnSide) < FVector2D::DistSquared(P, OnBase) ? OnSide : OnBase;
+		const FVector RadialDir = Radial > SMALL_NUMBER ? RadialVec / Radial : FVector::ZeroVector;
+		return ConeOrigin + Closest.X * ConeDir + Closest.Y * RadialDir;
+	}
+
+	/**
+	* @brief Return the distance from a point to a cone, or 0 if it's inside
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param Point The point
+	*/
+	static float PointDistanceToCone(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FVector& Point)
+	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+		return FVector::Dist(Point, ClosestPointOnCone(ConeOrigin, ConeDir, FMath::Tan(ConeHalfAngle), Distance, Point));
+	}
+
+	/**
+	* @brief Return whether a sphere overlaps a capsule
+	* @param SphereCentre Centre of the sphere
+	* @param SphereRadius Radius of the sphere
+	* @param CapsuleStart Centre of the hemisphere at one end of the capsule
+	* @param CapsuleEnd Centre of the hemisphere at the other end of the capsule
+	* @param CapsuleRadius Radius of the capsule
+	* @return True if the sphere overlaps the capsule
+	*/
+	static bool SphereOverlapCapsule(const FVector& SphereCentre, float SphereRadius, const FVector& CapsuleStart, const FVector& CapsuleEnd, float CapsuleRadius)
+	{
+		return FMath::PointDistToSegmentSquared(SphereCentre, CapsuleStart, CapsuleEnd) <= FMath::Square(SphereRadius + CapsuleRadius);
+	}
+
+	/**
+	* @brief Return whether a line segment overlaps a sphere
+	* @param Start Start of the segment
+	* @param End End of the segment
+	* @param SphereCentre Centre of the sphere
+	* @param SphereRadius Radius of the sphere
+	* @return True if any part of the segment is inside the sphere
+	*/
+	static bool SegmentOverlapSphere(const FVector& Start, const FVector& End, const FVector& SphereCentre, float SphereRadius)
+	{
+		return SphereOverlapCapsule(SphereCentre, SphereRadius, Start, End, 0);
+	}
+
+	/**
+	* @brief Return whether a sphere overlaps an oriented box
+	* @param BoxCentre Centre of the box
+	* @param BoxRotation Rotation of the box
+	* @param BoxExtent Half the size of the box on each of its local axes
+	* @param SphereCentre Centre of the sphere
+	* @param SphereRadius Radius of the sphere
+	* @return True if the sphere overlaps the box
+	*/
+	static bool SphereOverlapBox(const FVector& BoxCentre, const FQuat& BoxRotation, const FVector& BoxExtent, const FVector& SphereCentre, float SphereRadius)
+	{
+		const FVector Local = BoxRotation.UnrotateVector(SphereCentre - BoxCentre);
+		const FVector Outside = (Local.GetAbs() - BoxExtent).ComponentMax(FVector::ZeroVector);
+		return Outside.SizeSquared() <= SphereRadius * SphereRadius;
+	}
+
+	/**
+	* @brief Return whether a capsule overlaps a cone. The squared distance from the capsule's segment to the cone is
+	* convex along the segment, and its slope is known exactly, so this bisects on the slope until it either finds a
+	* point within the capsule's radius, or the tangents either side prove none can be. The answer is exact to float
+	* precision rather than depending on an iteration count.
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param CapsuleStart Centre of the hemisphere at one end of the capsule
+	* @param CapsuleEnd Centre of the hemisphere at the other end of the capsule
+	* @param CapsuleRadius Radius of the capsule
+	* @return True if the capsule overlaps the cone
+	*/
+	static bool CapsuleOverlapCone(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FVector& CapsuleStart, const FVector& CapsuleEnd, float CapsuleRadius)
+	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+		return CapsuleOverlapConeTan(ConeOrigin, ConeDir, FMath::Tan(ConeHalfAngle), Distance, CapsuleStart, CapsuleEnd, CapsuleRadius);
+	}
+
+	/// Same as CapsuleOverlapCone but with the tan of the half-angle already calculated
+	static bool CapsuleOverlapConeTan(const FVector& ConeOrigin, const FVector& ConeDir, float TanHalfAngle, float Distance, const FVector& CapsuleStart, const FVector& CapsuleEnd, float CapsuleRadius)
+	{
+		const FVector Axis = CapsuleEnd - CapsuleStart;
+		const float RadiusSq = CapsuleRadius * CapsuleRadius;
+		// Squared distance to the cone at T along the segment, and its slope 2 (P - Closest).Axis
+		auto Evaluate = [&](float T, float& OutSlope)
+		{
+			const FVector P = CapsuleStart + Axis * T;
+			const FVector Offset = P - ClosestPointOnCone(ConeOrigin, ConeDir, TanHalfAngle, Distance, P);
+			OutSlope = 2.f * FVector::DotProduct(Offset, Axis);
+			return Offset.SizeSquared();
+		};
+
+		float Lo = 0, Hi = 1, SlopeLo, SlopeHi;
+		float DistSqLo = Evaluate(Lo, SlopeLo);
+		float DistSqHi = Evaluate(Hi, SlopeHi);
+		if (DistSqLo <= RadiusSq || DistSqHi <= RadiusSq)
+			return true;
+		// Closest at one of the ends
+		if (SlopeLo >= 0 || SlopeHi <= 0)
+			return false;
+
+		while (true)
+		{
+			// The distance is above both tangents, so can't get lower in between than where they cross
+			const float Cross = (DistSqHi - DistSqLo + SlopeLo * Lo - SlopeHi * Hi) / (SlopeLo - SlopeHi);
+			if (DistSqLo + SlopeLo * (Cross - Lo) > RadiusSq)
+				return false;
+
+			const float Mid = (Lo + Hi) * 0.5f;
+			// Lo & Hi are adjacent floats, so one of them is the closest point
+			if (Mid <= Lo || Mid >= Hi)
+				return false;
+
+			float Slope;
+			const float DistSq = Evaluate(Mid, Slope);
+			if (DistSq <= RadiusSq)
+				return true;
+			if (Slope < 0)
+			{
+				Lo = Mid;
+				DistSqLo = DistSq;
+				SlopeLo = Slope;
+			}
+			else if (Slope > 0)
+			{
+				Hi = Mid;
+				DistSqHi = DistSq;
+				SlopeHi = Slope;
+			}
+			else
+			{
+				// Mid is the closest point
+				return false;
+			}
+		}
+	}
+
+	/**
+	* @brief Return whether an axis-aligned box overlaps a cone. Runs GJK on the difference of the two shapes, which
+	* either finds a plane separating them or closes in on a shared point. Shapes count as overlapping once they're
+	* within 4 float epsilons of the largest coordinate involved, measured from the cone's apex (at least 1 unit), so
+	* the answer is exact to float precision.
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param Box The box
+	* @return True if the box overlaps the cone
+	*/
+	static bool BoxOverlapCone(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FBox& Box)
+	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+		if (!SphereOverlapCone(ConeOrigin, ConeDir, ConeHalfAngle, Distance, Box.GetCenter(), Box.GetExtent().Size()))
+			return false;
+
+		return BoxOverlapConeTan(ConeOrigin, ConeDir, FMath::Tan(ConeHalfAngle), Distance, Box);
+	}
+
+	/// Same as BoxOverlapCone (including its tolerance) but with the tan of the half-angle already calculated, and no
+	/// early out using the box's bounding sphere
+	static bool BoxOverlapConeTan(const FVector& ConeOrigin, const FVector& ConeDir, float TanHalfAngle, float Distance, const FBox& Box)
+	{
+		// The box & cone overlap if the origin is in the set of differences between their points (Box - Cone).
+		// Work relative to the apex so the precision doesn't depend on where they are in the world.
+		const FBox RelBox = Box.ShiftBy(-ConeOrigin);
+		const FVector BaseCentre = ConeDir * Distance;
+		const float BaseRadius = Distance * TanHalfAngle;
+		auto Support = [&](const FVector& Dir)
+		{
+			const FVector BoxPoint(Dir.X >= 0 ? RelBox.Max.X : RelBox.Min.X,
+			                       Dir.Y >= 0 ? RelBox.Max.Y : RelBox.Min.Y,
+			                       Dir.Z >= 0 ? RelBox.Max.Z : RelBox.Min.Z);
+			// The furthest point of the cone along -Dir is either the apex or on the rim
+			const FVector Radial = FVector::DotProduct(Dir, ConeDir) * ConeDir - Dir;
+			const float RadialSize = Radial.Size();
+			const FVector Rim = RadialSize > SMALL_NUMBER ? BaseCentre + Radial * (BaseRadius / RadialSize) : BaseCentre;
+			const FVector ConePoint = FVector::DotProduct(Dir, Rim) < 0 ? Rim : FVector::ZeroVector;
+			return BoxPoint - ConePoint;
+		};
+
+		// Distances in the difference can't be known better than float error in its largest coordinates. GJK on
+		// shapes closer than that may stall or keep converging instead, which the exits below also treat as touching.
+		const float Scale = FMath::Max3(FMath::Max(RelBox.Min.GetAbsMax(), RelBox.Max.GetAbsMax()),
+		                                Distance + BaseRadius, 1.f);
+		const float Tolerance = 4.f * FLT_EPSILON * Scale;
+		FVector Simplex[4] = {RelBox.GetCenter() - BaseCentre * 0.5f};
+		int32 NumPoints = 1;
+		FVector Closest = Simplex[0];
+		float ClosestSq = Closest.SizeSquared();
+		for (int32 i = 0; i < MaxGJKIterations; ++i)
+		{
+			if (ClosestSq <= Tolerance * Tolerance)
+				return true;
+
+			// Nothing in the difference is further towards the origin than W, so if W doesn't get past it there's a
+			// separating plane
+			const FVector W = Support(-Closest);
+			if (FVector::DotProduct(Closest, W) > 0)
+				return false;
+
+			Simplex[NumPoints++] = W;
+			FVector NewClosest;
+			if (!ReduceSimplex(Simplex, NumPoints, NewClosest))
+				return true;
+
+			// Each step gets strictly closer unless float precision runs out, which only happens when the shapes are
+			// touching, since otherwise a separating plane would have been found
+			const float NewClosestSq = NewClosest.SizeSquared();
+			if (NewClosestSq >= ClosestSq)
+				return true;
+			Closest = NewClosest;
+			ClosestSq = NewClosestSq;
+		}
+		// As above, only shapes which are touching to float precision keep converging this long
+		return true;
+	}
+
+	/**
+	* @brief Find where a ray first hits a cone
+	* @param RayOrigin Start of the ray
+	* @param RayDir Direction of the ray, must be normalised
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param OutDistance Distance along the ray of the first hit, 0 if the ray starts inside the cone
+	* @return True if the ray hits the cone
+	*/
+	static bool RayIntersectCone(const FVector& RayOrigin, const FVector& RayDir, const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, float& OutDistance)
+	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+		const float CosHalfAngle = FMath::Cos(ConeHalfAngle);
+		const float CosSq = CosHalfAngle * CosHalfAngle;
+		const FVector CO = RayOrigin - ConeOrigin;
+		const float AdCO = FVector::DotProduct(ConeDir, CO);
+		const float AdRay = FVector::DotProduct(ConeDir, RayDir);
+		const float SqrLengthCO = CO.SizeSquared();
+
+		if (AdCO >= 0 && AdCO <= Distance && AdCO * AdCO >= SqrLengthCO * CosSq)
+		{
+			OutDistance = 0;
+			return true;
+		}
+
+		float Best = MAX_flt;
+		auto TrySide = [&](float T)
+		{
+			// Only the half of the double cone in front of the apex, up to the base
+			const float Axial = AdCO + T * AdRay;
+			if (T >= 0 && T < Best && Axial >= 0 && Axial <= Distance)
+				Best = T;
+		};
+
+		// Sides: (ConeDir.(P - ConeOrigin))^2 = |P - ConeOrigin|^2 cos^2, where P = RayOrigin + T * RayDir
+		const float A = AdRay * AdRay - CosSq;
+		const float B = 2.f * (AdRay * AdCO - FVector::DotProduct(RayDir, CO) * CosSq);
+		const float C = AdCO * AdCO - SqrLengthCO * CosSq;
+		if (FMath::Abs(A) > SMALL_NUMBER)
+		{
+			const float Discriminant = B * B - 4.f * A * C;
+			if (Discriminant >= 0)
+			{
+				const float Root = FMath::Sqrt(Discriminant);
+				TrySide((-B - Root) / (2.f * A));
+				TrySide((-B + Root) / (2.f * A));
+			}
+		}
+		else if (FMath::Abs(B) > SMALL_NUMBER)
+		{
+			// Parallel to the side
+			TrySide(-C / B);
+		}
+
+		// Base
+		if (FMath::Abs(AdRay) > SMALL_NUMBER)
+		{
+			const float T = (Distance - AdCO) / AdRay;
+			if (T >= 0 && T < Best)
+			{
+				const float BaseRadius = Distance * FMath::Tan(ConeHalfAngle);
+				const FVector FromBaseCentre = CO + T * RayDir - Distance * ConeDir;
+				if (FromBaseCentre.SizeSquared() <= BaseRadius * BaseRadius)
+					Best = T;
+			}
+		}
+
+		if (Best == MAX_flt)
+			return false;
+
+		OutDistance = Best;
+		return true;
+	}
+
+	/**
+	* @brief Test many spheres against one capsule, 4 at a time with SIMD
+	* @param CapsuleStart Centre of the hemisphere at one end of the capsule
+	* @param CapsuleEnd Centre of the hemisphere at the other end of the capsule
+	* @param CapsuleRadius Radius of the capsule
+	* @param Spheres The spheres to test
+	* @param OutMask Receives one bit per sphere, set if it overlaps; resized to (Spheres.Num() + 31) / 32 words
+	*/
+	static void SphereOverlapCapsuleBatch(const FVector& CapsuleStart, const FVector& CapsuleEnd, float CapsuleRadius, const FStevesSphereArray& Spheres, TArray<uint32>& OutMask)
+	{
+		const FVector Axis = CapsuleEnd - CapsuleStart;
+		const float AxisLengthSq = Axis.SizeSquared();
+		const VectorRegister SX = VectorSetFloat1(CapsuleStart.X);
+		const VectorRegister SY = VectorSetFloat1(CapsuleStart.Y);
+		const VectorRegister SZ = VectorSetFloat1(CapsuleStart.Z);
+		const VectorRegister AX = VectorSetFloat1(Axis.X);
+		const VectorRegister AY = VectorSetFloat1(Axis.Y);
+		const VectorRegister AZ = VectorSetFloat1(Axis.Z);
+		const VectorRegister InvAxisLengthSq = VectorSetFloat1(AxisLengthSq > SMALL_NUMBER ? 1.f / AxisLengthSq : 0.f);
+		const VectorRegister CapRadius = VectorSetFloat1(CapsuleRadius);
+		const VectorRegister Zero = VectorZero();
+		const VectorRegister One = VectorOne();
+
+		BatchSpheres(Spheres, OutMask,
+		             [&](const VectorRegister& CX, const VectorRegister& CY, const VectorRegister& CZ, const VectorRegister& R)
+		{
+			// Closest point on the segment
+			const VectorRegister VX = VectorSubtract(CX, SX);
+			const VectorRegister VY = VectorSubtract(CY, SY);
+			const VectorRegister VZ = VectorSubtract(CZ, SZ);
+			const VectorRegister AdV = VectorMultiplyAdd(VX, AX, VectorMultiplyAdd(VY, AY, VectorMultiply(VZ, AZ)));
+			const VectorRegister T = VectorMin(VectorMax(VectorMultiply(AdV, InvAxisLengthSq), Zero), One);
+			const VectorRegister DX = VectorSubtract(VX, VectorMultiply(T, AX));
+			const VectorRegister DY = VectorSubtract(VY, VectorMultiply(T, AY));
+			const VectorRegister DZ = VectorSubtract(VZ, VectorMultiply(T, AZ));
+			const VectorRegister DistSq = VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+			const VectorRegister SumRadius = VectorAdd(R, CapRadius);
+			return VectorCompareGE(VectorMultiply(SumRadius, SumRadius), DistSq);
+		});
+	}
+
+	/**
+	* @brief Test one line segment against many spheres, 4 at a time with SIMD
+	* @param Start Start of the segment
+	* @param End End of the segment
+	* @param Spheres The spheres to test
+	* @param OutMask Receives one bit per sphere, set if the segment overlaps it; resized to (Spheres.Num() + 31) / 32 words
+	*/
+	static void SegmentOverlapSphereBatch(const FVector& Start, const FVector& End, const FStevesSphereArray& Spheres, TArray<uint32>& OutMask)
+	{
+		SphereOverlapCapsuleBatch(Start, End, 0, Spheres, OutMask);
+	}
+
+	/**
+	* @brief Test many spheres against one oriented box, 4 at a time with SIMD
+	* @param BoxCentre Centre of the box
+	* @param BoxRotation Rotation of the box
+	* @param BoxExtent Half the size of the box on each of its local axes
+	* @param Spheres The spheres to test
+	* @param OutMask Receives one bit per sphere, set if it overlaps; resized to (Spheres.Num() + 31) / 32 words
+	*/
+	static void SphereOverlapBoxBatch(const FVector& BoxCentre, const FQuat& BoxRotation, const FVector& BoxExtent, const FStevesSphereArray& Spheres, TArray<uint32>& OutMask)
+	{
+		const FVector Axes[3] = {BoxRotation.GetAxisX(), BoxRotation.GetAxisY(), BoxRotation.GetAxisZ()};
+		VectorRegister AxisX[3], AxisY[3], AxisZ[3], Extent[3];
+		for (int32 i = 0; i < 3; ++i)
+		{
+			AxisX[i] = VectorSetFloat1(Axes[i].X);
+			AxisY[i] = VectorSetFloat1(Axes[i].Y);
+			AxisZ[i] = VectorSetFloat1(Axes[i].Z);
+			Extent[i] = VectorSetFloat1(BoxExtent[i]);
+		}
+		const VectorRegister BX = VectorSetFloat1(BoxCentre.X);
+		const VectorRegister BY = VectorSetFloat1(BoxCentre.Y);
+		const VectorRegister BZ = VectorSetFloat1(BoxCentre.Z);
+		const VectorRegister Zero = VectorZero();
+
+		BatchSpheres(Spheres, OutMask,
+		             [&](const VectorRegister& CX, const VectorRegister& CY, const VectorRegister& CZ, const VectorRegister& R)
+		{
+			const VectorRegister VX = VectorSubtract(CX, BX);
+			const VectorRegister VY = VectorSubtract(CY, BY);
+			const VectorRegister VZ = VectorSubtract(CZ, BZ);
+			// Distance outside the box along each of its axes
+			VectorRegister DistSq = Zero;
+			for (int32 i = 0; i < 3; ++i)
+			{
+				const VectorRegister Local = VectorMultiplyAdd(VX, AxisX[i], VectorMultiplyAdd(VY, AxisY[i], VectorMultiply(VZ, AxisZ[i])));
+				const VectorRegister Outside = VectorMax(VectorSubtract(VectorAbs(Local), Extent[i]), Zero);
+				DistSq = VectorMultiplyAdd(Outside, Outside, DistSq);
+			}
+			return VectorCompareGE(VectorMultiply(R, R), DistSq);
+		});
+	}
+
+	/**
+	* @brief Test many capsules against one cone. Each group of 4 is culled by their bounding spheres with SIMD, using
+	* the same test as SphereOverlapConeBatch, then any which might overlap get the exact CapsuleOverlapCone test.
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param Capsules The capsules to test
+	* @param OutMask Receives one bit per capsule, set if it overlaps; resized to (Capsules.Num() + 31) / 32 words
+	*/
+	static void CapsuleOverlapConeBatch(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FStevesCapsuleArray& Capsules, TArray<uint32>& OutMask)
+	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+		const int32 Num = Capsules.Num();
+		OutMask.Reset();
+		OutMask.SetNumZeroed((Num + 31) / 32);
+
+		const FSphereConeLanes Cone(ConeOrigin, ConeDir, ConeHalfAngle, Distance);
+		const float TanHalfAngle = FMath::Tan(ConeHalfAngle);
+		const VectorRegister Half = VectorSetFloat1(0.5f);
+		const VectorRegister Tiny = VectorSetFloat1(SMALL_NUMBER);
+		const VectorRegister Padding = VectorSetFloat1(BoundingSpherePadding);
+
+		const float* const Streams[7] = {
+			Capsules.StartX.GetData(), Capsules.StartY.GetData(), Capsules.StartZ.GetData(),
+			Capsules.EndX.GetData(), Capsules.EndY.GetData(), Capsules.EndZ.GetData(), Capsules.Radius.GetData()
+		};
+		BatchLanes(Streams, Num, OutMask.GetData(), [&](int32 First, const VectorRegister* L)
+		{
+			// Centred on the middle of the segment, reaching the ends of the hemispheres
+			const VectorRegister AX = VectorSubtract(L[3], L[0]);
+			const VectorRegister AY = VectorSubtract(L[4], L[1]);
+			const VectorRegister AZ = VectorSubtract(L[5], L[2]);
+			const VectorRegister LengthSq = VectorMultiplyAdd(AX, AX, VectorMultiplyAdd(AY, AY, VectorMultiply(AZ, AZ)));
+			const VectorRegister HalfLength = VectorMultiply(Half, VectorMultiply(LengthSq, VectorReciprocalSqrtAccurate(VectorMax(LengthSq, Tiny))));
+			const VectorRegister BoundsRadius = VectorMultiply(VectorAdd(HalfLength, L[6]), Padding);
+			const uint32 Bits = VectorMaskBits(Cone.Overlaps(VectorMultiplyAdd(AX, Half, L[0]), VectorMultiplyAdd(AY, Half, L[1]),
+			                                                 VectorMultiplyAdd(AZ, Half, L[2]), BoundsRadius));
+			return RefineLanes(Bits, First, Num, [&](int32 Index)
+			{
+				return CapsuleOverlapConeTan(ConeOrigin, ConeDir, TanHalfAngle, Distance, Capsules.GetStart(Index),
+				                             Capsules.GetEnd(Index), Capsules.Radius[Index]);
+			});
+		});
+	}
+
+	/**
+	* @brief Test many axis-aligned boxes against one cone. Each group of 4 is culled by their bounding spheres with
+	* SIMD, using the same test as SphereOverlapConeBatch, then any which might overlap get the exact BoxOverlapCone
+	* test.
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param Boxes The boxes to test
+	* @param OutMask Receives one bit per box, set if it overlaps; resized to (Boxes.Num() + 31) / 32 words
+	*/
+	static void BoxOverlapConeBatch(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, const FStevesBoxArray& Boxes, TArray<uint32>& OutMask)
+	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+		const int32 Num = Boxes.Num();
+		OutMask.Reset();
+		OutMask.SetNumZeroed((Num + 31) / 32);
+
+		const FSphereConeLanes Cone(ConeOrigin, ConeDir, ConeHalfAngle, Distance);
+		const float TanHalfAngle = FMath::Tan(ConeHalfAngle);
+		const VectorRegister Half = VectorSetFloat1(0.5f);
+		const VectorRegister Tiny = VectorSetFloat1(SMALL_NUMBER);
+		const VectorRegister Padding = VectorSetFloat1(BoundingSpherePadding);
+
+		const float* const Streams[6] = {
+			Boxes.MinX.GetData(), Boxes.MinY.GetData(), Boxes.MinZ.GetData(),
+			Boxes.MaxX.GetData(), Boxes.MaxY.GetData(), Boxes.MaxZ.GetData()
+		};
+		BatchLanes(Streams, Num, OutMask.GetData(), [&](int32 First, const VectorRegister* L)
+		{
+			const VectorRegister SX = VectorSubtract(L[3], L[0]);
+			const VectorRegister SY = VectorSubtract(L[4], L[1]);
+			const VectorRegister SZ = VectorSubtract(L[5], L[2]);
+			const VectorRegister SizeSq = VectorMultiplyAdd(SX, SX, VectorMultiplyAdd(SY, SY, VectorMultiply(SZ, SZ)));
+			const VectorRegister BoundsRadius = VectorMultiply(Padding, VectorMultiply(Half,
+				VectorMultiply(SizeSq, VectorReciprocalSqrtAccurate(VectorMax(SizeSq, Tiny)))));
+			const uint32 Bits = VectorMaskBits(Cone.Overlaps(VectorMultiplyAdd(SX, Half, L[0]), VectorMultiplyAdd(SY, Half, L[1]),
+			                                                 VectorMultiplyAdd(SZ, Half, L[2]), BoundsRadius));
+			return RefineLanes(Bits, First, Num, [&](int32 Index)
+			{
+				return BoxOverlapConeTan(ConeOrigin, ConeDir, TanHalfAngle, Distance, Boxes.GetBox(Index));
+			});
+		});
+	}
+
+	/**
+	* @brief Find where many rays first hit one cone, 4 at a time with SIMD. Same results as RayIntersectCone, to
+	* float precision.
+	* @param Rays The rays to test
+	* @param ConeOrigin Origin of the cone
+	* @param ConeDir Direction of the cone, must be normalised
+	* @param ConeHalfAngle Half-angle of the cone, in radians, see ClampConeHalfAngle
+	* @param Distance Length of the cone
+	* @param OutMask Receives one bit per ray, set if it hits; resized to (Rays.Num() + 31) / 32 words
+	* @param OutDistances Receives the distance along each ray of its first hit, 0 if it starts inside the cone and
+	* MAX_flt if it misses; resized to Rays.Num()
+	*/
+	static void RayIntersectConeBatch(const FStevesRayArray& Rays, const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance, TArray<uint32>& OutMask, TArray<float>& OutDistances)
+	{
+		ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+		const int32 Num = Rays.Num();
+		OutMask.Reset();
+		OutMask.SetNumZeroed((Num + 31) / 32);
+		OutDistances.SetNumUninitialized(Num);
+
+		const float CosHalfAngle = FMath::Cos(ConeHalfAngle);
+		const float BaseRadius = Distance * FMath::Tan(ConeHalfAngle);
+		const VectorRegister OX = VectorSetFloat1(ConeOrigin.X);
+		const VectorRegister OY = VectorSetFloat1(ConeOrigin.Y);
+		const VectorRegister OZ = VectorSetFloat1(ConeOrigin.Z);
+		const VectorRegister AX = VectorSetFloat1(ConeDir.X);
+		const VectorRegister AY = VectorSetFloat1(ConeDir.Y);
+		const VectorRegister AZ = VectorSetFloat1(ConeDir.Z);
+		const VectorRegister CosSq = VectorSetFloat1(CosHalfAngle * CosHalfAngle);
+		const VectorRegister Dist = VectorSetFloat1(Distance);
+		const VectorRegister BaseRadiusSq = VectorSetFloat1(BaseRadius * BaseRadius);
+		const VectorRegister Zero = VectorZero();
+		const VectorRegister Two = VectorSetFloat1(2.f);
+		const VectorRegister Four = VectorSetFloat1(4.f);
+		const VectorRegister Small = VectorSetFloat1(SMALL_NUMBER);
+		const VectorRegister NoHit = VectorSetFloat1(MAX_flt);
+
+		const float* const Streams[6] = {
+			Rays.OriginX.GetData(), Rays.OriginY.GetData(), Rays.OriginZ.GetData(),
+			Rays.DirX.GetData(), Rays.DirY.GetData(), Rays.DirZ.GetData()
+		};
+		BatchLanes(Streams, Num, OutMask.GetData(), [&](int32 First, const VectorRegister* L)
+		{
+			// Same algorithm as RayIntersectCone, with each candidate hit evaluated & selected with masks
+			const VectorRegister COX = VectorSubtract(L[0], OX);
+			const VectorRegister COY = VectorSubtract(L[1], OY);
+			const VectorRegister COZ = VectorSubtract(L[2], OZ);
+			const VectorRegister AdCO = VectorMultiplyAdd(AX, COX, VectorMultiplyAdd(AY, COY, VectorMultiply(AZ, COZ)));
+			const VectorRegister AdRay = VectorMultiplyAdd(AX, L[3], VectorMultiplyAdd(AY, L[4], VectorMultiply(AZ, L[5])));
+			const VectorRegister RaydCO = VectorMultiplyAdd(L[3], COX, VectorMultiplyAdd(L[4], COY, VectorMultiply(L[5], COZ)));
+			const VectorRegister SqrLengthCOCosSq = VectorMultiply(CosSq,
+				VectorMultiplyAdd(COX, COX, VectorMultiplyAdd(COY, COY, VectorMultiply(COZ, COZ))));
+			const VectorRegister AdCOSq = VectorMultiply(AdCO, AdCO);
+
+			const VectorRegister Inside = VectorBitwiseAnd(
+				VectorBitwiseAnd(VectorCompareGE(AdCO, Zero), VectorCompareGE(Dist, AdCO)),
+				VectorCompareGE(AdCOSq, SqrLengthCOCosSq));
+
+			VectorRegister Best = NoHit;
+			auto TrySide = [&](const VectorRegister& T, const VectorRegister& Valid)
+			{
+				// Only the half of the double cone in front of the apex, up to the base
+				const VectorRegister Axial = VectorMultiplyAdd(T, AdRay, AdCO);
+				const VectorRegister Hit = VectorBitwiseAnd(
+					VectorBitwiseAnd(Valid, VectorBitwiseAnd(VectorCompareGE(T, Zero), VectorCompareGT(Best, T))),
+					VectorBitwiseAnd(VectorCompareGE(Axial, Zero), VectorCompareGE(Dist, Axial)));
+				Best = VectorSelect(Hit, T, Best);
+			};
+
+			// Sides
+			const VectorRegister A = VectorSubtract(VectorMultiply(AdRay, AdRay), CosSq);
+			const VectorRegister B = VectorMultiply(Two, VectorSubtract(VectorMultiply(AdRay, AdCO), VectorMultiply(RaydCO, CosSq)));
+			const VectorRegister C = VectorSubtract(AdCOSq, SqrLengthCOCosSq);
+			const VectorRegister Discriminant = VectorSubtract(VectorMultiply(B, B), VectorMultiply(Four, VectorMultiply(A, C)));
+			const VectorRegister Quadratic = VectorBitwiseAnd(VectorCompareGT(VectorAbs(A), Small), VectorCompareGE(Discriminant, Zero));
+			const VectorRegister DiscriminantSq = VectorMax(Discriminant, Zero);
+			const VectorRegister Root = VectorMultiply(DiscriminantSq, VectorReciprocalSqrtAccurate(VectorMax(DiscriminantSq, Small)));
+			const VectorRegister InvTwoA = VectorReciprocalAccurate(VectorMultiply(Two, A));
+			TrySide(VectorMultiply(VectorNegate(VectorAdd(B, Root)), InvTwoA), Quadratic);
+			TrySide(VectorMultiply(VectorSubtract(Root, B), InvTwoA), Quadratic);
+			// Parallel to the side
+			TrySide(VectorMultiply(VectorNegate(C), VectorReciprocalAccurate(B)),
+			        VectorBitwiseAnd(VectorCompareGE(Small, VectorAbs(A)), VectorCompareGT(VectorAbs(B), Small)));
+
+			// Base
+			const VectorRegister TBase = VectorMultiply(VectorSubtract(Dist, AdCO), VectorReciprocalAccurate(AdRay));
+			const VectorRegister BX = VectorSubtract(VectorMultiplyAdd(TBase, L[3], COX), VectorMultiply(Dist, AX));
+			const VectorRegister BY = VectorSubtract(VectorMultiplyAdd(TBase, L[4], COY), VectorMultiply(Dist, AY));
+			const VectorRegister BZ = VectorSubtract(VectorMultiplyAdd(TBase, L[5], COZ), VectorMultiply(Dist, AZ));
+			const VectorRegister BaseHit = VectorBitwiseAnd(
+				VectorBitwiseAnd(VectorCompareGT(VectorAbs(AdRay), Small), VectorCompareGE(TBase, Zero)),
+				VectorBitwiseAnd(VectorCompareGT(Best, TBase),
+				                 VectorCompareGE(BaseRadiusSq, VectorMultiplyAdd(BX, BX, VectorMultiplyAdd(BY, BY, VectorMultiply(BZ, BZ))))));
+			Best = VectorSelect(BaseHit, TBase, Best);
+			Best = VectorSelect(Inside, Zero, Best);
+
+			float Distances[4];
+			VectorStore(Best, Distances);
+			for (int32 Lane = 0; Lane < 4 && First + Lane < Num; ++Lane)
+			{
+				OutDistances[First + Lane] = Distances[Lane];
+			}
+			return uint32(VectorMaskBits(VectorCompareGT(NoHit, Best)));
+		});
+	}
+
+protected:
+	/// Bounding spheres used to cull batches are scaled up by this, so that float error in the cull can't reject
+	/// anything the exact test would accept
+	static constexpr float BoundingSpherePadding = 1.001f;
+	/// GJK converges long before this unless the shapes are touching to float precision
+	static constexpr int32 MaxGJKIterations = 64;
+
+	/// The SIMD sphere / cone test from SphereOverlapConeBatch, with the cone's constants set up once
+	struct FSphereConeLanes
+	{
+		VectorRegister OX, OY, OZ;
+		VectorRegister DX, DY, DZ;
+		VectorRegister Sin, InvSin, CosSq;
+		VectorRegister Dist, HMaxTan, HMaxTanSq;
+		VectorRegister Zero, Two, Tiny;
+
+		FSphereConeLanes(const FVector& ConeOrigin, const FVector& ConeDir, float ConeHalfAngle, float Distance)
+		{
+			ConeHalfAngle = ClampConeHalfAngle(ConeHalfAngle);
+			const float SinHalfAngle = FMath::Sin(ConeHalfAngle);
+			const float CosHalfAngle = FMath::Cos(ConeHalfAngle);
+			const float HMaxTanAngle = Distance * FMath::Tan(ConeHalfAngle);
+
+			OX = VectorSetFloat1(ConeOrigin.X);
+			OY = VectorSetFloat1(ConeOrigin.Y);
+			OZ = VectorSetFloat1(ConeOrigin.Z);
+			DX = VectorSetFloat1(ConeDir.X);
+			DY = VectorSetFloat1(ConeDir.Y);
+			DZ = VectorSetFloat1(ConeDir.Z);
+			Sin = VectorSetFloat1(SinHalfAngle);
+			InvSin = VectorSetFloat1(1.f / SinHalfAngle);
+			CosSq = VectorSetFloat1(CosHalfAngle * CosHalfAngle);
+			Dist = VectorSetFloat1(Distance);
+			HMaxTan = VectorSetFloat1(HMaxTanAngle);
+			HMaxTanSq = VectorSetFloat1(HMaxTanAngle * HMaxTanAngle);
+			Zero = VectorZero();
+			Two = VectorSetFloat1(2.f);
+			Tiny = VectorSetFloat1(SMALL_NUMBER);
+		}
+
+		/// Return a comparison mask of which of 4 spheres overlap the cone
+		VectorRegister Overlaps(const VectorRegister& CX, const VectorRegister& CY, const VectorRegister& CZ, const VectorRegister& R) const
+		{
+			// Same algorithm as SphereOverlapCone with all the branches evaluated & combined as masks. Since the vector
+			// from U to the sphere is (SphereCentre - ConeOrigin) + (SphereRadius / SinHalfAngle) * ConeDir, everything
+			// can be derived from dot products with the vector from the origin.
+			const VectorRegister VX = VectorSubtract(CX, OX);
+			const VectorRegister VY = VectorSubtract(CY, OY);
+			const VectorRegister VZ = VectorSubtract(CZ, OZ);
+			const VectorRegister AdCmV = VectorMultiplyAdd(VX, DX, VectorMultiplyAdd(VY, DY, VectorMultiply(VZ, DZ)));
+			const VectorRegister SqrLengthCmV = VectorMultiplyAdd(VX, VX, VectorMultiplyAdd(VY, VY, VectorMultiply(VZ, VZ)));
+			const VectorRegister RSq = VectorMultiply(R, R);
+
+			// Inside the cone moved back so that its surface is SphereRadius away from the real one
+			const VectorRegister RInvSin = VectorMultiply(R, InvSin);
+			const VectorRegister AdCmU = VectorAdd(AdCmV, RInvSin);
+			const VectorRegister SqrLengthCmU = VectorMultiplyAdd(VectorMultiply(Two, RInvSin), AdCmV,
+			                                                      VectorMultiplyAdd(RInvSin, RInvSin, SqrLengthCmV));
+			const VectorRegister InCone = VectorBitwiseAnd(
+				VectorCompareGT(AdCmU, Zero),
+				VectorCompareGE(VectorMultiply(AdCmU, AdCmU), VectorMultiply(SqrLengthCmU, CosSq)));
+
+			// Between the planes of the apex & base, expanded by the radius
+			const VectorRegister InSlab = VectorBitwiseAnd(
+				VectorCompareGE(AdCmV, VectorNegate(R)),
+				VectorCompareGE(VectorAdd(Dist, R), AdCmV));
+
+			// Near the base: inside the truncated part, or within the radius of the base rim
+			const VectorRegister RSin = VectorMultiply(R, Sin);
+			const VectorRegister LengthAxBarDSq = VectorMax(VectorSubtract(SqrLengthCmV, VectorMultiply(AdCmV, AdCmV)), Zero);
+			const VectorRegister LengthAxBarD = VectorMultiply(LengthAxBarDSq, VectorReciprocalSqrtAccurate(VectorMax(LengthAxBarDSq, Tiny)));
+			const VectorRegister Diff = VectorSubtract(LengthAxBarD, HMaxTan);
+			const VectorRegister AdBarD = VectorSubtract(AdCmV, Dist);
+			const VectorRegister NearBase = VectorBitwiseOr(
+				VectorBitwiseOr(
+					VectorCompareGE(VectorSubtract(Dist, RSin), AdCmV),
+					VectorCompareGE(HMaxTanSq, LengthAxBarDSq)),
+				VectorCompareGE(RSq, VectorMultiplyAdd(AdBarD, AdBarD, VectorMultiply(Diff, Diff))));
+
+			// Near the apex: within the radius of the apex
+			const VectorRegister NearApex = VectorCompareGE(RSq, SqrLengthCmV);
+
+			return VectorBitwiseAnd(VectorBitwiseAnd(InCone, InSlab),
+			                        VectorSelect(VectorCompareGE(AdCmV, VectorNegate(RSin)), NearBase, NearApex));
+		}
+	};
+
+	/**
+	* Call Func(First, Lanes) for 4 items at a time, where Lanes[s] holds items First to First + 3 of Streams[s]. It
+	* returns the bits to set in OutMask for those items. The last group is padded with zeroes, and bits for the
+	* padding are ignored.
+	*/
+	template <int32 NumStreams, typename TFunc>
+	static void BatchLanes(const float* const (&Streams)[NumStreams], int32 Num, uint32* OutMask, TFunc Func)
+	{
+		VectorRegister Lanes[NumStreams];
+		for (int32 i = 0; i < Num; i += 4)
+		{
+			if (i + 4 <= Num)
+			{
+				for (int32 s = 0; s < NumStreams; ++s)
+				{
+					Lanes[s] = VectorLoad(Streams[s] + i);
+				}
+			}
+			else
+			{
+				for (int32 s = 0; s < NumStreams; ++s)
+				{
+					float Tail[4] = {};
+					for (int32 j = 0; i + j < Num; ++j)
+					{
+						Tail[j] = Streams[s][i + j];
+					}
+					Lanes[s] = VectorLoad(Tail);
+				}
+			}
+
+			uint32 Bits = Func(i, static_cast<const VectorRegister*>(Lanes));
+			if (i + 4 > Num)
+				Bits &= (1u << (Num - i)) - 1;
+			OutMask[i / 32] |= Bits << (i % 32);
+		}
+	}
+
+	/// Clear the bits for lanes which fail an exact scalar Test(Index), skipping padding lanes past Num
+	template <typename TTest>
+	static uint32 RefineLanes(uint32 Bits, int32 First, int32 Num, TTest Test)
+	{
+		uint32 Remaining = Bits;
+		while (Remaining)
+		{
+			const uint32 Lane = FMath::CountTrailingZeros(Remaining);
+			Remaining &= Remaining - 1;
+			const int32 Index = First + Lane;
+			if (Index >= Num || !Test(Index))
+				Bits &= ~(1u << Lane);
+		}
+		return Bits;
+	}
+
+	/// Call Func(CentreX, CentreY, CentreZ, Radius) for 4 spheres at a time, which returns a comparison mask
+	/// of the ones to set bits in OutMask for. The last group is padded with zero spheres, which are masked off.
+	template <typename TFunc>
+	static void BatchSpheres(const float* CentreX, const float* CentreY, const float* CentreZ, const float* Radius,
+	                         int32 Num, uint32* OutMask, TFunc Func)
+	{
+		const float* const Streams[4] = {CentreX, CentreY, CentreZ, Radius};
+		BatchLanes(Streams, Num, OutMask, [&](int32, const VectorRegister* L)
+		{
+			return uint32(VectorMaskBits(Func(L[0], L[1], L[2], L[3])));
+		});
+	}
+
+	template <typename TFunc>
+	static void BatchSpheres(const FStevesSphereArray& Spheres, TArray<uint32>& OutMask, TFunc Func)
+	{
+		const int32 Num = Spheres.Num();
+		OutMask.Reset();
+		OutMask.SetNumZeroed((Num + 31) / 32);
+		BatchSpheres(Spheres.X.GetData(), Spheres.Y.GetData(), Spheres.Z.GetData(), Spheres.Radius.GetData(), Num,
+		             OutMask.GetData(), Func);
+	}
+
+	/// Closest point to the origin on the segment P[0], P[1], reducing P to the vertex it's at, if it's at one
+	static FVector ClosestOnSimplexSegment(FVector* P, int32& NumPoints)
+	{
+		const FVector AB = P[1] - P[0];
+		const float LengthSq = AB.SizeSquared();
+		const float T = LengthSq > 0 ? -FVector::DotProduct(P[0], AB) / LengthSq : 0.f;
+		if (T <= 0)
+		{
+			NumPoints = 1;
+			return P[0];
+		}
+		if (T >= 1)
+		{
+			P[0] = P[1];
+			NumPoints = 1;
+			return P[0];
+		}
+		NumPoints = 2;
+		return P[0] + AB * T;
+	}
+
+	/// Closest point to the origin on the triangle P[0], P[1], P[2], reducing P to the edge or vertex it's on, if it's
+	/// on one. From Ericson, Real-Time Collision Detection, 5.1.5.
+	static FVector ClosestOnSimplexTriangle(FVector* P, int32& NumPoints)
+	{
+		const FVector A = P[0], B = P[1], C = P[2];
+		const FVector AB = B - A;
+		const FVector AC = C - A;
+		const float D1 = -FVector::DotProduct(AB, A);
+		const float D2 = -FVector::DotProduct(AC, A);
+		if (D1 <= 0 && D2 <= 0)
+		{
+			NumPoints = 1;
+			return A;
+		}
+
+		const float D3 = -FVector::DotProduct(AB, B);
+		const float D4 = -FVector::DotProduct(AC, B);
+		if (D3 >= 0 && D4 <= D3)
+		{
+			P[0] = B;
+			NumPoints = 1;
+			return B;
+		}
+
+		const float VC = D1 * D4 - D3 * D2;
+		if (VC <= 0 && D1 >= 0 && D3 <= 0)
+		{
+			NumPoints = 2;
+			return A + AB * (D1 / (D1 - D3));
+		}
+
+		const float D5 = -FVector::DotProduct(AB, C);
+		const float D6 = -FVector::DotProduct(AC, C);
+		if (D6 >= 0 && D5 <= D6)
+		{
+			P[0] = C;
+			NumPoints = 1;
+			return C;
+		}
+
+		const float VB = D5 * D2 - D1 * D6;
+		if (VB <= 0 && D2 >= 0 && D6 <= 0)
+		{
+			P[1] = C;
+			NumPoints = 2;
+			return A + AC * (D2 / (D2 - D6));
+		}
+
+		const float VA = D3 * D6 - D5 * D4;
+		if (VA <= 0 && D4 - D3 >= 0 && D5 - D6 >= 0)
+		{
+			P[0] = B;
+			P[1] = C;
+			NumPoints = 2;
+			return B + (C - B) * ((D4 - D3) / ((D4 - D3) + (D5 - D6)));
+		}
+
+		const float Denom = 1.f / (VA + VB + VC);
+		NumPoints = 3;
+		return A + AB * (VB * Denom) + AC * (VC * Denom);
+	}
+
+	/**
+	* Find the closest point to the origin on a GJK simplex of 1 to 4 points, and reduce the simplex to the points of
+	* the face, edge or vertex that it's on.
+	* @return False if the origin is inside the simplex
+	*/
+	static bool ReduceSimplex(FVector (&P)[4], int32& NumPoints, FVector& OutClosest)
+	{
+		switch (NumPoints)
+		{
+		case 1:
+			OutClosest = P[0];
+			return true;
+		case 2:
+			OutClosest = ClosestOnSimplexSegment(P, NumPoints);
+			return true;
+		case 3:
+			OutClosest = ClosestOnSimplexTriangle(P, NumPoints);
+			return true;
+		default:
+			break;
+		}
+
+		// Tetrahedron: the closest of the faces which the origin is in front of. A flat tetrahedron has the origin in
+		// front of every face, so it's never mistaken for containing it.
+		static const int32 Faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+		float BestSq = MAX_flt;
+		FVector Best[3];
+		int32 NumBest = 0;
+		for (const auto& Face : Faces)
+		{
+			const FVector& A = P[Face[0]];
+			const FVector Normal = FVector::CrossProduct(P[Face[1]] - A, P[Face[2]] - A);
+			if (FVector::DotProduct(-A, Normal) * FVector::DotProduct(P[Face[3]] - A, Normal) > 0)
+				continue;
+
+			FVector Tri[3] = {A, P[Face[1]], P[Face[2]]};
+			int32 NumTri = 3;
+			const FVector Closest = ClosestOnSimplexTriangle(Tri, NumTri);
+			if (Closest.SizeSquared() < BestSq)
+			{
+				BestSq = Closest.SizeSquared();
+				OutClosest = Closest;
+				for (int32 i = 0; i < NumTri; ++i)
+				{
+					Best[i] = Tri[i];
+				}
+				NumBest = NumTri;
+			}
+		}
+		if (NumBest == 0)
+			return false;
+
+		for (int32 i = 0; i < NumBest; ++i)
+		{
+			P[i] = Best[i];
+		}
+		NumPoints = NumBest;
+		return true;
+	}
+};
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Packs rectangles into a fixed size area using horizontal shelves, e.g. for sub-allocating regions of an atlas.
+ * Freed space is coalesced, both between neighbouring gaps within a shelf and by merging shelves which become
+ * completely empty, so that a long-running pattern of allocations & frees doesn't fragment the area.
+ */
+struct STEVESUEHELPERS_API FStevesShelfRectPacker
+{
+protected:
+	struct FSpan
+	{
+		int32 X;
+		int32 Width;
+	};
+
+	struct FShelf
+	{
+		int32 Y;
+		int32 Height;
+		int32 NumAllocated;
+		/// Free horizontal gaps, in ascending X order with no two adjacent
+		TArray<FSpan> FreeSpans;
+
+		FShelf(int32 InY, int32 InHeight, int32 InWidth)
+			: Y(InY), Height(InHeight), NumAllocated(0)
+		{
+			FreeSpans.Add(FSpan {0, InWidth});
+		}
+	};
+
+	FIntPoint Size;
+	/// Shelves in ascending Y order, which together cover the area from 0 to Top
+	TArray<FShelf> Shelves;
+	int32 Top = 0;
+
+	void SplitShelf(int32 ShelfIndex, int32 Height);
+	void MergeEmptyShelf(int32 ShelfIndex);
+
+public:
+	explicit FStevesShelfRectPacker(FIntPoint InSize = FIntPoint::ZeroValue)
+		: Size(InSize)
+	{
+	}
+
+	FIntPoint GetSize() const { return Size; }
+
+	/**
+	 * Allocate a rectangle
+	 * @param RectSize The size required
+	 * @param OutRect The allocated rectangle, if successful
+	 * @return Whether there was room for the rectangle
+	 */
+	bool Allocate(FIntPoint RectSize, FIntRect& OutRect);
+
+	/// Free a rectangle previously returned from Allocate
+	void Free(const FIntRect& Rect);
+
+	/// Return whether nothing is allocated
+	bool IsEmpty() const { return Shelves.Num() == 0; }
+
+	/// Free everything
+	void Reset();
+};
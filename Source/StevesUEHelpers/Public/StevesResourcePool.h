@@ -0,0 +1,474 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/Package.h"
+#include "StevesHelperCommon.h"
+
+/// Summary of the resources in a pool which share the same key
+struct STEVESUEHELPERS_API FStevesResourcePoolKeyStats
+{
+	/// Human-readable description of the key, as provided by the pool's factory
+	FString Key;
+	/// Number of resources of this key currently reserved
+	int32 NumReserved = 0;
+	/// Number of resources of this key sitting in the pool ready for re-use
+	int32 NumUnreserved = 0;
+	/// Number of resources of this key which have been released but aren't ready for re-use yet
+	int32 NumPendingRelease = 0;
+	/// Estimated memory used by all resources of this key, reserved or not
+	int64 TotalBytes = 0;
+};
+
+/// A reservation which is still holding a resource even though the object which reserved it has been destroyed
+struct STEVESUEHELPERS_API FStevesResourcePoolLeakInfo
+{
+	/// Name of the owner at the time it made the reservation (the owner itself is gone)
+	FName OwnerName;
+	/// The resource which is still reserved
+	TWeakObjectPtr<UObject> Resource;
+	/// How long ago the reservation was made, in seconds
+	double Age = 0;
+};
+
+/// A snapshot of the state of a resource pool, for debugging / profiling
+struct STEVESUEHELPERS_API FStevesResourcePoolStats
+{
+	FName PoolName;
+	/// Breakdown by key
+	TArray<FStevesResourcePoolKeyStats> Keys;
+	int32 NumReserved = 0;
+	int32 NumUnreserved = 0;
+	int32 NumPendingRelease = 0;
+	/// Estimated memory used by all resources in the pool
+	int64 TotalBytes = 0;
+	/// Number of reservations satisfied by re-using a pooled resource
+	uint64 NumHits = 0;
+	/// Number of reservations which needed a new resource to be created
+	uint64 NumMisses = 0;
+	/// Average time in seconds between a resource being reserved and released, for completed reservations
+	double AverageReservationLifetime = 0;
+	/// Reservations whose owner is dead but which still hold a resource
+	TArray<FStevesResourcePoolLeakInfo> Leaks;
+
+	float GetHitRate() const
+	{
+		const uint64 Total = NumHits + NumMisses;
+		return Total > 0 ? static_cast<float>(NumHits) / static_cast<float>(Total) : 0.f;
+	}
+
+	/// Write a human-readable version of these stats
+	void Dump(FOutputDevice& Ar) const;
+};
+
+/// CSV profiler stat names for one type of pooled resource, so that churn shows up in captures
+struct STEVESUEHELPERS_API FStevesResourcePoolCsvStats
+{
+	FName Hits;
+	FName Misses;
+	FName Released;
+	FName CreatedMB;
+	FName DestroyedMB;
+
+	explicit FStevesResourcePoolCsvStats(const TCHAR* TypeName);
+
+	/// Accumulate a value into a stat for this frame, if a CSV capture is running
+	static void Accumulate(const FName& Stat, float Value);
+};
+
+/// Interface through which a reservation returns its resource to the pool it came from
+template <typename TResource>
+class TStevesResourceReleaser
+{
+public:
+	virtual ~TStevesResourceReleaser() = default;
+
+	/// Release a reservation on a resource, allowing it back into the pool
+	virtual void ReleaseReservation(TResource* Resource) = 0;
+};
+
+/// Holder for an assigned resource. While this structure exists, the resource will be considered assigned
+/// and will not be returned from any other request. Once this structure is destroyed the resource will
+/// be free for re-use. For that reason, only pass this structure around by SharedRef/SharedPtr.
+/// The resource is held by a weak pointer however, the strong pointer is held by the pool. The resource will continue
+/// to be available to this reservation except if the pool is told to forcibly release resources.
+template <typename TResource>
+struct TStevesResourceReservation
+{
+public:
+	/// The resource. May be null if the pool has forcibly reclaimed it prematurely
+	TWeakObjectPtr<TResource> Resource;
+	TWeakPtr<TStevesResourceReleaser<TResource>> ParentPool;
+	TWeakObjectPtr<const UObject> CurrentOwner;
+
+	TStevesResourceReservation() = default;
+
+	TStevesResourceReservation(TResource* InResource,
+	                           TSharedPtr<TStevesResourceReleaser<TResource>> InParent,
+	                           const UObject* InOwner)
+		: Resource(InResource),
+		  ParentPool(InParent),
+		  CurrentOwner(InOwner)
+	{
+	}
+
+	~TStevesResourceReservation()
+	{
+		if (ParentPool.IsValid() && Resource.IsValid())
+		{
+			ParentPool.Pin()->ReleaseReservation(Resource.Get());
+			Resource = nullptr;
+		}
+	}
+
+	/// Get the reserved resource, or null if it has been reclaimed
+	TResource* Get() const { return Resource.Get(); }
+};
+
+/**
+ * A generic pool of UObject resources, which are created on demand and re-used once released.
+ * Resources are grouped by a key (e.g. size and format); a reservation only ever receives a resource created
+ * for the same key. The pool holds the strong references to all its resources through FGCObject, so they survive
+ * garbage collection whether reserved or not.
+ *
+ * TKey must be hashable and comparable. TFactory supplies the type-specific behaviour and must provide:
+ *
+ *    TResource* Create(const TKey& Key, UObject* Outer);     // Return null if the key is invalid
+ *    void Reset(TResource* Resource, const TKey& Key);       // Called when a pooled resource is handed out again
+ *    void Destroy(TResource* Resource);                      // Free any resources before the pool drops it
+ *    int64 GetResourceSize(TResource* Resource) const;       // Estimated memory, for stats & budgets
+ *    FString DescribeKey(const TKey& Key) const;             // For stats
+ *    static const TCHAR* GetTypeName();                      // For CSV stats
+ *
+ * TReservation can be a subclass of TStevesResourceReservation<TResource> with the same constructors, e.g. to add
+ * type-specific accessors.
+ */
+template <typename TResource, typename TKey, typename TFactory,
+          typename TReservation = TStevesResourceReservation<TResource>>
+struct TStevesResourcePool : public FGCObject,
+                             public TStevesResourceReleaser<TResource>,
+                             public TSharedFromThis<TStevesResourcePool<TResource, TKey, TFactory, TReservation>>
+{
+public:
+	typedef TReservation FReservation;
+	typedef TSharedPtr<FReservation> FReservationPtr;
+
+protected:
+	/// The name of the pool. It's possible to have more than one pool of a type.
+	FName Name;
+
+	TWeakObjectPtr<UObject> PoolOwner;
+	TFactory Factory;
+	TMultiMap<TKey, TResource*> UnreservedResources;
+	TSet<TResource*> ReservedResources;
+
+	/// Weak reverse tracking of reservations, for release and debugging
+	struct FReservationInfo
+	{
+		TKey Key;
+		TWeakObjectPtr<const UObject> Owner;
+		/// Owner name is kept so that leaks can still be identified once the owner is gone
+		FName OwnerName;
+		double ReservedTime;
+		/// The reservation itself, so that revoking can stop it releasing a resource which may be re-used by then
+		TWeakPtr<FReservation> Reservation;
+
+		FReservationInfo() = default;
+		FReservationInfo(const TKey& InKey, const UObject* InOwner)
+			: Key(InKey),
+			  Owner(InOwner),
+			  OwnerName(InOwner ? InOwner->GetFName() : NAME_None),
+			  ReservedTime(FPlatformTime::Seconds())
+		{
+		}
+	};
+	TMap<TResource*, FReservationInfo> Reservations;
+
+	/// Maximum number of unreserved resources to keep per key, 0 for no limit
+	int32 MaxUnreservedPerKey = 0;
+	/// Maximum estimated bytes for the whole pool; unreserved resources are destroyed to stay under it. 0 for no limit
+	int64 MaxTotalBytes = 0;
+	/// Running total of estimated bytes for all resources created by this pool
+	int64 TotalBytes = 0;
+
+	// Running totals for stats
+	uint64 NumHits = 0;
+	uint64 NumMisses = 0;
+	uint64 NumCompletedReservations = 0;
+	double TotalReservationLifetime = 0;
+	FStevesResourcePoolCsvStats CsvStats;
+
+	/// Update stats when a reservation ends, whether released or revoked
+	void RecordReservationEnded(const FReservationInfo& R)
+	{
+		++NumCompletedReservations;
+		TotalReservationLifetime += FPlatformTime::Seconds() - R.ReservedTime;
+		FStevesResourcePoolCsvStats::Accumulate(CsvStats.Released, 1);
+	}
+
+	/// Add resources which have been released but not yet returned to the pool, for stats
+	/// Subclasses which delay ReturnToPool must override this so those resources aren't missing from GetStats
+	virtual void GetPendingReleases(TArray<TPair<TKey, TResource*>>& OutPending) const
+	{
+	}
+
+	/// Put a resource which is no longer reserved back into the pool, or destroy it if over budget
+	/// Subclasses can override this to delay resources becoming available again
+	virtual void ReturnToPool(const TKey& Key, TResource* Res)
+	{
+		if (MaxUnreservedPerKey > 0 && UnreservedResources.Num(Key) >= MaxUnreservedPerKey)
+		{
+			DestroyResource(Res);
+		}
+		else
+		{
+			UnreservedResources.Add(Key, Res);
+			TrimToBudget();
+		}
+	}
+
+	void DestroyResource(TResource* Res)
+	{
+		const int64 Bytes = Factory.GetResourceSize(Res);
+		TotalBytes -= Bytes;
+		FStevesResourcePoolCsvStats::Accumulate(CsvStats.DestroyedMB, Bytes / (1024.f * 1024.f));
+		Factory.Destroy(Res);
+	}
+
+	/// Destroy unreserved resources until we're within the memory budget
+	void TrimToBudget()
+	{
+		while (MaxTotalBytes > 0 && TotalBytes > MaxTotalBytes && UnreservedResources.Num() > 0)
+		{
+			auto It = UnreservedResources.CreateIterator();
+			TResource* Res = It.Value();
+			It.RemoveCurrent();
+			DestroyResource(Res);
+		}
+	}
+
+public:
+	explicit TStevesResourcePool(const FName& InName, UObject* InOwner, const TFactory& InFactory = TFactory())
+		: Name(InName),
+		  PoolOwner(InOwner),
+		  Factory(InFactory),
+		  CsvStats(TFactory::GetTypeName())
+	{
+	}
+
+	virtual ~TStevesResourcePool() override
+	{
+		DrainPool(true);
+	}
+
+	const FName& GetName() const { return Name; }
+
+	// FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override
+	{
+		// We need to hold on to the resource references
+		Collector.AddReferencedObjects(ReservedResources);
+		Collector.AddReferencedObjects(UnreservedResources);
+	}
+
+	virtual FString GetReferencerName() const override
+	{
+		return FString::Printf(TEXT("StevesResourcePool %s (%s)"), TFactory::GetTypeName(), *Name.ToString());
+	}
+
+	// TStevesResourceReleaser
+	virtual void ReleaseReservation(TResource* Res) override
+	{
+		if (!Res)
+		{
+			UE_LOG(LogStevesUEHelpers, Warning, TEXT("%s: Attempted to release a null resource"), *Name.ToString());
+			return;
+		}
+
+		FReservationInfo R;
+		if (Reservations.RemoveAndCopyValue(Res, R))
+		{
+			UE_LOG(LogStevesUEHelpers, Verbose, TEXT("%s: Released reservation on %s"), *Name.ToString(), *Res->GetName());
+			RecordReservationEnded(R);
+			ReservedResources.Remove(Res);
+			ReturnToPool(R.Key, Res);
+			return;
+		}
+
+		UE_LOG(LogStevesUEHelpers, Warning, TEXT("%s: Attempted to release a reservation on %s that was not found"), *Name.ToString(), *Res->GetName());
+	}
+
+	/**
+	 * Reserve a resource. This will create a new resource if there isn't a free one for this key.
+	 * @param Key The key describing the resource required
+	 * @param Owner The UObject which will temporarily own this resource (mostly for debugging, this object won't in fact "own" it
+	 * as per garbage collection rules, the reference is weak
+	 * @return A shared pointer to a structure which holds the reservation for this resource. When that structure is
+	 * destroyed, it will release the resource back to the pool. The resource will be null if the key was invalid.
+	 */
+	FReservationPtr Reserve(const TKey& Key, const UObject* Owner)
+	{
+		TResource* Res = nullptr;
+		if (auto Pooled = UnreservedResources.Find(Key))
+		{
+			Res = *Pooled;
+			UnreservedResources.RemoveSingle(Key, Res);
+			Factory.Reset(Res, Key);
+			++NumHits;
+			FStevesResourcePoolCsvStats::Accumulate(CsvStats.Hits, 1);
+			UE_LOG(LogStevesUEHelpers, Verbose, TEXT("%s: Re-used pooled resource %s"), *Name.ToString(), *Res->GetName());
+		}
+		else
+		{
+			// Resource outer should be a valid UObject that will determine lifespan
+			UObject* Outer = PoolOwner.IsValid() ? PoolOwner.Get() : GetTransientPackage();
+			Res = Factory.Create(Key, Outer);
+			if (Res)
+			{
+				const int64 Bytes = Factory.GetResourceSize(Res);
+				TotalBytes += Bytes;
+				++NumMisses;
+				FStevesResourcePoolCsvStats::Accumulate(CsvStats.Misses, 1);
+				FStevesResourcePoolCsvStats::Accumulate(CsvStats.CreatedMB, Bytes / (1024.f * 1024.f));
+				UE_LOG(LogStevesUEHelpers, Verbose, TEXT("%s: Created new resource %s"), *Name.ToString(), *Res->GetName());
+				TrimToBudget();
+			}
+		}
+
+		FReservationPtr Ret = MakeShared<FReservation>(Res, this->AsShared(), Owner);
+		if (Res)
+		{
+			// Reservation doesn't keep the resource alive; if caller doesn't hold a strong pointer to it, it'll be destroyed
+			// So we need to hold it ourselves
+			FReservationInfo& R = Reservations.Add(Res, FReservationInfo(Key, Owner));
+			R.Reservation = Ret;
+			ReservedResources.Add(Res);
+		}
+
+		return Ret;
+	}
+
+	/**
+	 * Forcibly revoke reservations in this pool, either for all owners or for a specific owner.
+	 * Revoked resources go back into the pool and the reservations' Resource is nulled, so they release nothing when
+	 * destroyed, even if the resource has been reserved again by then.
+	 * @param ForOwner If null, revoke all reservations for any owner, or if provided, just for a specific owner.
+	 */
+	virtual void RevokeReservations(const UObject* ForOwner = nullptr)
+	{
+		for (auto It = Reservations.CreateIterator(); It; ++It)
+		{
+			const FReservationInfo& R = It.Value();
+			if (!ForOwner || R.Owner == ForOwner)
+			{
+				TResource* Res = It.Key();
+				UE_LOG(LogStevesUEHelpers, Verbose, TEXT("%s: Revoked reservation on %s"), *Name.ToString(), *Res->GetName());
+				if (auto Reservation = R.Reservation.Pin())
+					Reservation->Resource = nullptr;
+				RecordReservationEnded(R);
+				ReservedResources.Remove(Res);
+				It.RemoveCurrent();
+				ReturnToPool(R.Key, Res);
+			}
+		}
+	}
+
+	/**
+	 * Destroy previously created resources and free the memory.
+	 * @param bForceAndRevokeReservations If false, only destroys unreserved resources. If true, destroys reserved
+	 * resources as well (the weak pointer on their reservations will cease to be valid)
+	 */
+	virtual void DrainPool(bool bForceAndRevokeReservations = false)
+	{
+		if (bForceAndRevokeReservations)
+			RevokeReservations();
+
+		for (auto& Pair : UnreservedResources)
+		{
+			DestroyResource(Pair.Value);
+		}
+		UnreservedResources.Empty();
+	}
+
+	/**
+	 * Limit how many resources the pool keeps hold of when they're not in use.
+	 * @param InMaxUnreservedPerKey Maximum number of unreserved resources kept per key, 0 for no limit
+	 * @param InMaxTotalBytes Estimated memory above which unreserved resources are destroyed, 0 for no limit.
+	 * Reserved resources are never destroyed to meet this budget.
+	 */
+	void SetBudget(int32 InMaxUnreservedPerKey, int64 InMaxTotalBytes)
+	{
+		MaxUnreservedPerKey = InMaxUnreservedPerKey;
+		MaxTotalBytes = InMaxTotalBytes;
+		TrimToBudget();
+	}
+
+	/**
+	 * Gather a snapshot of the current state of this pool, including any leaked reservations
+	 * @param OutStats Stats structure to populate
+	 */
+	void GetStats(FStevesResourcePoolStats& OutStats) const
+	{
+		OutStats = FStevesResourcePoolStats();
+		OutStats.PoolName = Name;
+		OutStats.NumHits = NumHits;
+		OutStats.NumMisses = NumMisses;
+		OutStats.AverageReservationLifetime = NumCompletedReservations > 0
+			                                      ? TotalReservationLifetime / NumCompletedReservations
+			                                      : 0;
+
+		TMap<TKey, int32> KeyIndices;
+		auto GetKeyStats = [&](const TKey& Key) -> FStevesResourcePoolKeyStats&
+		{
+			if (const int32* Idx = KeyIndices.Find(Key))
+				return OutStats.Keys[*Idx];
+
+			const int32 Idx = OutStats.Keys.AddDefaulted();
+			KeyIndices.Add(Key, Idx);
+			OutStats.Keys[Idx].Key = Factory.DescribeKey(Key);
+			return OutStats.Keys[Idx];
+		};
+
+		for (auto& Pair : UnreservedResources)
+		{
+			auto& KS = GetKeyStats(Pair.Key);
+			++KS.NumUnreserved;
+			KS.TotalBytes += Factory.GetResourceSize(Pair.Value);
+		}
+
+		const double Now = FPlatformTime::Seconds();
+		for (auto& Pair : Reservations)
+		{
+			const FReservationInfo& R = Pair.Value;
+			auto& KS = GetKeyStats(R.Key);
+			++KS.NumReserved;
+			KS.TotalBytes += Factory.GetResourceSize(Pair.Key);
+			// Stale means the owner was set but has since been destroyed; null owners are not leaks
+			if (R.Owner.IsStale())
+			{
+				FStevesResourcePoolLeakInfo Leak;
+				Leak.OwnerName = R.OwnerName;
+				Leak.Resource = Pair.Key;
+				Leak.Age = Now - R.ReservedTime;
+				OutStats.Leaks.Add(Leak);
+			}
+		}
+
+		TArray<TPair<TKey, TResource*>> Pending;
+		GetPendingReleases(Pending);
+		for (auto& Pair : Pending)
+		{
+			auto& KS = GetKeyStats(Pair.Key);
+			++KS.NumPendingRelease;
+			KS.TotalBytes += Factory.GetResourceSize(Pair.Value);
+		}
+
+		for (auto& KS : OutStats.Keys)
+		{
+			OutStats.NumReserved += KS.NumReserved;
+			OutStats.NumUnreserved += KS.NumUnreserved;
+			OutStats.NumPendingRelease += KS.NumPendingRelease;
+			OutStats.TotalBytes += KS.TotalBytes;
+		}
+	}
+};
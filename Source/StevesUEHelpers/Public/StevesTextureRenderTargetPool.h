@@ -1,39 +1,152 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
+#include "StevesRectPacker.h"
+#include "StevesResourcePool.h"
+#include "Styling/SlateBrush.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "Engine/TextureRenderTargetCube.h"
+#include "RenderCommandFence.h"
 
-typedef TSharedPtr<struct FStevesTextureRenderTargetReservation> FStevesTextureRenderTargetReservationPtr;
+/// Key for pooled render targets; only textures with the same size & format are interchangeable
+struct FStevesTextureRenderTargetKey
+{
+	FIntPoint Size;
+	ETextureRenderTargetFormat Format;
+
+	friend bool operator==(const FStevesTextureRenderTargetKey& Lhs, const FStevesTextureRenderTargetKey& RHS)
+	{
+		return Lhs.Size == RHS.Size
+			&& Lhs.Format == RHS.Format;
+	}
+
+	friend bool operator!=(const FStevesTextureRenderTargetKey& Lhs, const FStevesTextureRenderTargetKey& RHS)
+	{
+		return !(Lhs == RHS);
+	}
+
+	friend uint32 GetTypeHash(const FStevesTextureRenderTargetKey& Key)
+	{
+		return HashCombine(GetTypeHash(Key.Size), static_cast<uint32>(Key.Format));
+	}
+};
+
+/// Factory for TStevesResourcePool which creates 2D render targets.
+/// The class can be changed to a subclass of UTextureRenderTarget2D e.g. UCanvasRenderTarget2D
+struct STEVESUEHELPERS_API FStevesTextureRenderTargetFactory
+{
+	TSubclassOf<UTextureRenderTarget2D> TextureClass;
+
+	explicit FStevesTextureRenderTargetFactory(TSubclassOf<UTextureRenderTarget2D> InClass = nullptr)
+		: TextureClass(InClass)
+	{
+	}
+
+	UTextureRenderTarget2D* Create(const FStevesTextureRenderTargetKey& Key, UObject* Outer);
+	void Reset(UTextureRenderTarget2D* Tex, const FStevesTextureRenderTargetKey& Key) {}
+	void Destroy(UTextureRenderTarget2D* Tex);
+	int64 GetResourceSize(UTextureRenderTarget2D* Tex) const;
+	FString DescribeKey(const FStevesTextureRenderTargetKey& Key) const;
+	static const TCHAR* GetTypeName() { return TEXT("TextureRenderTarget2D"); }
+};
+
+/// Key for pooled cube render targets
+struct FStevesTextureRenderTargetCubeKey
+{
+	int32 Size;
+	EPixelFormat Format;
+
+	friend bool operator==(const FStevesTextureRenderTargetCubeKey& Lhs, const FStevesTextureRenderTargetCubeKey& RHS)
+	{
+		return Lhs.Size == RHS.Size
+			&& Lhs.Format == RHS.Format;
+	}
+
+	friend bool operator!=(const FStevesTextureRenderTargetCubeKey& Lhs, const FStevesTextureRenderTargetCubeKey& RHS)
+	{
+		return !(Lhs == RHS);
+	}
+
+	friend uint32 GetTypeHash(const FStevesTextureRenderTargetCubeKey& Key)
+	{
+		return HashCombine(GetTypeHash(Key.Size), static_cast<uint32>(Key.Format));
+	}
+};
+
+/// Factory for TStevesResourcePool which creates cube render targets
+struct STEVESUEHELPERS_API FStevesTextureRenderTargetCubeFactory
+{
+	UTextureRenderTargetCube* Create(const FStevesTextureRenderTargetCubeKey& Key, UObject* Outer);
+	void Reset(UTextureRenderTargetCube* Tex, const FStevesTextureRenderTargetCubeKey& Key) {}
+	void Destroy(UTextureRenderTargetCube* Tex);
+	int64 GetResourceSize(UTextureRenderTargetCube* Tex) const;
+	FString DescribeKey(const FStevesTextureRenderTargetCubeKey& Key) const;
+	static const TCHAR* GetTypeName() { return TEXT("TextureRenderTargetCube"); }
+};
+
+/// Options for how a texture is prepared when it's reserved
+struct FStevesTextureRenderTargetReserveOptions
+{
+	/// Whether the texture should be cleared if it has been used before, rather than containing old contents
+	bool bClearOnReuse = false;
+	/// The colour to clear to
+	FLinearColor ClearColour = FLinearColor::Transparent;
+};
+
+/// Holder for a reserved render target texture. While this structure exists, the texture will be considered allocated
+/// and will not be returned from any other request. Only pass this structure around by SharedRef/SharedPtr.
+struct FStevesTextureRenderTargetReservation : public TStevesResourceReservation<UTextureRenderTarget2D>
+{
+	using TStevesResourceReservation<UTextureRenderTarget2D>::TStevesResourceReservation;
+
+	/// The texture, same as Resource. Kept so code written before the generic pool still compiles
+	TWeakObjectPtr<UTextureRenderTarget2D>& Texture = Resource;
+
+	FStevesTextureRenderTargetReservation(const FStevesTextureRenderTargetReservation&) = delete;
+	FStevesTextureRenderTargetReservation& operator=(const FStevesTextureRenderTargetReservation&) = delete;
+};
+typedef TSharedPtr<FStevesTextureRenderTargetReservation> FStevesTextureRenderTargetReservationPtr;
 typedef TSharedPtr<struct FStevesTextureRenderTargetPool> FStevesTextureRenderTargetPoolPtr;
+typedef TSharedPtr<struct FStevesTextureRenderTargetAtlasReservation> FStevesTextureRenderTargetAtlasReservationPtr;
+
+typedef TStevesResourcePool<UTextureRenderTargetCube, FStevesTextureRenderTargetCubeKey, FStevesTextureRenderTargetCubeFactory> FStevesTextureRenderTargetCubePool;
+typedef TSharedPtr<FStevesTextureRenderTargetCubePool> FStevesTextureRenderTargetCubePoolPtr;
 
-/// Holder for an assigned texture. While this structure exists, the texture will be considered assigned 
-/// and will not be returned from any other request. Once this structure is destroyed the texture will
-/// be free for re-use. For that reason, only pass this structure around by SharedRef/SharedPtr.
-/// The texture is held by a weak pointer however, the strong pointer is held by the pool. The texture will continue
-/// to be available to this reservation except if the pool is told to forcibly release textures.
-struct STEVESUEHELPERS_API FStevesTextureRenderTargetReservation
+/// Holder for a region of a shared atlas texture. While this structure exists, the region will be considered assigned
+/// and will not be returned from any other request. Once this structure is destroyed the region will be free for
+/// re-use. As with FStevesTextureRenderTargetReservation, only pass this structure around by SharedRef/SharedPtr.
+/// Render only within Rect; the rest of the texture belongs to other reservations.
+struct STEVESUEHELPERS_API FStevesTextureRenderTargetAtlasReservation
 {
 public:
-	/// The texture. May be null if the pool has forcibly reclaimed the texture prematurely
+	/// The shared atlas texture. May be null if the pool has forcibly reclaimed the texture prematurely
 	TWeakObjectPtr<UTextureRenderTarget2D> Texture;
+	/// The region of the texture which is reserved, in pixels
+	FIntRect Rect;
+	/// Top-left UV of the reserved region
+	FVector2D UVMin;
+	/// Bottom-right UV of the reserved region
+	FVector2D UVMax;
+	/// A brush which displays just the reserved region of the atlas
+	FSlateBrush Brush;
 	TWeakPtr<struct FStevesTextureRenderTargetPool> ParentPool;
 	TWeakObjectPtr<const UObject> CurrentOwner;
-	
-	FStevesTextureRenderTargetReservation() = default;
-
-	FStevesTextureRenderTargetReservation(UTextureRenderTarget2D* InTexture,
-	                                      FStevesTextureRenderTargetPoolPtr InParent,
-	                                      const UObject* InOwner)
-		: Texture(InTexture),
-		  ParentPool(InParent),
-		  CurrentOwner(InOwner)
-	
-	{
-	}
-	
-	~FStevesTextureRenderTargetReservation();
-};
 
+	FStevesTextureRenderTargetAtlasReservation() = default;
+
+	FStevesTextureRenderTargetAtlasReservation(UTextureRenderTarget2D* InTexture,
+	                                           const FIntRect& InRect,
+	                                           const FIntRect& InAllocatedRect,
+	                                           FStevesTextureRenderTargetPoolPtr InParent,
+	                                           const UObject* InOwner);
+
+	~FStevesTextureRenderTargetAtlasReservation();
+
+protected:
+	friend struct FStevesTextureRenderTargetPool;
+	/// The region taken from the atlas including padding
+	FIntRect AllocatedRect;
+};
 
 /**
  * A pool of render target textures. To save pre-creating render textures as assets, and to control the re-use of
@@ -42,101 +155,141 @@ public:
  * ultimate lifecycle of textures if not released specifically.
  * See FCompElementRenderTargetPool for inspiration
  */
-struct STEVESUEHELPERS_API FStevesTextureRenderTargetPool : public FGCObject, public TSharedFromThis<FStevesTextureRenderTargetPool>
+struct STEVESUEHELPERS_API FStevesTextureRenderTargetPool : public TStevesResourcePool<
+		UTextureRenderTarget2D, FStevesTextureRenderTargetKey, FStevesTextureRenderTargetFactory,
+		FStevesTextureRenderTargetReservation>
 {
-
 protected:
-	/// The name of the pool. It's possible to have more than one texture pool.
-	FName Name;
-
-	struct FTextureKey
+	/// A texture shared between many small reservations
+	struct FAtlasPage
 	{
-		FIntPoint Size;
+		FStevesTextureRenderTargetReservationPtr PageReservation;
 		ETextureRenderTargetFormat Format;
+		FStevesShelfRectPacker Packer;
+		int32 NumRegions;
+		/// Regions reserved on this page, so they can be invalidated if the page goes away while they're in use
+		TArray<TWeakPtr<FStevesTextureRenderTargetAtlasReservation>> Regions;
 
-		friend bool operator==(const FTextureKey& Lhs, const FTextureKey& RHS)
-		{
-			return Lhs.Size == RHS.Size
-				&& Lhs.Format == RHS.Format;
-		}
-
-		friend bool operator!=(const FTextureKey& Lhs, const FTextureKey& RHS)
-		{
-			return !(Lhs == RHS);
-		}
-
-		friend uint32 GetTypeHash(const FTextureKey& Key)
+		FAtlasPage(const FStevesTextureRenderTargetReservationPtr& InReservation, ETextureRenderTargetFormat InFormat,
+		           int32 InSize)
+			: PageReservation(InReservation),
+			  Format(InFormat),
+			  Packer(FIntPoint(InSize)),
+			  NumRegions(0)
 		{
-			return HashCombine(GetTypeHash(Key.Size), static_cast<uint32>(Key.Format));
 		}
-
 	};
+	TArray<FAtlasPage> AtlasPages;
+	int32 AtlasPageSize = 2048;
+	int32 AtlasPadding = 1;
 
-	TWeakObjectPtr<UObject> PoolOwner;
-	TMultiMap<FTextureKey, UTextureRenderTarget2D*> UnreservedTextures;
-	TSet<UTextureRenderTarget2D*> ReservedTextures;
-
-	/// Weak reverse tracking of reservations, mostly for debugging
-	struct FReservationInfo
+	/// A texture which has been released but which the GPU may still be using
+	struct FPendingRelease
 	{
-		FTextureKey Key;
-		TWeakObjectPtr<const UObject> Owner;
-		TWeakObjectPtr<UTextureRenderTarget2D> Texture;
-
-		FReservationInfo(const FTextureKey& InKey, const UObject* InOwner, UTextureRenderTarget2D* InTexture)
-			: Key(InKey),
-			  Owner(InOwner),
-			  Texture(InTexture)
-		{
-		}
+		FStevesTextureRenderTargetKey Key;
+		UTextureRenderTarget2D* Texture;
+		bool bClear;
+		FLinearColor ClearColour;
+	};
+	/// All the textures released in one frame, which become available again once the fence has passed. The fence
+	/// syncs to the RHI thread & GPU, so it only passes once the GPU has finished the work queued before it.
+	struct FReleaseBatch
+	{
+		TArray<FPendingRelease> Textures;
+		FRenderCommandFence Fence;
 	};
-	TArray<FReservationInfo> Reservations;
-	
+	/// Textures released this frame
+	TArray<FPendingRelease> PendingReleases;
+	/// Batches from previous frames waiting on the GPU, oldest first
+	TArray<TUniquePtr<FReleaseBatch>> ReleaseBatches;
+	/// Options for reservations which asked for something to happen on release
+	TMap<UTextureRenderTarget2D*, FStevesTextureRenderTargetReserveOptions> ReservationOptions;
+	/// Unreserved textures which have been cleared in a batch, and the colour they were cleared to
+	TMap<TWeakObjectPtr<UTextureRenderTarget2D>, FLinearColor> ClearedTextures;
+	FDelegateHandle EndFrameHandle;
+
+	virtual void ReturnToPool(const FStevesTextureRenderTargetKey& Key, UTextureRenderTarget2D* Tex) override;
+	virtual void GetPendingReleases(
+		TArray<TPair<FStevesTextureRenderTargetKey, UTextureRenderTarget2D*>>& OutPending) const override;
+	void OnEndFrame();
+	/// Clear this frame's released textures on the render thread as one batch, then fence them
+	void SubmitPendingReleases();
+	/// Return released textures to the pool once the GPU has finished with them
+	void ReturnCompletedReleases(bool bWait);
+
+	friend struct FStevesTextureRenderTargetAtlasReservation;
+	/// Release a region of an atlas page, allowing it to be re-used
+	/// Protected because only FStevesTextureRenderTargetAtlasReservation will need to do this.
+	void ReleaseAtlasRegion(UTextureRenderTarget2D* Page, const FIntRect& AllocatedRect);
+	/// Whether a page's texture is still reserved for it, so regions can be packed onto it
+	bool IsAtlasPageValid(const FAtlasPage& Page) const;
+	/// Free regions of a page, for any owner or just one, nulling their texture so they release nothing when destroyed
+	void RevokeAtlasRegions(FAtlasPage& Page, const UObject* ForOwner);
+	/// Drop atlas pages, revoking any regions still reserved on them
+	void DropAtlasPages(TFunctionRef<bool(const FAtlasPage&)> Predicate);
 
-	friend struct FStevesTextureRenderTargetReservation;
-	/// Release a reservation on a texture, allowing it back into the pool
-	/// Protected because only FStevesTextureRenderTargetReservation will need to do this.
-	void ReleaseReservation(UTextureRenderTarget2D* Tex);
 public:
+	typedef TStevesResourcePool<UTextureRenderTarget2D, FStevesTextureRenderTargetKey, FStevesTextureRenderTargetFactory,
+	                            FStevesTextureRenderTargetReservation> Super;
 
-	explicit FStevesTextureRenderTargetPool(const FName& InName, UObject* InOwner)
-		: Name(InName), PoolOwner(InOwner)
-	{
-	}
+	/**
+	 * Create a texture pool
+	 * @param InName The name of the pool
+	 * @param InOwner The UObject which will own the textures
+	 * @param InTextureClass Optional subclass of UTextureRenderTarget2D to create, e.g. UCanvasRenderTarget2D
+	 */
+	explicit FStevesTextureRenderTargetPool(const FName& InName, UObject* InOwner,
+	                                        TSubclassOf<UTextureRenderTarget2D> InTextureClass = nullptr);
 
 	virtual ~FStevesTextureRenderTargetPool() override;
 
-	const FName& GetName() const { return Name; }
-
 	// FGCObject
 	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
-	
+
 	/**
-	 * Reserve a texture for use as a render target. This will create a new texture target if needed. 
+	 * Reserve a texture for use as a render target. This will create a new texture target if needed.
+	 * Released textures only become available again once the GPU has finished any work that was queued
+	 * for them before they were released.
 	 * @param Size The dimensions of the texture
 	 * @param Format Format of the texture
 	 * @param Owner The UObject which will temporarily own this texture (mostly for debugging, this object won't in fact "own" it
 	 * as per garbage collection rules, the reference is weak
+	 * @param Options How the texture should be prepared. Clears requested here are also applied when this
+	 * reservation is released, batched with all other textures released that frame, so a later reservation with the
+	 * same clear colour gets a clean texture without any further work. Otherwise the clear is queued on the render
+	 * thread; the texture's ClearColor is never changed.
 	 * @return A shared pointer to a structure which holds the reservation for this texture. When that structure is
 	 * destroyed, it will release the texture back to the pool.
 	 */
-	FStevesTextureRenderTargetReservationPtr ReserveTexture(FIntPoint Size, ETextureRenderTargetFormat Format, const UObject* Owner);
+	FStevesTextureRenderTargetReservationPtr ReserveTexture(FIntPoint Size, ETextureRenderTargetFormat Format, const UObject* Owner,
+	                                                        const FStevesTextureRenderTargetReserveOptions& Options = FStevesTextureRenderTargetReserveOptions());
 
 	/**
-	 * Forcibly revoke reservations in this pool, either for all owners or for a specific owner.
-	 * Reservations which are revoked will have their weak texture pointers invalidated.
-	 * @param ForOwner If null, revoke all reservations for any owner, or if provided, just for a specific owner.
+	 * Change how atlas pages are created for ReserveAtlasRegion. Only affects pages created after this call.
+	 * @param PageSize The width & height of each atlas texture
+	 * @param Padding Number of pixels to leave between regions so that filtering doesn't bleed between them
 	 */
-	void RevokeReservations(const UObject* ForOwner = nullptr);
-	
-	
+	void SetAtlasOptions(int32 PageSize, int32 Padding);
+
 	/**
-	 *
-	 * Destroy previously created textures and free the memory.
-	 * @param bForceAndRevokeReservations If false, only destroys unreserved textures. If true, destroys reserved textures
-	 * as well (the weak pointer on their reservations will cease to be valid)
+	 * Reserve a region of a larger shared texture for use as a render target, rather than a texture of its own.
+	 * Many small render targets can share one texture this way, reducing the number of resources, and allowing
+	 * UI draws of those regions to be batched together. Atlas textures are created from this pool as needed.
+	 * @param Size The dimensions of the region required. Must be no larger than the atlas page size
+	 * @param Format Format of the texture
+	 * @param Owner The UObject which will temporarily own this region (weak reference, as with ReserveTexture)
+	 * @return A shared pointer to a structure which holds the reservation for this region, including the texture,
+	 * UVs and a brush for displaying it. When that structure is destroyed, it will release the region. Null if the
+	 * region could not be allocated.
 	 */
-	void DrainPool(bool bForceAndRevokeReservations = false);
-	
-};
+	FStevesTextureRenderTargetAtlasReservationPtr ReserveAtlasRegion(FIntPoint Size, ETextureRenderTargetFormat Format, const UObject* Owner);
 
+	/// Also revokes atlas regions for the owner. If an atlas page's own reservation is revoked, e.g. for the pool
+	/// owner or everyone, the page is dropped and every region on it is revoked, since its texture can now be given
+	/// to someone else.
+	virtual void RevokeReservations(const UObject* ForOwner = nullptr) override;
+
+	/// Also releases atlas pages which have no regions in use, or all atlas pages if forced. If forced, this
+	/// waits for the GPU to finish with any recently released textures.
+	virtual void DrainPool(bool bForceAndRevokeReservations = false) override;
+};
@@ -4,11 +4,10 @@
 
 
 #include "StevesGameSubsystem.h"
+#include "StevesHelperCommon.h"
 #include "Modules/ModuleManager.h"
 #include "Engine/World.h"
 
-DECLARE_LOG_CATEGORY_EXTERN(LogStevesUEHelpers, Verbose, Verbose);
-
 class FStevesUEHelpers : public IModuleInterface
 {
 public:
@@ -1,17 +1,57 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogFocusSystem, Log, All)
 
+class UFocusableUserWidget;
+
+/// Keeps track of UFocusableUserWidgets with automatic focus enabled, so that when one with focus goes away the
+/// focus can be given to the highest priority one left.
+/// Each widget's priority is cached when it's registered, so finding the highest doesn't need to call into every
+/// widget; widgets must call FocusableWidgetStateChanged if it changes. Whether a widget is requesting focus can change
+/// at any time, so it's asked again each time focus is handed out, walking down from the highest priority & stopping
+/// at the first widget which is.
 class FFocusSystem
 {
 protected:
-    TArray<TWeakObjectPtr<class UFocusableUserWidget>> ActiveAutoFocusWidgets;
+    /// Sort key for a registered widget
+    struct FFocusKey
+    {
+        int Priority;
+        /// Order of registration, so that equal priority widgets keep the order they were added in
+        uint32 Order;
+
+        /// Higher priority first
+        bool operator<(const FFocusKey& Other) const
+        {
+            return Priority > Other.Priority || (Priority == Other.Priority && Order < Other.Order);
+        }
+    };
+
+    struct FFocusEntry
+    {
+        FFocusKey Key;
+        TWeakObjectPtr<UFocusableUserWidget> Widget;
+        /// Key of the widget in WidgetKeys, which stays valid after the widget is collected
+        FObjectKey ObjectKey;
+    };
+
+    /// Registered widgets, sorted by FFocusKey so the highest priority is first
+    TArray<FFocusEntry> ActiveAutoFocusWidgets;
+    /// Key of each registered widget, to find it in ActiveAutoFocusWidgets with a binary search
+    TMap<FObjectKey, FFocusKey> WidgetKeys;
+    uint32 NextOrder = 0;
 
     TWeakObjectPtr<UFocusableUserWidget> GetHighestFocusPriority();
+    int32 FindEntryIndex(const FFocusKey& Key) const;
+    void AddEntry(UFocusableUserWidget* Widget, uint32 Order);
+    void RemoveEntry(const FObjectKey& Widget);
 public:
     void FocusableWidgetConstructed(UFocusableUserWidget* Widget);
     void FocusableWidgetDestructed(UFocusableUserWidget* Widget);
-    
+    /// Update the cached priority of a widget, if it's registered
+    void FocusableWidgetStateChanged(UFocusableUserWidget* Widget);
+
 };
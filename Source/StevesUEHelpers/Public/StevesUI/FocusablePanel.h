@@ -47,6 +47,11 @@ public:
     bool SavePreviousFocus();
 
     
+    /// Call this after adding, removing or rebuilding children at runtime, so that saving the previous focus can
+    /// find them. It's done automatically when this panel is constructed or its Slate widget is rebuilt.
+    UFUNCTION(BlueprintCallable)
+    void InvalidateSlateWidgetMap() { bSlateWidgetMapDirty = true; }
+
     /// When SetFocusProperly is called, either restores previous selection or gives it to the initial selection
     virtual void SetFocusProperly_Implementation() override;
 protected:
@@ -58,6 +63,16 @@ protected:
     /// Previously focussed child which can be restored
     TWeakObjectPtr<UWidget> PreviousFocusWidget;
 
+    /// Our widgets (including this one) by their Slate widget, so the focussed one can be found without searching
+    TMap<const SWidget*, TWeakObjectPtr<UWidget>> SlateWidgetMap;
+    /// Whether our widget structure has changed since SlateWidgetMap was built
+    bool bSlateWidgetMapDirty = true;
+
+    /// Find which of our child widgets owns a Slate widget, i.e. the nearest one using it or one of its Slate
+    /// parents, or nullptr if it isn't under one of our children
+    UWidget* FindChildFromSlate(const SWidget* SW);
+
+    virtual void OnWidgetRebuilt() override;
     virtual void NativeConstruct() override;
     virtual void NativeDestruct() override;
 
@@ -32,7 +32,8 @@ public:
     void SetFocusProperly();
 
     /// Whether this widget is *currently* requesting focus. Default is to use IsAutomaticFocusEnabled but subclasses
-    /// may override this to be volatile
+    /// may override this to be volatile. The focus system doesn't cache this: it's asked again whenever focus is
+    /// being handed to the highest priority widget, so it may change at any time without notifying anything.
     UFUNCTION(BlueprintNativeEvent, BlueprintCallable)
     bool IsRequestingFocus() const;
 
@@ -40,6 +41,11 @@ public:
     UFUNCTION(BlueprintNativeEvent, BlueprintCallable)
     bool TakeFocusIfDesired();
 
+    /// Call this if GetAutomaticFocusPriority may now return something different, so that the focus system can
+    /// re-sort this widget. Changes to IsRequestingFocus don't need this.
+    UFUNCTION(BlueprintCallable)
+    void NotifyFocusStateChanged();
+
     virtual bool IsAutomaticFocusEnabled() const { return bEnableAutomaticFocus; }
     virtual int GetAutomaticFocusPriority() const { return AutomaticFocusPriority; }
 
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "StevesResourcePool.h"
+#include "Blueprint/UserWidget.h"
+#include "Engine/GameInstance.h"
+#include "GameFramework/PlayerController.h"
+
+/// Factory for TStevesResourcePool which creates user widgets, keyed on their class.
+/// The pool owner is used as the widget's owner, so it should be a player controller, game instance, widget or
+/// something in a world.
+struct FStevesUserWidgetFactory
+{
+	UUserWidget* Create(UClass* WidgetClass, UObject* Outer)
+	{
+		if (!WidgetClass || !Outer)
+			return nullptr;
+
+		if (APlayerController* PC = Cast<APlayerController>(Outer))
+			return CreateWidget(PC, WidgetClass);
+		if (UGameInstance* GI = Cast<UGameInstance>(Outer))
+			return CreateWidget(GI, WidgetClass);
+		if (UWidget* Widget = Cast<UWidget>(Outer))
+			return CreateWidget(Widget, WidgetClass);
+		if (UWorld* World = Outer->GetWorld())
+			return CreateWidget(World, WidgetClass);
+		return nullptr;
+	}
+
+	void Reset(UUserWidget* Widget, UClass* WidgetClass)
+	{
+		// Widgets are removed from their parent when released, nothing else is generic enough to reset here
+	}
+
+	void Destroy(UUserWidget* Widget)
+	{
+		Widget->RemoveFromParent();
+	}
+
+	int64 GetResourceSize(UUserWidget* Widget) const
+	{
+		return Widget ? Widget->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal) : 0;
+	}
+
+	FString DescribeKey(UClass* WidgetClass) const
+	{
+		return WidgetClass ? WidgetClass->GetPathName() : TEXT("None");
+	}
+
+	static const TCHAR* GetTypeName() { return TEXT("UserWidget"); }
+};
+
+/**
+ * A pool of user widgets, so that widgets which come & go often (list entries, markers, damage numbers) don't need
+ * to be constructed & collected every time. Released widgets are removed from their parent straight away; anything
+ * else they need resetting (bindings, text, animations) is up to the caller when they're reserved again.
+ */
+struct FStevesUserWidgetPool : public TStevesResourcePool<UUserWidget, UClass*, FStevesUserWidgetFactory>
+{
+public:
+	typedef TStevesResourcePool<UUserWidget, UClass*, FStevesUserWidgetFactory> Super;
+
+	explicit FStevesUserWidgetPool(const FName& InName, UObject* InOwner)
+		: Super(InName, InOwner)
+	{
+	}
+
+	/// Reserve a widget of a given class, creating one if there are none free
+	FReservationPtr ReserveWidget(TSubclassOf<UUserWidget> WidgetClass, const UObject* Owner)
+	{
+		return Reserve(WidgetClass.Get(), Owner);
+	}
+
+protected:
+	virtual void ReturnToPool(UClass* const& WidgetClass, UUserWidget* Widget) override
+	{
+		Widget->RemoveFromParent();
+		Super::ReturnToPool(WidgetClass, Widget);
+	}
+};
+
+typedef TSharedPtr<FStevesUserWidgetPool> FStevesUserWidgetPoolPtr;
+typedef FStevesUserWidgetPool::FReservation FStevesUserWidgetReservation;
+typedef TSharedPtr<FStevesUserWidgetReservation> FStevesUserWidgetReservationPtr;
@@ -36,6 +36,8 @@ public class StevesUEHelpers : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
+				"RenderCore",
+				"RHI"
 			}
 			);
 		